@@ -0,0 +1,326 @@
+#include "batch.h"
+#include "simulator.h"
+#include "printer.h"
+#include "port_io.h"
+#include "guest_memory.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ul
+#define FNV_PRIME  0x100000001b3ul
+
+static const Register batch_registers[12] = {
+    Register_ax, Register_bx, Register_cx, Register_dx,
+    Register_sp, Register_bp, Register_si, Register_di,
+    Register_es, Register_cs, Register_ss, Register_ds
+};
+
+static const char *batch_status_names[] = {
+    [Batch_Status_Exit]    = "exit",
+    [Batch_Status_Crash]   = "crash",
+    [Batch_Status_Fault]   = "fault",
+    [Batch_Status_Timeout] = "timeout",
+    [Batch_Status_Error]   = "error",
+};
+
+static u64 fnv1a(u64 hash, const u8 *data, u32 size)
+{
+    for (u32 i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+Batch *batch_load_manifest(const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        printf("\n[ERROR]: Failed to open %s batch manifest.\n", filename);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    u32 fsize = ftell(fp);
+    rewind(fp);
+
+    Batch *batch = (Batch *)calloc(1, sizeof(Batch));
+    assert(batch != NULL);
+
+    batch->manifest = (char *)malloc(fsize + 1);
+    assert(batch->manifest != NULL);
+
+    fsize = fread(batch->manifest, 1, fsize, fp);
+    batch->manifest[fsize] = '\0';
+    fclose(fp);
+
+    // One run per line at most
+    u32 capacity = 1;
+    for (u32 i = 0; i < fsize; i++) {
+        if (batch->manifest[i] == '\n') capacity++;
+    }
+
+    batch->runs = (Batch_Run *)calloc(capacity, sizeof(Batch_Run));
+    assert(batch->runs != NULL);
+
+    char *line_state = NULL;
+    for (char *line = strtok_r(batch->manifest, "\n", &line_state); line; line = strtok_r(NULL, "\n", &line_state)) {
+        char *token_state = NULL;
+        char *binary = strtok_r(line, " \t\r", &token_state);
+        if (binary == NULL || binary[0] == '#') {
+            continue;
+        }
+
+        Batch_Run *run = &batch->runs[batch->run_count++];
+        run->binary = binary;
+        run->instruction_limit = BATCH_DEFAULT_LIMIT;
+
+        for (char *option = strtok_r(NULL, " \t\r", &token_state); option; option = strtok_r(NULL, " \t\r", &token_state)) {
+            char *value = strtok_r(NULL, " \t\r", &token_state);
+            if (value == NULL) {
+                printf("\n[WARNING]: %s has no value in the batch manifest line of %s\n", option, binary);
+                break;
+            }
+
+            if (STR_EQUAL(option, "--port-in")) {
+                run->port_input = value;
+            } else if (STR_EQUAL(option, "--limit")) {
+                run->instruction_limit = strtoull(value, NULL, 10);
+            } else {
+                printf("\n[WARNING]: Unknown batch option %s for %s\n", option, binary);
+            }
+        }
+    }
+
+    return batch;
+}
+
+void batch_destroy(Batch *batch)
+{
+    free(batch->runs);
+    free(batch->manifest);
+    free(batch);
+}
+
+static u8 file_readable(const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp) {
+        fclose(fp);
+    }
+    return fp != NULL;
+}
+
+static void batch_port_write(CPU *cpu, void *user, u16 port, u16 data, u8 wide)
+{
+    Batch_Run *run = (Batch_Run *)user;
+
+    u16 record[2] = { port, wide ? data : (data & 0xFF) };
+    run->port_digest = fnv1a(run->port_digest, (u8 *)record, sizeof(record));
+}
+
+static void execute_run(Batch_Run *run, Memory_Pool *pool)
+{
+    run->port_digest = FNV_OFFSET;
+
+    // The loaders assert on a missing file, one bad line must not stop the whole batch
+    if (!file_readable(run->binary) || (run->port_input && !file_readable(run->port_input))) {
+        run->status = Batch_Status_Error;
+        return;
+    }
+
+    CPU cpu = {0};
+    cpu.quiet = 1;
+    cpu.memory_pool = pool;
+    cpu.io = port_io_create();
+    port_io_set_handler(cpu.io, 0, PORT_COUNT - 1, batch_port_write, NULL, run);
+    if (run->port_input) {
+        port_io_load_input(cpu.io, run->port_input);
+    }
+
+    boot(&cpu);
+    load_executable(&cpu, run->binary);
+
+    run->status = Batch_Status_Exit;
+    while (calc_inst_pointer_address(&cpu) < cpu.exec_end) {
+        if (cpu.stats.instructions >= run->instruction_limit) {
+            run->status = Batch_Status_Timeout;
+            break;
+        }
+
+        step_instruction(&cpu);
+
+        if (cpu.terminate) {
+            run->status = cpu.fault ? Batch_Status_Fault : Batch_Status_Crash;
+            break;
+        }
+    }
+
+    for (u32 i = 0; i < ARRAY_SIZE(batch_registers); i++) {
+        run->registers[i] = get_data_from_register(&cpu, register_access_by_enum(batch_registers[i]));
+    }
+    run->ip = cpu.ip;
+    run->flags = cpu.flags;
+    run->stats = cpu.stats;
+    run->memory_digest = fnv1a(FNV_OFFSET, cpu.memory, MAX_MEMORY);
+
+    power_off(&cpu);
+    port_io_destroy(cpu.io);
+}
+
+#ifdef _WIN32
+
+void batch_run(Batch *batch, u32 thread_count)
+{
+    batch->thread_count = 1;
+
+    Memory_Pool *pool = memory_pool_create();
+    for (u32 job = 0; job < batch->run_count; job++) {
+        execute_run(&batch->runs[job], pool);
+    }
+    memory_pool_destroy(pool);
+}
+
+#else
+
+static u8 deque_pop(Batch_Deque *deque, u32 *job)
+{
+    pthread_mutex_lock(&deque->lock);
+    u8 found = deque->head != deque->tail;
+    if (found) {
+        *job = deque->jobs[--deque->tail];
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return found;
+}
+
+static u8 deque_steal(Batch_Deque *deque, u32 *job)
+{
+    pthread_mutex_lock(&deque->lock);
+    u8 found = deque->head != deque->tail;
+    if (found) {
+        *job = deque->jobs[deque->head++];
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return found;
+}
+
+typedef struct {
+    Batch *batch;
+    u32 index;
+} Batch_Worker;
+
+static void *batch_worker(void *argument)
+{
+    Batch_Worker *worker = (Batch_Worker *)argument;
+    Batch *batch = worker->batch;
+
+    // Not thread safe, every worker has its own
+    Memory_Pool *pool = memory_pool_create();
+
+    for (;;) {
+        u32 job = 0;
+        u8 found = deque_pop(&batch->deques[worker->index], &job);
+
+        // No job is added while running, so if every deque is empty we're done
+        for (u32 i = 1; !found && i < batch->thread_count; i++) {
+            found = deque_steal(&batch->deques[(worker->index + i) % batch->thread_count], &job);
+        }
+
+        if (!found) {
+            break;
+        }
+
+        execute_run(&batch->runs[job], pool);
+    }
+
+    memory_pool_destroy(pool);
+    return NULL;
+}
+
+void batch_run(Batch *batch, u32 thread_count)
+{
+    if (thread_count == 0) thread_count = 1;
+    if (thread_count > BATCH_MAX_THREADS) thread_count = BATCH_MAX_THREADS;
+
+    batch->thread_count = thread_count;
+    batch->deques = (Batch_Deque *)calloc(thread_count, sizeof(Batch_Deque));
+    assert(batch->deques != NULL);
+
+    for (u32 i = 0; i < thread_count; i++) {
+        Batch_Deque *deque = &batch->deques[i];
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->jobs = (u32 *)malloc((batch->run_count / thread_count + 1) * sizeof(u32));
+        assert(deque->jobs != NULL);
+    }
+
+    // Dealt out round robin, the owner pops from the tail, so reverse to start with the first lines
+    for (u32 job = batch->run_count; job > 0; job--) {
+        Batch_Deque *deque = &batch->deques[(job - 1) % thread_count];
+        deque->jobs[deque->tail++] = job - 1;
+    }
+
+    pthread_t threads[BATCH_MAX_THREADS];
+    Batch_Worker workers[BATCH_MAX_THREADS];
+
+    for (u32 i = 0; i < thread_count; i++) {
+        workers[i] = (Batch_Worker){.batch = batch, .index = i};
+        int error = pthread_create(&threads[i], NULL, batch_worker, &workers[i]);
+        assert(error == 0);
+    }
+
+    for (u32 i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (u32 i = 0; i < thread_count; i++) {
+        pthread_mutex_destroy(&batch->deques[i].lock);
+        free(batch->deques[i].jobs);
+    }
+
+    free(batch->deques);
+    batch->deques = NULL;
+}
+
+#endif
+
+static void write_json_string(FILE *dest, const char *text)
+{
+    fputc('"', dest);
+    for (const char *c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(dest, "\\%c", *c);
+        } else if ((u8)*c < 0x20) {
+            fprintf(dest, "\\u%04x", (u8)*c);
+        } else {
+            fputc(*c, dest);
+        }
+    }
+    fputc('"', dest);
+}
+
+void batch_write_report(Batch *batch, FILE *dest, double seconds)
+{
+    fprintf(dest, "{\n  \"threads\": %u,\n  \"seconds\": %.6f,\n  \"runs\": [\n", batch->thread_count, seconds);
+
+    for (u32 i = 0; i < batch->run_count; i++) {
+        Batch_Run *run = &batch->runs[i];
+
+        fprintf(dest, "    {\"binary\": ");
+        write_json_string(dest, run->binary);
+        fprintf(dest, ", \"status\": \"%s\"", batch_status_names[run->status]);
+
+        if (run->status != Batch_Status_Error) {
+            fprintf(dest, ", \"instructions\": %lu, \"cycles\": %lu, \"registers\": {", run->stats.instructions, run->stats.cycles);
+            for (u32 r = 0; r < ARRAY_SIZE(batch_registers); r++) {
+                fprintf(dest, "%s\"%s\": %u", r ? ", " : "", register_name(batch_registers[r]), run->registers[r]);
+            }
+            fprintf(dest, "}, \"ip\": %u, \"flags\": %u, \"memory_digest\": \"%016lx\", \"port_digest\": \"%016lx\"",
+                    run->ip, run->flags, run->memory_digest, run->port_digest);
+        }
+
+        fprintf(dest, "}%s\n", i + 1 < batch->run_count ? "," : "");
+    }
+
+    fprintf(dest, "  ]\n}\n");
+}
@@ -0,0 +1,81 @@
+#ifndef _H_BATCH
+#define _H_BATCH
+
+#include "sim86.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// Runs many guest binaries on a thread pool: sim86 --batch <manifest> [--threads n] [--batch-report file]
+//
+// Every manifest line is one run, the binary path comes first, then its own options:
+//
+//   input/listing_0052_memory_add_loop
+//   test/dude --port-in test/dude.in --limit 5000000
+//   # comment
+//
+//   --port-in <file>   the port input stream of the run
+//   --limit <n>        the run is stopped as a timeout after n instructions (default: BATCH_DEFAULT_LIMIT)
+//
+// Every run has its own cpu, memory and ports, the trace is off and the outs are only
+// hashed. The jobs are dealt out to the per worker deques and a worker which runs out of
+// its own jobs steals from the others, so a few long runs don't leave the cores idle. The
+// Windows build has no pthreads, it runs them one after the other.
+//
+// The report is JSON in the manifest order with the final registers, flags, stats and the
+// digests (64bit FNV-1a) of the whole guest memory and of the out (port, data) sequence.
+
+#define BATCH_DEFAULT_LIMIT 10000000
+#define BATCH_DEFAULT_REPORT "./batch_report.json"
+#define BATCH_MAX_THREADS 256
+
+typedef enum {
+    Batch_Status_Exit,    // ran off the end of the program
+    Batch_Status_Crash,   // unhandled instruction
+    Batch_Status_Fault,   // divide by zero or an unimplemented form, see Cpu_Fault
+    Batch_Status_Timeout,
+    Batch_Status_Error,   // the binary or the input can't be read
+} Batch_Status;
+
+typedef struct {
+    char *binary;
+    char *port_input; // NULL if there is no input stream
+    u64 instruction_limit;
+
+    Batch_Status status;
+    u16 registers[12]; // ax, bx, cx, dx, sp, bp, si, di, es, cs, ss, ds
+    u16 ip;
+    u16 flags;
+    Cpu_Stats stats;
+    u64 memory_digest;
+    u64 port_digest;
+} Batch_Run;
+
+// Double ended queue of run indices, the owner pops from the tail and the thieves take from the head
+typedef struct {
+#ifndef _WIN32
+    pthread_mutex_t lock;
+#endif
+    u32 *jobs;
+    u32 head;
+    u32 tail;
+} Batch_Deque;
+
+typedef struct {
+    char *manifest; // the paths of the runs point into this
+    Batch_Run *runs;
+    u32 run_count;
+
+    Batch_Deque *deques;
+    u32 thread_count;
+} Batch;
+
+// Returns NULL if the manifest can't be read
+Batch *batch_load_manifest(const char *filename);
+void batch_destroy(Batch *batch);
+
+void batch_run(Batch *batch, u32 thread_count);
+void batch_write_report(Batch *batch, FILE *dest, double seconds);
+
+#endif
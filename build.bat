@@ -3,6 +3,6 @@
 mkdir .\build
 pushd .\build
 
-cl -Zi ..\sim86.c ..\simulator.c ..\decoder.c ..\printer.c ..\main.c
+cl -Zi ..\sim86.c ..\simulator.c ..\decoder.c ..\micro_op.c ..\disassembler.c ..\decode_output.c ..\cfg.c ..\printer.c ..\text_writer.c ..\heatmap.c ..\profiler.c ..\port_io.c ..\debugger.c ..\gdbstub.c ..\replay.c ..\snapshot.c ..\guest_memory.c ..\fork_server.c ..\fuzzer.c ..\decoder_fuzz.c ..\batch.c ..\live_view.c ..\dump.c ..\libsim86.c ..\main.c
 
 popd .\build
\ No newline at end of file
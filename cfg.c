@@ -0,0 +1,562 @@
+#include "cfg.h"
+#include "printer.h"
+
+static const char *edge_kind_names[] = {
+    [Cfg_Edge_Taken]       = "taken",
+    [Cfg_Edge_Fallthrough] = "fallthrough",
+    [Cfg_Edge_Call]        = "call",
+    [Cfg_Edge_Return]      = "return",
+};
+
+static void add_edge(Control_Flow_Graph *cfg, u32 from, u32 to, Cfg_Edge_Kind kind)
+{
+    if (to == CFG_NO_BLOCK) {
+        return;
+    }
+
+    if (cfg->edge_count == cfg->edge_capacity) {
+        cfg->edge_capacity = cfg->edge_capacity ? cfg->edge_capacity * 2 : 1024;
+        cfg->edges = (Cfg_Edge *)realloc(cfg->edges, cfg->edge_capacity * sizeof(Cfg_Edge));
+        assert(cfg->edges != NULL);
+    }
+
+    Cfg_Edge *edge = &cfg->edges[cfg->edge_count++];
+    edge->from = from;
+    edge->to = to;
+    edge->kind = kind;
+}
+
+static int compare_edges(const void *a, const void *b)
+{
+    const Cfg_Edge *left = (const Cfg_Edge *)a;
+    const Cfg_Edge *right = (const Cfg_Edge *)b;
+
+    if (left->from != right->from) return (left->from > right->from) - (left->from < right->from);
+    if (left->kind != right->kind) return (left->kind > right->kind) - (left->kind < right->kind);
+    return (left->to > right->to) - (left->to < right->to);
+}
+
+u32 cfg_block_at(Control_Flow_Graph *cfg, u32 address)
+{
+    u32 low = 0;
+    u32 high = cfg->block_count;
+
+    while (low < high) {
+        u32 middle = low + (high - low) / 2;
+        if (cfg->blocks[middle].start < address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return (low < cfg->block_count && cfg->blocks[low].start == address) ? low : CFG_NO_BLOCK;
+}
+
+static Decoded_Instruction *last_instruction(Control_Flow_Graph *cfg, Cfg_Block *block)
+{
+    return &cfg->disassembly->instructions[block->first_instruction + block->instruction_count - 1];
+}
+
+static void build_blocks(Control_Flow_Graph *cfg)
+{
+    Disassembly *disassembly = cfg->disassembly;
+
+    // At most one block per instruction
+    cfg->blocks = (Cfg_Block *)calloc(disassembly->instruction_count ? disassembly->instruction_count : 1, sizeof(Cfg_Block));
+    assert(cfg->blocks != NULL);
+
+    Cfg_Block *block = NULL;
+
+    for (u32 i = 0; i < disassembly->instruction_count; i++) {
+        Decoded_Instruction *decoded = &disassembly->instructions[i];
+
+        u8 leader = block == NULL || block->end != decoded->address ||
+                    last_instruction(cfg, block)->flow != Flow_Next ||
+                    (disassembly->kinds[decoded->address - disassembly->start] & Byte_Jump_Target);
+
+        if (leader) {
+            block = &cfg->blocks[cfg->block_count++];
+            block->start = decoded->address;
+            block->first_instruction = i;
+            block->function = CFG_NO_BLOCK;
+            block->idom = CFG_NO_BLOCK;
+        }
+
+        block->end = decoded->address + decoded->size;
+        block->instruction_count++;
+    }
+}
+
+static void build_edges(Control_Flow_Graph *cfg)
+{
+    for (u32 b = 0; b < cfg->block_count; b++) {
+        Cfg_Block *block = &cfg->blocks[b];
+        Decoded_Instruction *last = last_instruction(cfg, block);
+
+        u32 next = (b + 1 < cfg->block_count && cfg->blocks[b + 1].start == block->end) ? b + 1 : CFG_NO_BLOCK;
+        u32 target = last->target == DISASSEMBLY_NO_TARGET ? CFG_NO_BLOCK : cfg_block_at(cfg, last->target);
+
+        switch (last->flow) {
+            case Flow_Next:
+                add_edge(cfg, b, next, Cfg_Edge_Fallthrough);
+                break;
+            case Flow_Branch:
+                add_edge(cfg, b, target, Cfg_Edge_Taken);
+                add_edge(cfg, b, next, Cfg_Edge_Fallthrough);
+                break;
+            case Flow_Jump:
+                add_edge(cfg, b, target, Cfg_Edge_Taken);
+                break;
+            case Flow_Call:
+                add_edge(cfg, b, target, Cfg_Edge_Call);
+                add_edge(cfg, b, next, Cfg_Edge_Fallthrough);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// The functions claim their blocks in address order of their entries, the entry of the
+// program first, a block reached from two functions stays with the first one
+static void assign_functions(Control_Flow_Graph *cfg)
+{
+    u32 *worklist = (u32 *)malloc((cfg->block_count + 1) * sizeof(u32));
+    assert(worklist != NULL);
+
+    cfg->blocks[0].function = 0;
+    for (u32 e = 0; e < cfg->edge_count; e++) {
+        if (cfg->edges[e].kind == Cfg_Edge_Call) {
+            cfg->blocks[cfg->edges[e].to].function = cfg->edges[e].to;
+        }
+    }
+
+    for (u32 entry = 0; entry < cfg->block_count; entry++) {
+        if (cfg->blocks[entry].function != entry) {
+            continue;
+        }
+        cfg->function_count++;
+
+        u32 count = 0;
+        worklist[count++] = entry;
+
+        while (count) {
+            Cfg_Block *block = &cfg->blocks[worklist[--count]];
+
+            for (u32 e = block->edge_start; e < block->edge_start + block->edge_count; e++) {
+                Cfg_Edge *edge = &cfg->edges[e];
+                if ((edge->kind == Cfg_Edge_Taken || edge->kind == Cfg_Edge_Fallthrough) &&
+                    cfg->blocks[edge->to].function == CFG_NO_BLOCK) {
+                    cfg->blocks[edge->to].function = entry;
+                    worklist[count++] = edge->to;
+                }
+            }
+        }
+    }
+
+    free(worklist);
+}
+
+// Sorts the edges by their source and points the blocks at their range
+static void index_edges(Control_Flow_Graph *cfg)
+{
+    qsort(cfg->edges, cfg->edge_count, sizeof(Cfg_Edge), compare_edges);
+
+    for (u32 b = 0; b < cfg->block_count; b++) {
+        cfg->blocks[b].edge_start = 0;
+        cfg->blocks[b].edge_count = 0;
+    }
+
+    for (u32 e = cfg->edge_count; e-- > 0;) {
+        Cfg_Block *block = &cfg->blocks[cfg->edges[e].from];
+        block->edge_start = e;
+        block->edge_count++;
+    }
+}
+
+static void add_return_edges(Control_Flow_Graph *cfg)
+{
+    u32 edge_count = cfg->edge_count;
+
+    for (u32 e = 0; e < edge_count; e++) {
+        if (cfg->edges[e].kind != Cfg_Edge_Call) {
+            continue;
+        }
+
+        u32 caller = cfg->edges[e].from;
+        u32 callee = cfg->edges[e].to;
+
+        u32 return_site = CFG_NO_BLOCK;
+        Cfg_Block *block = &cfg->blocks[caller];
+        for (u32 s = block->edge_start; s < block->edge_start + block->edge_count; s++) {
+            if (cfg->edges[s].kind == Cfg_Edge_Fallthrough) {
+                return_site = cfg->edges[s].to;
+            }
+        }
+
+        if (return_site == CFG_NO_BLOCK) {
+            continue;
+        }
+
+        for (u32 b = 0; b < cfg->block_count; b++) {
+            if (cfg->blocks[b].function == callee && last_instruction(cfg, &cfg->blocks[b])->flow == Flow_Return) {
+                add_edge(cfg, b, return_site, Cfg_Edge_Return);
+            }
+        }
+    }
+
+    index_edges(cfg);
+}
+
+// Cooper, Harvey and Kennedy: "A Simple, Fast Dominance Algorithm"
+static void compute_dominators(Control_Flow_Graph *cfg)
+{
+    u32 count = cfg->block_count;
+
+    u32 *postorder = (u32 *)malloc(count * sizeof(u32));  // blocks in postorder
+    u32 *number = (u32 *)malloc(count * sizeof(u32));     // postorder number of a block
+    u32 *stack = (u32 *)malloc(count * sizeof(u32));
+    u32 *next_edge = (u32 *)malloc(count * sizeof(u32));
+    assert(postorder != NULL && number != NULL && stack != NULL && next_edge != NULL);
+
+    // The predecessors, without the return edges
+    u32 *pred_start = (u32 *)calloc(count + 1, sizeof(u32));
+    u32 *preds = (u32 *)malloc((cfg->edge_count ? cfg->edge_count : 1) * sizeof(u32));
+    assert(pred_start != NULL && preds != NULL);
+
+    for (u32 e = 0; e < cfg->edge_count; e++) {
+        if (cfg->edges[e].kind != Cfg_Edge_Return) {
+            pred_start[cfg->edges[e].to + 1]++;
+        }
+    }
+    for (u32 b = 0; b < count; b++) {
+        pred_start[b + 1] += pred_start[b];
+    }
+    for (u32 e = 0; e < cfg->edge_count; e++) {
+        if (cfg->edges[e].kind != Cfg_Edge_Return) {
+            preds[pred_start[cfg->edges[e].to]++] = cfg->edges[e].from;
+        }
+    }
+    for (u32 b = count; b > 0; b--) {
+        pred_start[b] = pred_start[b - 1];
+    }
+    pred_start[0] = 0;
+
+    // Iterative depth first search from the entry
+    for (u32 b = 0; b < count; b++) {
+        number[b] = CFG_NO_BLOCK;
+        next_edge[b] = cfg->blocks[b].edge_start;
+    }
+
+    u32 visited = 0;
+    u32 depth = 0;
+    stack[depth++] = 0;
+    number[0] = 0; // on the stack, renumbered when it is finished
+
+    while (depth) {
+        u32 b = stack[depth - 1];
+        Cfg_Block *block = &cfg->blocks[b];
+
+        if (next_edge[b] < block->edge_start + block->edge_count) {
+            Cfg_Edge *edge = &cfg->edges[next_edge[b]++];
+            if (edge->kind != Cfg_Edge_Return && number[edge->to] == CFG_NO_BLOCK) {
+                number[edge->to] = 0;
+                stack[depth++] = edge->to;
+            }
+            continue;
+        }
+
+        depth--;
+        number[b] = visited;
+        postorder[visited++] = b;
+    }
+
+    cfg->blocks[0].idom = 0;
+
+    u8 changed = 1;
+    while (changed) {
+        changed = 0;
+
+        // Reverse postorder, the entry is the last one
+        for (u32 i = visited - 1; i-- > 0;) {
+            u32 b = postorder[i];
+            u32 idom = CFG_NO_BLOCK;
+
+            for (u32 p = pred_start[b]; p < pred_start[b + 1]; p++) {
+                u32 pred = preds[p];
+                if (cfg->blocks[pred].idom == CFG_NO_BLOCK) {
+                    continue;
+                }
+
+                if (idom == CFG_NO_BLOCK) {
+                    idom = pred;
+                    continue;
+                }
+
+                // Intersect, walking up the tree towards the higher postorder numbers
+                u32 left = pred;
+                u32 right = idom;
+                while (left != right) {
+                    while (number[left] < number[right]) left = cfg->blocks[left].idom;
+                    while (number[right] < number[left]) right = cfg->blocks[right].idom;
+                }
+                idom = left;
+            }
+
+            if (cfg->blocks[b].idom != idom) {
+                cfg->blocks[b].idom = idom;
+                changed = 1;
+            }
+        }
+    }
+
+    cfg->blocks[0].idom = CFG_NO_BLOCK;
+
+    free(pred_start);
+    free(preds);
+    free(next_edge);
+    free(stack);
+    free(number);
+    free(postorder);
+}
+
+static u8 dominates(Control_Flow_Graph *cfg, u32 dominator, u32 block)
+{
+    while (block != CFG_NO_BLOCK) {
+        if (block == dominator) {
+            return 1;
+        }
+        block = cfg->blocks[block].idom;
+    }
+    return 0;
+}
+
+static void find_loops(Control_Flow_Graph *cfg)
+{
+    u32 count = cfg->block_count;
+
+    u32 *loop_of_header = (u32 *)malloc(count * sizeof(u32));
+    u8 *in_loop = (u8 *)malloc(count);
+    u32 *worklist = (u32 *)malloc(count * sizeof(u32));
+    assert(loop_of_header != NULL && in_loop != NULL && worklist != NULL);
+
+    for (u32 b = 0; b < count; b++) {
+        loop_of_header[b] = CFG_NO_BLOCK;
+    }
+
+    // The back edges, grouped by their header
+    for (u32 e = 0; e < cfg->edge_count; e++) {
+        Cfg_Edge *edge = &cfg->edges[e];
+        if ((edge->kind != Cfg_Edge_Taken && edge->kind != Cfg_Edge_Fallthrough) || !dominates(cfg, edge->to, edge->from)) {
+            continue;
+        }
+
+        if (loop_of_header[edge->to] == CFG_NO_BLOCK) {
+            loop_of_header[edge->to] = cfg->loop_count++;
+            cfg->loops = (Cfg_Loop *)realloc(cfg->loops, cfg->loop_count * sizeof(Cfg_Loop));
+            assert(cfg->loops != NULL);
+            memset(&cfg->loops[cfg->loop_count - 1], 0, sizeof(Cfg_Loop));
+            cfg->loops[cfg->loop_count - 1].header = edge->to;
+        }
+
+        Cfg_Loop *loop = &cfg->loops[loop_of_header[edge->to]];
+        loop->latches = (u32 *)realloc(loop->latches, (loop->latch_count + 1) * sizeof(u32));
+        assert(loop->latches != NULL);
+        loop->latches[loop->latch_count++] = edge->from;
+    }
+
+    // The predecessors through the taken and fallthrough edges, the body is everything which
+    // reaches a latch without passing the header
+    u32 *pred_start = (u32 *)calloc(count + 1, sizeof(u32));
+    u32 *preds = (u32 *)malloc((cfg->edge_count ? cfg->edge_count : 1) * sizeof(u32));
+    assert(pred_start != NULL && preds != NULL);
+
+    for (u32 e = 0; e < cfg->edge_count; e++) {
+        u8 kind = cfg->edges[e].kind;
+        if (kind == Cfg_Edge_Taken || kind == Cfg_Edge_Fallthrough) {
+            pred_start[cfg->edges[e].to + 1]++;
+        }
+    }
+    for (u32 b = 0; b < count; b++) {
+        pred_start[b + 1] += pred_start[b];
+    }
+    u32 *fill = (u32 *)malloc((count + 1) * sizeof(u32));
+    assert(fill != NULL);
+    memcpy(fill, pred_start, (count + 1) * sizeof(u32));
+    for (u32 e = 0; e < cfg->edge_count; e++) {
+        u8 kind = cfg->edges[e].kind;
+        if (kind == Cfg_Edge_Taken || kind == Cfg_Edge_Fallthrough) {
+            preds[fill[cfg->edges[e].to]++] = cfg->edges[e].from;
+        }
+    }
+    free(fill);
+
+    for (u32 l = 0; l < cfg->loop_count; l++) {
+        Cfg_Loop *loop = &cfg->loops[l];
+
+        memset(in_loop, 0, count);
+        in_loop[loop->header] = 1;
+
+        u32 pending = 0;
+        for (u32 i = 0; i < loop->latch_count; i++) {
+            if (!in_loop[loop->latches[i]]) {
+                in_loop[loop->latches[i]] = 1;
+                worklist[pending++] = loop->latches[i];
+            }
+        }
+
+        while (pending) {
+            u32 b = worklist[--pending];
+            for (u32 p = pred_start[b]; p < pred_start[b + 1]; p++) {
+                if (!in_loop[preds[p]]) {
+                    in_loop[preds[p]] = 1;
+                    worklist[pending++] = preds[p];
+                }
+            }
+        }
+
+        for (u32 b = 0; b < count; b++) {
+            loop->block_count += in_loop[b];
+        }
+
+        loop->blocks = (u32 *)malloc((loop->block_count ? loop->block_count : 1) * sizeof(u32));
+        assert(loop->blocks != NULL);
+
+        u32 n = 0;
+        for (u32 b = 0; b < count; b++) {
+            if (in_loop[b]) {
+                loop->blocks[n++] = b;
+                cfg->blocks[b].loop_depth++;
+            }
+        }
+    }
+
+    free(pred_start);
+    free(preds);
+    free(worklist);
+    free(in_loop);
+    free(loop_of_header);
+}
+
+Control_Flow_Graph *cfg_create(CPU *cpu)
+{
+    Control_Flow_Graph *cfg = (Control_Flow_Graph *)calloc(1, sizeof(Control_Flow_Graph));
+    assert(cfg != NULL);
+
+    cfg->disassembly = disassembly_create(cpu);
+
+    build_blocks(cfg);
+    if (cfg->block_count == 0) {
+        return cfg;
+    }
+
+    build_edges(cfg);
+    index_edges(cfg);
+    assign_functions(cfg);
+    add_return_edges(cfg);
+    compute_dominators(cfg);
+    find_loops(cfg);
+
+    return cfg;
+}
+
+void cfg_destroy(Control_Flow_Graph *cfg)
+{
+    for (u32 l = 0; l < cfg->loop_count; l++) {
+        free(cfg->loops[l].latches);
+        free(cfg->loops[l].blocks);
+    }
+    free(cfg->loops);
+    free(cfg->edges);
+    free(cfg->blocks);
+    disassembly_destroy(cfg->disassembly);
+    free(cfg);
+}
+
+static void write_json_block_ref(FILE *fp, u32 block)
+{
+    if (block == CFG_NO_BLOCK) {
+        fprintf(fp, "null");
+    } else {
+        fprintf(fp, "%u", block);
+    }
+}
+
+void cfg_write_json(Control_Flow_Graph *cfg, FILE *fp)
+{
+    fprintf(fp, "{\n  \"entry\": %u,\n  \"functions\": %u,\n  \"blocks\": [", cfg->disassembly->start, cfg->function_count);
+
+    for (u32 b = 0; b < cfg->block_count; b++) {
+        Cfg_Block *block = &cfg->blocks[b];
+        fprintf(fp, "%s\n    {\"id\": %u, \"start\": %u, \"end\": %u, \"instructions\": %u, \"function\": ",
+                b ? "," : "", b, block->start, block->end, block->instruction_count);
+        write_json_block_ref(fp, block->function);
+        fprintf(fp, ", \"idom\": ");
+        write_json_block_ref(fp, block->idom);
+        fprintf(fp, ", \"loop_depth\": %u}", block->loop_depth);
+    }
+
+    fprintf(fp, "\n  ],\n  \"edges\": [");
+
+    for (u32 e = 0; e < cfg->edge_count; e++) {
+        Cfg_Edge *edge = &cfg->edges[e];
+        fprintf(fp, "%s\n    {\"from\": %u, \"to\": %u, \"kind\": \"%s\"}",
+                e ? "," : "", edge->from, edge->to, edge_kind_names[edge->kind]);
+    }
+
+    fprintf(fp, "\n  ],\n  \"loops\": [");
+
+    for (u32 l = 0; l < cfg->loop_count; l++) {
+        Cfg_Loop *loop = &cfg->loops[l];
+        fprintf(fp, "%s\n    {\"header\": %u, \"depth\": %u, \"latches\": [", l ? "," : "", loop->header, cfg->blocks[loop->header].loop_depth);
+        for (u32 i = 0; i < loop->latch_count; i++) {
+            fprintf(fp, i ? ", %u" : "%u", loop->latches[i]);
+        }
+        fprintf(fp, "], \"blocks\": [");
+        for (u32 i = 0; i < loop->block_count; i++) {
+            fprintf(fp, i ? ", %u" : "%u", loop->blocks[i]);
+        }
+        fprintf(fp, "]}");
+    }
+
+    fprintf(fp, "\n  ]\n}\n");
+}
+
+void cfg_write_dot(Control_Flow_Graph *cfg, FILE *fp)
+{
+    static const char *edge_styles[] = {
+        [Cfg_Edge_Taken]       = "color=darkgreen",
+        [Cfg_Edge_Fallthrough] = "color=black",
+        [Cfg_Edge_Call]        = "color=blue",
+        [Cfg_Edge_Return]      = "color=gray, style=dashed",
+    };
+
+    fprintf(fp, "digraph cfg {\n    node [shape=box, fontname=\"monospace\"];\n");
+
+    for (u32 b = 0; b < cfg->block_count; b++) {
+        Cfg_Block *block = &cfg->blocks[b];
+
+        // The instructions are left aligned lines, the loop headers are drawn bold
+        fprintf(fp, "    b%u [label=\"block %u, loop depth %u\\l", b, b, block->loop_depth);
+        for (u32 i = 0; i < block->instruction_count; i++) {
+            fprint_instruction(fp, &cfg->disassembly->instructions[block->first_instruction + i].instruction, 0);
+            fprintf(fp, "\\l");
+        }
+        fprintf(fp, "\"");
+
+        for (u32 l = 0; l < cfg->loop_count; l++) {
+            if (cfg->loops[l].header == b) {
+                fprintf(fp, ", penwidth=3");
+            }
+        }
+        fprintf(fp, "];\n");
+    }
+
+    for (u32 e = 0; e < cfg->edge_count; e++) {
+        Cfg_Edge *edge = &cfg->edges[e];
+        fprintf(fp, "    b%u -> b%u [label=\"%s\", %s];\n", edge->from, edge->to, edge_kind_names[edge->kind], edge_styles[edge->kind]);
+    }
+
+    fprintf(fp, "}\n");
+}
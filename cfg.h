@@ -0,0 +1,85 @@
+#ifndef _H_CFG
+#define _H_CFG
+
+#include "sim86.h"
+#include "disassembler.h"
+
+// Control-flow graph on top of the recursive disassembly, without executing the program:
+//
+//   --cfg <file>       basic blocks, edges, dominators and loops as JSON
+//   --cfg-dot <file>   the same graph for Graphviz (dot -Tsvg file > cfg.svg)
+//
+// A block starts at the entry, at a jump or call target and after a jump, call, return or
+// hlt, it is only entered at its first instruction. The calls end their block, the callee
+// gets a call edge and the return site a fallthrough edge, the returns of a function go back
+// to the return sites of its callers. A function is the blocks reached from its entry (cs:ip
+// or a call target) through the taken and fallthrough edges.
+//
+// The dominators are computed from the entry over every edge except the returns (the call
+// already leads to its return site), a loop is the natural loop of the back edges to a
+// header which dominates their source, the back edges to the same header are one loop.
+
+#define CFG_NO_BLOCK 0xFFFFFFFF
+
+typedef enum {
+    Cfg_Edge_Taken,       // conditional or unconditional jump to a direct target
+    Cfg_Edge_Fallthrough, // the next block, also the return site after a call
+    Cfg_Edge_Call,        // to the entry of the callee
+    Cfg_Edge_Return,      // from a return of the callee to the return site
+} Cfg_Edge_Kind;
+
+typedef struct {
+    u32 from;
+    u32 to;
+    u8 kind; // Cfg_Edge_Kind
+} Cfg_Edge;
+
+typedef struct {
+    u32 start; // absolute
+    u32 end;   // absolute, exclusive
+    u32 first_instruction; // index into disassembly->instructions
+    u32 instruction_count;
+
+    u32 function;   // the block index of the function entry
+    u32 idom;       // immediate dominator, CFG_NO_BLOCK for the entry
+    u32 loop_depth; // the number of loops which contain the block
+
+    u32 edge_start; // its successors are edges[edge_start, edge_start + edge_count)
+    u32 edge_count;
+} Cfg_Block;
+
+typedef struct {
+    u32 header;
+    u32 *latches; // the sources of the back edges
+    u32 latch_count;
+    u32 *blocks;  // in block order, the header included
+    u32 block_count;
+} Cfg_Loop;
+
+typedef struct {
+    Disassembly *disassembly;
+
+    Cfg_Block *blocks; // in address order, the entry is the first one
+    u32 block_count;
+
+    Cfg_Edge *edges; // grouped by the source block
+    u32 edge_count;
+    u32 edge_capacity;
+
+    Cfg_Loop *loops;
+    u32 loop_count;
+
+    u32 function_count;
+} Control_Flow_Graph;
+
+// Disassembles the loaded program, the registers and the memory are not changed
+Control_Flow_Graph *cfg_create(CPU *cpu);
+void cfg_destroy(Control_Flow_Graph *cfg);
+
+// Returns the block which starts at the absolute address or CFG_NO_BLOCK
+u32 cfg_block_at(Control_Flow_Graph *cfg, u32 address);
+
+void cfg_write_json(Control_Flow_Graph *cfg, FILE *fp);
+void cfg_write_dot(Control_Flow_Graph *cfg, FILE *fp);
+
+#endif
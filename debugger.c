@@ -0,0 +1,292 @@
+#include "debugger.h"
+#include "decoder.h"
+#include "printer.h"
+#include "simulator.h"
+#include "replay.h"
+
+#define DEBUGGER_PROMPT "(sim86) "
+
+Debugger *debugger_create(void)
+{
+    Debugger *debugger = (Debugger *)calloc(1, sizeof(Debugger));
+    assert(debugger != NULL);
+
+    debugger->until_address = MAX_MEMORY;
+
+    // Stop before the first instruction like the old step by step debug mode
+    debugger->stop_requested = 1;
+
+    return debugger;
+}
+
+void debugger_destroy(Debugger *debugger)
+{
+    free(debugger);
+}
+
+void debugger_watch_hit(CPU *cpu, u32 address, u32 size, u8 kind)
+{
+    Debugger *debugger = cpu->debugger;
+
+    debugger->stop_requested = 1;
+    debugger->watch_hit_address = address;
+    debugger->watch_hit_kind = kind;
+}
+
+// Accepts an absolute hex address (f0100) or a segment:offset pair (f000:0100)
+static u8 parse_address(const char *text, u32 *address)
+{
+    if (text == NULL) {
+        return 0;
+    }
+
+    char *end = NULL;
+    u32 value = strtoul(text, &end, 16);
+    if (end == text) {
+        return 0;
+    }
+
+    if (*end == ':') {
+        const char *offset_text = end + 1;
+        u32 offset = strtoul(offset_text, &end, 16);
+        if (end == offset_text) {
+            return 0;
+        }
+
+        value = (value << 4) + offset;
+    }
+
+    if (*end != '\0') {
+        return 0;
+    }
+
+    *address = value & (MAX_MEMORY - 1);
+    return 1;
+}
+
+// The pages are flagged if any byte is watched in them. A word access starting on the
+// last byte of the previous page reaches into the next one, so that page is flagged too.
+static void update_watch_page_flags(CPU *cpu, u32 page)
+{
+    Debugger *debugger = cpu->debugger;
+
+    u8 flags = 0;
+    u32 first = page * MEMORY_PAGE_SIZE;
+    for (u32 address = first; address < first + MEMORY_PAGE_SIZE + 1 && address < MAX_MEMORY; address++) {
+        flags |= debugger->watchpoints[address];
+    }
+
+    cpu->page_flags[page] &= ~(Page_Watch_Read|Page_Watch_Write);
+    cpu->page_flags[page] |= flags;
+}
+
+void debugger_set_watchpoint(CPU *cpu, u32 address, u8 kind)
+{
+    cpu->debugger->watchpoints[address] = kind;
+
+    u32 page = address >> MEMORY_PAGE_SHIFT;
+    update_watch_page_flags(cpu, page);
+    if ((address & (MEMORY_PAGE_SIZE - 1)) == 0 && page > 0) {
+        update_watch_page_flags(cpu, page - 1);
+    }
+}
+
+static void print_registers(CPU *cpu)
+{
+    static const Register registers[] = {
+        Register_ax, Register_bx, Register_cx, Register_dx,
+        Register_sp, Register_bp, Register_si, Register_di,
+        Register_es, Register_cs, Register_ss, Register_ds
+    };
+
+    for (u32 i = 0; i < ARRAY_SIZE(registers); i++) {
+        u16 value = get_data_from_register(cpu, register_access_by_enum(registers[i]));
+        printf("%s: %04x%s", register_name(registers[i]), value, (i % 4) == 3 ? "\n" : "  ");
+    }
+
+    printf("ip: %04x  flags:", cpu->ip);
+    print_flags(cpu->flags);
+    printf("\ninstructions: %lu  cycles: %lu\n", cpu->stats.instructions, cpu->stats.cycles);
+}
+
+static void print_memory(CPU *cpu, u32 address, u32 count)
+{
+    for (u32 i = 0; i < count; i++) {
+        if ((i % 16) == 0) {
+            printf("%s%05X:", i ? "\n" : "", (address + i) & (MAX_MEMORY - 1));
+        }
+        printf(" %02x", cpu->memory[(address + i) & (MAX_MEMORY - 1)]);
+    }
+    printf("\n");
+}
+
+static void print_next_instruction(CPU *cpu)
+{
+    // Decode on a copy, so the prefixes and the decoder state of the real cpu are untouched
+    CPU scratch = *cpu;
+    decode_next_instruction(&scratch);
+
+    printf("=> ");
+    print_instruction(&scratch, 1);
+}
+
+static void print_help(void)
+{
+    printf("commands: <enter> | s[tep] [n] | c[ontinue] | u[ntil] <addr> | b[reak] <addr> | d[elete] <addr>\n");
+    printf("          w[atch] [r|w|rw] <addr> | unwatch <addr> | r[egs] | x <addr> [n] | q[uit]\n");
+    printf("          rs | reverse-step [n] | rc | reverse-continue | seek <n>  (with --record)\n");
+}
+
+static void print_stop(CPU *cpu)
+{
+    Debugger *debugger = cpu->debugger;
+    u32 address = calc_inst_pointer_address(cpu);
+
+    if (debugger->watch_hit_kind) {
+        printf("\n[DEBUG]: %s watchpoint hit at %05X\n",
+               debugger->watch_hit_kind == Page_Watch_Read ? "read" : "write", debugger->watch_hit_address);
+        debugger->watch_hit_kind = 0;
+    } else if (debugger->breakpoints[address >> 3] & (1 << (address & 7))) {
+        printf("\n[DEBUG]: breakpoint at %05X\n", address);
+    }
+
+    print_next_instruction(cpu);
+}
+
+u8 debugger_prompt(CPU *cpu)
+{
+    Debugger *debugger = cpu->debugger;
+
+    debugger->stop_requested = 0;
+    debugger->steps_left = 0;
+    debugger->until_address = MAX_MEMORY;
+
+    print_stop(cpu);
+
+    char input[128];
+    for (;;) {
+        printf(DEBUGGER_PROMPT);
+        fflush(stdout);
+
+        if (fgets(input, sizeof(input), stdin) == NULL) {
+            return 0;
+        }
+
+        char *token_state = NULL;
+        char *command = strtok_r(input, " \t\n", &token_state);
+        char *arg1 = strtok_r(NULL, " \t\n", &token_state);
+        char *arg2 = strtok_r(NULL, " \t\n", &token_state);
+
+        if (command == NULL) {
+            debugger->steps_left = 1;
+            return 1;
+        }
+
+        u32 arg_address = 0;
+
+        if (STR_EQUAL(command, "q") || STR_EQUAL(command, "quit") || STR_EQUAL(command, "exit")) {
+            return 0;
+        }
+        else if (STR_EQUAL(command, "s") || STR_EQUAL(command, "step")) {
+            u64 count = arg1 ? strtoul(arg1, NULL, 10) : 1;
+            debugger->steps_left = count ? count : 1;
+            return 1;
+        }
+        else if (STR_EQUAL(command, "c") || STR_EQUAL(command, "continue")) {
+            return 1;
+        }
+        else if (STR_EQUAL(command, "u") || STR_EQUAL(command, "until")) {
+            if (!parse_address(arg1, &arg_address)) {
+                printf("[ERROR]: until <addr>\n");
+                continue;
+            }
+            debugger->until_address = arg_address;
+            return 1;
+        }
+        else if (STR_EQUAL(command, "b") || STR_EQUAL(command, "break")) {
+            if (!parse_address(arg1, &arg_address)) {
+                printf("[ERROR]: break <addr>\n");
+                continue;
+            }
+            debugger->breakpoints[arg_address >> 3] |= (1 << (arg_address & 7));
+            printf("breakpoint at %05X\n", arg_address);
+        }
+        else if (STR_EQUAL(command, "d") || STR_EQUAL(command, "delete")) {
+            if (!parse_address(arg1, &arg_address)) {
+                printf("[ERROR]: delete <addr>\n");
+                continue;
+            }
+            debugger->breakpoints[arg_address >> 3] &= ~(1 << (arg_address & 7));
+        }
+        else if (STR_EQUAL(command, "w") || STR_EQUAL(command, "watch")) {
+            u8 kind = Page_Watch_Write;
+            char *address_text = arg1;
+
+            if (arg1 && arg2) {
+                address_text = arg2;
+                if      (STR_EQUAL(arg1, "r"))  kind = Page_Watch_Read;
+                else if (STR_EQUAL(arg1, "w"))  kind = Page_Watch_Write;
+                else if (STR_EQUAL(arg1, "rw")) kind = Page_Watch_Read|Page_Watch_Write;
+                else                            address_text = NULL;
+            }
+
+            if (!parse_address(address_text, &arg_address)) {
+                printf("[ERROR]: watch [r|w|rw] <addr>\n");
+                continue;
+            }
+            debugger_set_watchpoint(cpu, arg_address, kind);
+            printf("watchpoint at %05X\n", arg_address);
+        }
+        else if (STR_EQUAL(command, "unwatch")) {
+            if (!parse_address(arg1, &arg_address)) {
+                printf("[ERROR]: unwatch <addr>\n");
+                continue;
+            }
+            debugger_set_watchpoint(cpu, arg_address, 0);
+        }
+        else if (STR_EQUAL(command, "r") || STR_EQUAL(command, "regs")) {
+            print_registers(cpu);
+        }
+        else if (STR_EQUAL(command, "x")) {
+            if (!parse_address(arg1, &arg_address)) {
+                printf("[ERROR]: x <addr> [n]\n");
+                continue;
+            }
+            print_memory(cpu, arg_address, arg2 ? strtoul(arg2, NULL, 10) : 16);
+        }
+        else if (STR_EQUAL(command, "rs") || STR_EQUAL(command, "reverse-step") ||
+                 STR_EQUAL(command, "rc") || STR_EQUAL(command, "reverse-continue") ||
+                 STR_EQUAL(command, "seek")) {
+            if (cpu->replay == NULL) {
+                printf("[ERROR]: The execution is not recorded, start with --record\n");
+                continue;
+            }
+
+            u64 current = cpu->stats.instructions;
+
+            if (STR_EQUAL(command, "seek")) {
+                if (arg1 == NULL) {
+                    printf("[ERROR]: seek <instruction number>\n");
+                    continue;
+                }
+                replay_seek(cpu, strtoull(arg1, NULL, 10));
+            }
+            else if (STR_EQUAL(command, "rc") || STR_EQUAL(command, "reverse-continue")) {
+                if (!replay_reverse_continue(cpu)) {
+                    printf("\n[DEBUG]: reached the start of the recording\n");
+                }
+            }
+            else {
+                u64 count = arg1 ? strtoul(arg1, NULL, 10) : 1;
+                count = count ? count : 1;
+                replay_seek(cpu, current > count ? current - count : 0);
+            }
+
+            printf("instruction: %lu\n", cpu->stats.instructions);
+            print_stop(cpu);
+        }
+        else {
+            print_help();
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef _H_DEBUGGER
+#define _H_DEBUGGER
+
+#include "sim86.h"
+
+// Commands at the (sim86) prompt, the addresses are absolute hex (f0100) or segment:offset (f000:0100):
+//
+//   <enter>, s, step [n]     execute 1 or n instructions
+//   c, continue              run until a breakpoint or a watchpoint hits
+//   u, until <addr>          run until the instruction at addr
+//   b, break <addr>          set an execution breakpoint
+//   d, delete <addr>         delete an execution breakpoint
+//   w, watch [r|w|rw] <addr> set a read and/or write watchpoint on one byte (default: w)
+//   unwatch <addr>           delete the watchpoint
+//   r, regs                  print the registers
+//   x <addr> [n]             dump n bytes of memory
+//   q, exit                  stop the simulation
+//
+// With --record the execution can go backwards too:
+//
+//   rs, reverse-step [n]     go back 1 or n instructions
+//   rc, reverse-continue     go back to the last breakpoint or watchpoint hit
+//   seek <n>                 go to the state before the nth instruction
+
+struct Debugger {
+    u8 breakpoints[MAX_MEMORY / 8]; // one bit for every address
+    u8 watchpoints[MAX_MEMORY];     // Page_Watch_Read/Page_Watch_Write bits for every address
+
+    u8 stop_requested;
+    u64 steps_left;     // 0 if we're not stepping
+    u32 until_address;  // MAX_MEMORY if there is no temporary breakpoint
+
+    u32 watch_hit_address;
+    u8 watch_hit_kind;
+};
+
+Debugger *debugger_create(void);
+void debugger_destroy(Debugger *debugger);
+
+// Returns 0 if the user wants to stop the simulation
+u8 debugger_prompt(CPU *cpu);
+void debugger_watch_hit(CPU *cpu, u32 address, u32 size, u8 kind);
+void debugger_set_watchpoint(CPU *cpu, u32 address, u8 kind);
+
+// Called before every instruction, this has to be cheap, so between two stops the guest runs at full speed
+static inline u8 debugger_should_stop(Debugger *debugger, u32 address)
+{
+    if (debugger->stop_requested) {
+        return 1;
+    }
+
+    if (debugger->steps_left && --debugger->steps_left == 0) {
+        return 1;
+    }
+
+    if (debugger->breakpoints[address >> 3] & (1 << (address & 7))) {
+        return 1;
+    }
+
+    return address == debugger->until_address;
+}
+
+// Called by the memory accessors only if the page of the address is marked as watched
+static inline void debugger_check_watch(CPU *cpu, u32 address, u32 size, u8 kind)
+{
+    Debugger *debugger = cpu->debugger;
+    for (u32 i = 0; i < size; i++) {
+        if (debugger->watchpoints[(address + i) & (MAX_MEMORY - 1)] & kind) {
+            debugger_watch_hit(cpu, address, size, kind);
+            return;
+        }
+    }
+}
+
+#endif
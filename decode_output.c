@@ -0,0 +1,251 @@
+#include "decode_output.h"
+#include "printer.h"
+
+static const char *decode_format_names[] = {
+    [Decode_Format_Text]   = "text",
+    [Decode_Format_Jsonl]  = "jsonl",
+    [Decode_Format_Binary] = "binary",
+};
+
+static const char *operand_kind_names[] = {
+    [Operand_None]               = "none",
+    [Operand_Memory]             = "memory",
+    [Operand_Register]           = "register",
+    [Operand_Immediate]          = "immediate",
+    [Operand_Relative_Immediate] = "relative",
+};
+
+u8 decode_format_parse(const char *name, Decode_Format *format)
+{
+    for (u32 i = 0; i < ARRAY_SIZE(decode_format_names); i++) {
+        if (STR_EQUAL(name, decode_format_names[i])) {
+            *format = (Decode_Format)i;
+            return 1;
+        }
+    }
+
+    printf("\n[ERROR]: Unknown decode format %s, it is text, jsonl or binary.\n", name);
+    return 0;
+}
+
+u32 format_decode_header(char *dest, Decode_Format format)
+{
+    static_assert(sizeof(Decode_File_Header) == DECODE_RECORD_SIZE, "the header keeps the records aligned");
+
+    switch (format) {
+        case Decode_Format_Text: {
+            return append_string(dest, "bits 16\n\n") - dest;
+        }
+        case Decode_Format_Binary: {
+            Decode_File_Header header = {0};
+            memcpy(header.magic, DECODE_FILE_MAGIC, sizeof(DECODE_FILE_MAGIC));
+            header.version = DECODE_FILE_VERSION;
+            header.header_size = sizeof(Decode_File_Header);
+            header.record_size = DECODE_RECORD_SIZE;
+
+            memcpy(dest, &header, sizeof(header));
+            return sizeof(header);
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+static Register operand_register(Instruction_Operand *op)
+{
+    return register_access(op->reg, op->flags)->reg;
+}
+
+static u32 format_record(char *dest, Instruction *instruction, u32 address, u32 size, const u8 *bytes)
+{
+    static_assert(sizeof(Decode_Record) == DECODE_RECORD_SIZE, "the records have a fixed size");
+
+    Decode_Record record = {0};
+    record.address = address;
+    record.opcode_address = instruction->mem_address;
+    record.size = size;
+    record.mnemonic = instruction->mnemonic;
+    record.flags = instruction->flags;
+    record.segment = instruction->extend_with_this_segment;
+    record.type = instruction->type;
+
+    if (bytes) {
+        memcpy(record.bytes, bytes, size < DECODE_RECORD_MAX_BYTES ? size : DECODE_RECORD_MAX_BYTES);
+    }
+
+    for (u32 i = 0; i < 2; i++) {
+        Instruction_Operand *op = &instruction->operands[i];
+        Decode_Record_Operand *out = &record.operands[i];
+
+        out->type = op->type;
+        out->reg = Register_none;
+        out->flags = op->flags;
+
+        switch (op->type) {
+            case Operand_Register: {
+                out->reg = operand_register(op);
+                break;
+            }
+            case Operand_Memory: {
+                out->base = op->address.base;
+                out->segment = op->address.segment;
+                out->value = op->address.displacement;
+                break;
+            }
+            case Operand_Immediate:
+            case Operand_Relative_Immediate: {
+                out->value = op->immediate;
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+
+    memcpy(dest, &record, sizeof(record));
+    return sizeof(record);
+}
+
+static char *append_key(char *dest, const char *key)
+{
+    *dest++ = '"';
+    dest = append_string(dest, key);
+    return append_string(dest, "\":");
+}
+
+static char *append_quoted(char *dest, const char *text)
+{
+    *dest++ = '"';
+    dest = append_string(dest, text);
+    *dest++ = '"';
+    return dest;
+}
+
+static u32 format_json(char *dest, Instruction *instruction, u32 address, u32 size, const u8 *bytes)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    char *cursor = dest;
+
+    cursor = append_string(cursor, "{");
+    cursor = append_key(cursor, "address");
+    cursor = append_decimal(cursor, address, 0);
+    cursor = append_string(cursor, ",");
+    cursor = append_key(cursor, "size");
+    cursor = append_decimal(cursor, size, 0);
+
+    cursor = append_string(cursor, ",");
+    cursor = append_key(cursor, "bytes");
+    *cursor++ = '"';
+    if (bytes) {
+        for (u32 i = 0; i < size && i < DECODE_RECORD_MAX_BYTES; i++) {
+            *cursor++ = hex_digits[bytes[i] >> 4];
+            *cursor++ = hex_digits[bytes[i] & 0xF];
+        }
+    }
+    *cursor++ = '"';
+
+    cursor = append_string(cursor, ",");
+    cursor = append_key(cursor, "mnemonic");
+    cursor = append_quoted(cursor, mnemonic_name(instruction->mnemonic));
+    cursor = append_string(cursor, ",");
+    cursor = append_key(cursor, "mnemonic_id");
+    cursor = append_decimal(cursor, instruction->mnemonic, 0);
+    cursor = append_string(cursor, ",");
+    cursor = append_key(cursor, "flags");
+    cursor = append_decimal(cursor, instruction->flags, 0);
+
+    cursor = append_string(cursor, ",");
+    cursor = append_key(cursor, "segment");
+    if (instruction->extend_with_this_segment != Register_none) {
+        cursor = append_quoted(cursor, register_name(instruction->extend_with_this_segment));
+    } else {
+        cursor = append_string(cursor, "null");
+    }
+
+    // The NASM text without the address and the end of line, it has no quotes or backslashes
+    char text[INSTRUCTION_TEXT_MAX];
+    u32 length = format_instruction(text, instruction, 0);
+    u32 skip = 9; // "%08X\t"
+    cursor = append_string(cursor, ",");
+    cursor = append_key(cursor, "text");
+    *cursor++ = '"';
+    memcpy(cursor, text + skip, length - skip);
+    cursor += length - skip;
+    *cursor++ = '"';
+
+    cursor = append_string(cursor, ",");
+    cursor = append_key(cursor, "operands");
+    *cursor++ = '[';
+
+    u8 first = 1;
+    for (u32 i = 0; i < 2; i++) {
+        Instruction_Operand *op = &instruction->operands[i];
+        if (op->type == Operand_None) {
+            continue;
+        }
+
+        if (!first) {
+            *cursor++ = ',';
+        }
+        first = 0;
+
+        *cursor++ = '{';
+        cursor = append_key(cursor, "kind");
+        cursor = append_quoted(cursor, operand_kind_names[op->type]);
+
+        switch (op->type) {
+            case Operand_Register: {
+                cursor = append_string(cursor, ",");
+                cursor = append_key(cursor, "register");
+                cursor = append_quoted(cursor, register_name(operand_register(op)));
+                break;
+            }
+            case Operand_Memory: {
+                cursor = append_string(cursor, ",");
+                cursor = append_key(cursor, "base");
+                cursor = append_quoted(cursor, effective_address_name(op->address.base));
+                cursor = append_string(cursor, ",");
+                cursor = append_key(cursor, "displacement");
+                cursor = append_decimal(cursor, op->address.displacement, 0);
+                if ((instruction->flags & Inst_Segment) && instruction->extend_with_this_segment == Register_none) {
+                    cursor = append_string(cursor, ",");
+                    cursor = append_key(cursor, "direct_segment");
+                    cursor = append_decimal(cursor, op->address.segment, 0);
+                }
+                break;
+            }
+            case Operand_Immediate:
+            case Operand_Relative_Immediate: {
+                cursor = append_string(cursor, ",");
+                cursor = append_key(cursor, "value");
+                cursor = append_decimal(cursor, op->immediate, 0);
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+
+        cursor = append_string(cursor, ",");
+        cursor = append_key(cursor, "wide");
+        cursor = append_string(cursor, (op->flags & Inst_Wide) ? "true" : "false");
+        *cursor++ = '}';
+    }
+
+    cursor = append_string(cursor, "]}\n");
+
+    assert(cursor - dest <= DECODE_OUTPUT_MAX);
+    return cursor - dest;
+}
+
+u32 format_decoded(char *dest, Decode_Format format, Instruction *instruction, u32 address, u32 size, const u8 *bytes)
+{
+    switch (format) {
+        case Decode_Format_Jsonl:  return format_json(dest, instruction, address, size, bytes);
+        case Decode_Format_Binary: return format_record(dest, instruction, address, size, bytes);
+        default:                   return format_instruction(dest, instruction, 1);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef _H_DECODE_OUTPUT
+#define _H_DECODE_OUTPUT
+
+#include "sim86.h"
+
+// --decode-format text|jsonl|binary for --decode, --decode-linear and --decode-stream:
+//
+//   text    NASM source, the default
+//   jsonl   one JSON object per instruction:
+//           {"address":983296,"size":2,"bytes":"89de","mnemonic":"mov","mnemonic_id":39,"flags":1,
+//            "segment":null,"text":"mov si, bx","operands":[{"kind":"register","register":"si","wide":true},...]}
+//           an operand is a register, memory (base, displacement and direct_segment for the far
+//           pointers), immediate or relative (value, the offset from the next instruction), with wide
+//   binary  a Decode_File_Header, then one Decode_Record per instruction, native endian, every
+//           record is DECODE_RECORD_SIZE bytes: record i is at (i + 1) * DECODE_RECORD_SIZE
+//
+// The machine readable formats only have the instructions, the data bytes of --decode are left out.
+
+#define DECODE_FILE_MAGIC "S86DIS"
+#define DECODE_FILE_VERSION 1
+#define DECODE_RECORD_SIZE 64
+#define DECODE_RECORD_MAX_BYTES 16 // the raw bytes after these are not stored, the size has all of them
+
+#define DECODE_OUTPUT_MAX 640 // the longest formatted instruction of every format
+
+typedef enum {
+    Decode_Format_Text,
+    Decode_Format_Jsonl,
+    Decode_Format_Binary,
+} Decode_Format;
+
+typedef struct {
+    char magic[8];
+    u32 version;
+    u32 header_size; // DECODE_RECORD_SIZE, the records stay aligned
+    u32 record_size;
+    u8 reserved[DECODE_RECORD_SIZE - 20];
+} Decode_File_Header;
+
+typedef struct {
+    u8 type;      // Operand_Type
+    u8 reg;       // Register of a register operand, Register_none otherwise
+    u8 base;      // Effective_Address_Base of a memory operand
+    u8 reserved;
+    u16 flags;    // Instruction_Flag bits of the operand
+    u16 segment;  // the segment of a far pointer (jmp 61440:256)
+    s32 value;    // the displacement of a memory operand, the immediate of the rest
+} Decode_Record_Operand;
+
+typedef struct {
+    u32 address;        // the first prefix
+    u32 opcode_address;
+    u16 size;           // with the prefixes
+    u16 mnemonic;       // Mneumonic
+    u16 flags;          // Instruction_Flag
+    u8 segment;         // Register of the segment prefix, Register_none without one
+    u8 type;            // Instruction_Type
+    u8 bytes[DECODE_RECORD_MAX_BYTES];
+    Decode_Record_Operand operands[2];
+    u8 reserved[8];
+} Decode_Record;
+
+// Returns 0 and prints an error for an unknown name
+u8 decode_format_parse(const char *name, Decode_Format *format);
+
+// The text before the first instruction: "bits 16" or the Decode_File_Header, returns the length
+u32 format_decode_header(char *dest, Decode_Format format);
+
+// Renders the instruction into dest (DECODE_OUTPUT_MAX bytes), bytes are the size raw bytes from
+// the first prefix, NULL if they aren't at hand (stored as zeros), returns the length
+u32 format_decoded(char *dest, Decode_Format format, Instruction *instruction, u32 address, u32 size, const u8 *bytes);
+
+#endif
@@ -7,24 +7,6 @@ u8 ASMD_NEXT_BYTE(CPU *_d) { return _d->memory[++_d->decoder_cursor]; }
 #define ASMD_NEXT_BYTE_WITHOUT_STEP(_d) _d->memory[_d->decoder_cursor+1]
 #define ASMD_CURR_BYTE_INDEX(_d) _d->decoder_cursor
 
-static Mneumonic extended_mneumonic_lookup[][8] = {
-    [Mneumonic_grp1]  = {Mneumonic_add, Mneumonic_or, Mneumonic_adc, Mneumonic_sbb, Mneumonic_and, Mneumonic_sub, Mneumonic_xor, Mneumonic_cmp},
-    [Mneumonic_grp2]  = {Mneumonic_rol, Mneumonic_ror, Mneumonic_rcl, Mneumonic_rcr, Mneumonic_shl, Mneumonic_shr, Mneumonic_invalid, Mneumonic_sar},
-    [Mneumonic_grp3b] = {Mneumonic_test, Mneumonic_invalid, Mneumonic_not, Mneumonic_neg, Mneumonic_mul, Mneumonic_imul, Mneumonic_div, Mneumonic_idiv},
-    [Mneumonic_grp3a] = {Mneumonic_test, Mneumonic_invalid, Mneumonic_not, Mneumonic_neg, Mneumonic_mul, Mneumonic_imul, Mneumonic_div, Mneumonic_idiv},
-    [Mneumonic_grp4]  = {Mneumonic_inc, Mneumonic_dec, Mneumonic_invalid, Mneumonic_invalid, Mneumonic_invalid, Mneumonic_invalid, Mneumonic_invalid, Mneumonic_invalid},
-    [Mneumonic_grp5]  = {Mneumonic_inc, Mneumonic_dec, Mneumonic_call, Mneumonic_call, Mneumonic_jmp, Mneumonic_jmp, Mneumonic_push, Mneumonic_invalid}
-};
-
-static const char *i8086_inst_ext_table[][8][2] = {
-    [Mneumonic_grp1]  = {{NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}},
-    [Mneumonic_grp2]  = {{NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}},
-    [Mneumonic_grp3a] = {{"Eb", "Ib"}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}},
-    [Mneumonic_grp3b] = {{"Ev", "Iv"}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}},
-    [Mneumonic_grp4]  = {{NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {NULL, NULL}},
-    [Mneumonic_grp5]  = {{NULL, NULL}, {NULL, NULL}, {NULL, NULL}, {"Mp", NULL}, {NULL, NULL}, {"Mp", NULL}, {NULL, NULL}, {NULL, NULL}},
-};
-
 Effective_Address_Base get_address_base(u8 r_m, u8 mod)
 {
     switch (r_m) {
@@ -61,7 +43,8 @@ void decode_memory_address_with_displacement(CPU *cpu, Instruction_Operand *oper
         operand->address.displacement = (u16)(BYTE_LOHI_TO_HILO(ASMD_NEXT_BYTE(cpu), ASMD_NEXT_BYTE(cpu)));
     }
     else if (inst->mod == 0x01) {
-        operand->address.displacement = (u8)ASMD_NEXT_BYTE(cpu);
+        // The 8 bit displacement is sign extended: [bx-25]
+        operand->address.displacement = (s8)ASMD_NEXT_BYTE(cpu);
     }
 }
 
@@ -78,79 +61,39 @@ void mod_reg_rm(CPU *cpu, Instruction *inst)
     }
 }
 
-void decode_arg(CPU *cpu, Instruction_Operand *op, const char *arg)
+static void set_wide(Instruction *inst, Instruction_Operand *op)
 {
-    Instruction *inst = &cpu->instruction;
-
-    if (arg == NULL) {
-        return;
-    }
-
-    if (arg[0] == 'e' || arg[STR_LEN(arg)-1] == 'X' || arg[STR_LEN(arg)-1] == 'I') {
-        inst->flags |= Inst_Wide;
-        op->flags |= Inst_Wide;
-    }
+    inst->flags |= Inst_Wide;
+    op->flags |= Inst_Wide;
+}
 
-    if (STR_EQUAL("AL", arg) || STR_EQUAL("eAX", arg)) {
-        op->type = Operand_Register;
-        op->reg  = 0; // encoded binary value of the reg
-        return;
-    } else if (STR_EQUAL("CL", arg) || STR_EQUAL("eCX", arg)) {
-        op->type = Operand_Register;
-        op->reg  = 1;
-        return;
-    } else if (STR_EQUAL("AH", arg) || STR_EQUAL("eSP", arg)) {
-        op->type = Operand_Register;
-        op->reg  = 4;
-        return;
-    } else if (STR_EQUAL("CH", arg) || STR_EQUAL("eBP", arg)) {
-        op->type = Operand_Register;
-        op->reg  = 5;
-        return;
-    } else if (STR_EQUAL("DL", arg) || STR_EQUAL("eDX", arg) || STR_EQUAL("DX", arg)) {
-        op->type = Operand_Register;
-        op->reg  = 2;
-        return;
-    } else if (STR_EQUAL("DH", arg) || STR_EQUAL("eSI", arg)) {
-        op->type = Operand_Register;
-        op->reg  = 6;
-        return;
-    } else if (STR_EQUAL("BL", arg) || STR_EQUAL("eBX", arg)) {
-        op->type = Operand_Register;
-        op->reg  = 3;
-        return;
-    } else if (STR_EQUAL("BH", arg) || STR_EQUAL("eDI", arg)) {
-        op->type = Operand_Register;
-        op->reg  = 7;
-        return;
-    } else if (STR_EQUAL("CS", arg)) {
-        op->type = Operand_Register;
-        op->flags |= Inst_Segment;
-        op->reg = 1;
-        return;
-    } else if (STR_EQUAL("DS", arg)) {
-        op->type = Operand_Register;
-        op->flags |= Inst_Segment;
-        op->reg = 3;
-        return;
-    } else if (STR_EQUAL("SS", arg)) {
-        op->type = Operand_Register;
-        op->flags |= Inst_Segment;
-        op->reg = 2;
-        return;
-    } else if (STR_EQUAL("ES", arg)) {
-        op->type = Operand_Register;
-        op->flags |= Inst_Segment;
-        op->reg = 0;
-        return;
-    }
+void decode_arg(CPU *cpu, Instruction_Operand *op, Operand_Spec spec)
+{
+    Instruction *inst = &cpu->instruction;
+    u8 wide = OPERAND_SPEC_SIZE(spec) == Spec_Size_Word;
 
-    u8 arg_strlen = STR_LEN(arg);
-    for (u64 i = 0; i < arg_strlen; i++) {
-        if (arg[i] == 'A') {
+    switch (OPERAND_SPEC_KIND(spec)) {
+        case Spec_None: {
+            return;
+        }
+        case Spec_Register: {
+            // AL, eAX, DX, the value is the encoding of the register
+            op->type = Operand_Register;
+            op->reg = OPERAND_SPEC_VALUE(spec);
+            if (wide) {
+                set_wide(inst, op);
+            }
+            return;
+        }
+        case Spec_Segment_Register: {
+            op->type = Operand_Register;
+            op->flags |= Inst_Segment;
+            op->reg = OPERAND_SPEC_VALUE(spec);
+            return;
+        }
+        case Spec_Far_Pointer: {
             // Direct address. The instruction has no ModR/M byte; the address of the operand
             // is encoded in the instruction. Applicable, e.g., to far JMP (opcode EA).
-            assert(arg[++i] == 'p');
 
             inst->flags |= Inst_Segment | Inst_Far;
 
@@ -162,20 +105,22 @@ void decode_arg(CPU *cpu, Instruction_Operand *op, const char *arg)
             op->address.segment = (u16)(BYTE_LOHI_TO_HILO(ASMD_NEXT_BYTE(cpu), ASMD_NEXT_BYTE(cpu)));
 
             // the result will be segment:offset
-
-        } else if (arg[i] == 'J') {
+            return;
+        }
+        case Spec_Relative: {
             // The instruction contains a relative offset to be added to the address of the
             // subsequent instruction. Applicable, e.g., to short JMP (opcode EB), or LOOP.
 
             op->type = Operand_Relative_Immediate;
-            if (arg[++i] == 'v') {
+            if (wide) {
                 // @Todo: Set the op->flags |= Inst_Wide;???
                 op->immediate = (s16)(BYTE_LOHI_TO_HILO(ASMD_NEXT_BYTE(cpu), ASMD_NEXT_BYTE(cpu)));
             } else {
                 op->immediate = (s8)(ASMD_NEXT_BYTE(cpu));
             }
-
-        } else if (arg[i] == 'E') {
+            return;
+        }
+        case Spec_Modrm: {
             // A ModR/M byte follows the opcode and specifies the operand. The operand is either a general-
             // purpose register or a memory address. If it is a memory address, the address is computed from a
             // segment register and any of the following values: a base register, an index register, a displacement.
@@ -188,102 +133,138 @@ void decode_arg(CPU *cpu, Instruction_Operand *op, const char *arg)
             } else {
                 decode_memory_address_with_displacement(cpu, op);
             }
-
-        } else if (arg[i] == 'G') {
+            if (wide) {
+                set_wide(inst, op);
+            }
+            return;
+        }
+        case Spec_Modrm_Reg: {
             // The reg field of the ModR/M byte selects a general register.
 
             mod_reg_rm(cpu, inst);
 
             op->type = Operand_Register;
             op->reg = inst->reg;
-
-        } else if (arg[i] == 'I') {
+            if (wide) {
+                set_wide(inst, op);
+            }
+            return;
+        }
+        case Spec_Immediate: {
             // Immediate data. The operand value is encoded in subsequent bytes of the instruction.
 
-            s16 immediate = ASMD_NEXT_BYTE(cpu);
             op->type = Operand_Immediate;
-
-            assert(arg[i+1] != '\0');
-
-            char next_char = arg[++i];
-            if (next_char == 'v' || next_char == 'w') {
-                inst->flags |= Inst_Wide;
-                op->flags |= Inst_Wide;
-                op->immediate = (s16)BYTE_LOHI_TO_HILO(immediate, ASMD_NEXT_BYTE(cpu));
-            } else if (next_char == '0') {
-                // @Todo: This is ok?
-                op->type = Operand_Immediate;
-                s16 immediate = ASMD_NEXT_BYTE(cpu);
-                if (immediate == 0xa) continue;
-                op->immediate = immediate;
-            } else if (next_char == 'b') {
-                op->immediate = immediate;
+            if (wide) {
+                set_wide(inst, op);
+                op->immediate = (s16)BYTE_LOHI_TO_HILO(ASMD_NEXT_BYTE(cpu), ASMD_NEXT_BYTE(cpu));
             } else {
-                assert(0);
+                op->immediate = ASMD_NEXT_BYTE(cpu);
             }
-
-        } else if (arg[i] == 'O') {
+            return;
+        }
+        case Spec_Aam_Base: {
+            // The base of aam and aad, NASM leaves out the default 10
+            u8 base = ASMD_NEXT_BYTE(cpu);
+            if (base != 0xa) {
+                op->type = Operand_Immediate;
+                op->immediate = base;
+            }
+            return;
+        }
+        case Spec_Offset: {
             // The instruction has no ModR/M byte; the offset of the operand is encoded as a WORD in the instruction.
             // Applicable, e.g., to certain MOVs (opcodes A0 through A3).
 
             op->type = Operand_Memory;
             op->address.base = Effective_Address_direct;
-            
-            char next_char = arg[++i];
-            
-            if (next_char == 'v' || next_char == 'w') {
+
+            if (wide) {
                 inst->flags |= Inst_Wide; // @Todo: investigate, because I guess this is not required
             }
 
             u16 displacement = (u16)BYTE_LOHI_TO_HILO(ASMD_NEXT_BYTE(cpu), ASMD_NEXT_BYTE(cpu));
             op->address.displacement = displacement;
-
-        } else if (arg[i] == 'S') {
+            return;
+        }
+        case Spec_Modrm_Segment: {
             // The reg field of the ModR/M byte selects a segment register.
 
             mod_reg_rm(cpu, inst);
 
+            // Only the low two bits select it, the 8086 ignores the third one
             op->type = Operand_Register;
             op->flags |= Inst_Segment;
-            op->reg  = inst->reg;
-
-        } else if (arg[i] == 'M') {
+            op->reg  = inst->reg & 3;
+            if (wide) {
+                set_wide(inst, op);
+            }
+            return;
+        }
+        case Spec_Modrm_Memory: {
             // The ModR/M byte may refer only to memory. Applicable, e.g., to LES and LDS.
 
             mod_reg_rm(cpu, inst);
             decode_memory_address_with_displacement(cpu, op);
 
-        } else if (arg[i] == 'v' || arg[i] == 'w') {
-            // Word argument. (The 'v' code has a more complex meaning in later x86 opcode maps,
-            // from which this was derived, but here it's just a synonym for the 'w' code.)
-
-            inst->flags |= Inst_Wide;
-            op->flags |= Inst_Wide;
-
-        } else if (arg[i] == 'b') {
-            // Byte argument. This is the default value so we don't need to change here the flags.
-
-        } else if (arg[i] == 'p') {
-            // 32-bit segment:offset pointer.
-            inst->flags |= Inst_Far;
-
-        } else if (arg[i] == '1') {
-            // @Todo: This is ok? Maybe we should create a new opcode type like Operand_Constant?
-            op->type = Operand_Immediate;
-            op->reg = 1;
-
-        } else if (arg[i] == '3') {
+            if (OPERAND_SPEC_SIZE(spec) == Spec_Size_Pointer) {
+                // 32-bit segment:offset pointer.
+                inst->flags |= Inst_Far;
+            }
+            return;
+        }
+        case Spec_Constant: {
             // @Todo: This is ok? Maybe we should create a new opcode type like Operand_Constant?
             op->type = Operand_Immediate;
-            op->reg = 3;
+            op->reg = OPERAND_SPEC_VALUE(spec);
+            return;
+        }
+    }
 
-        } else {
-            printf(">> %s\n", arg);
+    printf("\n[ERROR]: Unknown operand spec: %#x\n", spec);
+    assert(0);
+}
 
-            assert(0);
+// Folds the prefix into the instruction, returns 0 if the byte isn't a prefix
+static u8 decode_prefix(Instruction *inst, u8 byte)
+{
+    switch (byte) {
+        // The last rep prefix counts, the lock and the segment prefixes before it stay
+        case 0xF3: {
+            inst->flags = (inst->flags & ~Inst_Repnz) | Inst_Repz;
+            return 1;
+        }
+        case 0xF2: {
+            inst->flags = (inst->flags & ~Inst_Repz) | Inst_Repnz;
+            return 1;
+        }
+        case 0xF0: {
+            inst->flags |= Inst_Lock;
+            return 1;
+        }
+        case 0x26: {
+            inst->flags |= Inst_Segment;
+            inst->extend_with_this_segment = Register_es;
+            return 1;
+        }
+        case 0x2E: {
+            inst->flags |= Inst_Segment;
+            inst->extend_with_this_segment = Register_cs;
+            return 1;
+        }
+        case 0x36: {
+            inst->flags |= Inst_Segment;
+            inst->extend_with_this_segment = Register_ss;
+            return 1;
+        }
+        case 0x3E: {
+            inst->flags |= Inst_Segment;
+            inst->extend_with_this_segment = Register_ds;
+            return 1;
+        }
+        default: {
+            return 0;
         }
     }
-
 }
 
 void decode_next_instruction(CPU *cpu)
@@ -291,11 +272,13 @@ void decode_next_instruction(CPU *cpu)
     Instruction *inst = &cpu->instruction;
     cpu->decoder_cursor = calc_inst_pointer_address(cpu);
 
-    if (!inst->is_prefix) {
-        ZERO_MEMORY(inst, sizeof(Instruction));
-        inst->extend_with_this_segment = Register_none;
+    ZERO_MEMORY(inst, sizeof(Instruction));
+    inst->extend_with_this_segment = Register_none;
+
+    // The prefixes are taken in the same pass, the instruction starts at the first other byte
+    while (cpu->decoder_cursor < MAX_MEMORY && decode_prefix(inst, ASMD_CURR_BYTE(cpu))) {
+        cpu->decoder_cursor++;
     }
-    inst->is_prefix = 0;
 
     u8 byte = ASMD_CURR_BYTE(cpu);
     inst->mem_address = cpu->decoder_cursor;
@@ -305,66 +288,28 @@ void decode_next_instruction(CPU *cpu)
     inst->mnemonic = lookup_result.mnemonic;
     inst->type = lookup_result.type;
 
-    //printf("> opcode: %#08X ; mnemonic: %s ; arg1: %s ; arg2: %s\n", lookup_result.opcode, mnemonic_name(lookup_result.mnemonic), lookup_result.arg1, lookup_result.arg2);
+    //printf("> opcode: %#08X ; mnemonic: %s ; arg1: %#x ; arg2: %#x\n", lookup_result.opcode, mnemonic_name(lookup_result.mnemonic), lookup_result.arg1, lookup_result.arg2);
 
     // Overwrite the arguments if the extenstion table lookup is find something
-    if (lookup_result.mnemonic >= Mneumonic_grp1) {
+    if (lookup_result.mnemonic >= Mneumonic_grp1 && lookup_result.mnemonic < Mneumonic_grp1 + I8086_GROUP_COUNT) {
         mod_reg_rm(cpu, inst);
 
-        inst->mnemonic = extended_mneumonic_lookup[lookup_result.mnemonic][inst->reg];
+        const i8086_Inst_Table *group = &i8086_group_table[lookup_result.mnemonic - Mneumonic_grp1][inst->reg];
+        inst->mnemonic = group->mnemonic;
 
-        const char *ext_arg1 = i8086_inst_ext_table[lookup_result.mnemonic][inst->reg][0];
-        const char *ext_arg2 = i8086_inst_ext_table[lookup_result.mnemonic][inst->reg][1];
-        if (ext_arg1 || ext_arg2) {
-            lookup_result.arg1 = ext_arg1;
-            lookup_result.arg2 = ext_arg2;
+        if (group->arg1 || group->arg2) {
+            lookup_result.arg1 = group->arg1;
+            lookup_result.arg2 = group->arg2;
         }
     }
 
     decode_arg(cpu, &inst->operands[0], lookup_result.arg1);
     decode_arg(cpu, &inst->operands[1], lookup_result.arg2);
 
-    // Set prefixes
-    // @Todo: Handle more prefixes
-    if (inst->mnemonic == Mneumonic_repz) {
-        inst->is_prefix = 1;
-        inst->flags = Inst_Repz;
-    }
-    else if (inst->mnemonic == Mneumonic_repnz) {
-        inst->is_prefix = 1;
-        inst->flags = Inst_Repnz;
-    }
-    else if (inst->mnemonic == Mneumonic_lock) {
-        inst->is_prefix = 1;
-        inst->flags |= Inst_Lock;
-    }
-    else if (inst->mnemonic == Mneumonic_cs) {
-        inst->is_prefix = 1;
-        inst->flags |= Inst_Segment;
-        inst->extend_with_this_segment = Register_cs;
-    }
-    else if (inst->mnemonic == Mneumonic_ds) {
-        inst->is_prefix = 1;
-        inst->flags |= Inst_Segment;
-        inst->extend_with_this_segment = Register_ds;
-    }
-    else if (inst->mnemonic == Mneumonic_es) {
-        inst->is_prefix = 1;
-        inst->flags |= Inst_Segment;
-        inst->extend_with_this_segment = Register_es;
-    }
-    else if (inst->mnemonic == Mneumonic_ss) {
-        inst->is_prefix = 1;
-        inst->flags |= Inst_Segment;
-        inst->extend_with_this_segment = Register_ss;
-    }
-
-    if ((inst->flags & Inst_Lock) && inst->is_prefix == 0) {
-        // Flip memory, register because the lock prefix must be follow a memory operand
-        if (inst->operands[0].type != Operand_Memory) {
-            // DONT DELETE THIS ASSERT!
-            assert(inst->operands[1].type == Operand_Memory);
-
+    if (inst->flags & Inst_Lock) {
+        // Flip memory, register because the lock prefix must be follow a memory operand. The 8086
+        // doesn't fault on a lock without one, the data decoded as code (--decode-linear) can have it.
+        if (inst->operands[0].type != Operand_Memory && inst->operands[1].type == Operand_Memory) {
             Instruction_Operand temp = inst->operands[0];
             inst->operands[0] = inst->operands[1];
             inst->operands[1] = temp;
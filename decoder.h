@@ -3,6 +3,9 @@
 
 #include "sim86.h"
 
+// Decodes the instruction at cs:ip into cpu->instruction with its prefixes folded into the flags and
+// extend_with_this_segment. The mem_address and the size are the opcode's, without the prefixes,
+// the decoder_cursor is after the instruction.
 void decode_next_instruction(CPU *cpu);
 
 #endif
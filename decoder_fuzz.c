@@ -0,0 +1,318 @@
+#include "decoder_fuzz.h"
+#include "decoder.h"
+#include "printer.h"
+
+#ifdef _WIN32
+
+// The reference worker is a forked process behind two pipes, the fuzzer is only in the POSIX builds
+Decoder_Fuzzer *decoder_fuzzer_create(const char *python, u64 seed)
+{
+    printf("\n[ERROR]: The decoder fuzzer (--fuzz-decoder) is not available on Windows.\n");
+    return NULL;
+}
+
+void decoder_fuzzer_destroy(Decoder_Fuzzer *fuzzer)
+{
+    free(fuzzer);
+}
+
+void decoder_fuzzer_run(Decoder_Fuzzer *fuzzer, u64 cases)
+{
+}
+
+#else
+
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// xorshift64*
+static u64 random_next(Decoder_Fuzzer *fuzzer)
+{
+    u64 x = fuzzer->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    fuzzer->random_state = x;
+    return x * 0x2545F4914F6CDD1Dul;
+}
+
+Decoder_Fuzzer *decoder_fuzzer_create(const char *python, u64 seed)
+{
+    int to_worker[2];
+    int from_worker[2];
+    if (pipe(to_worker) != 0 || pipe(from_worker) != 0) {
+        printf("\n[ERROR]: Failed to create the pipes of the reference worker.\n");
+        return NULL;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("\n[ERROR]: Failed to start the reference worker.\n");
+        return NULL;
+    }
+
+    if (pid == 0) {
+        dup2(to_worker[0], STDIN_FILENO);
+        dup2(from_worker[1], STDOUT_FILENO);
+        close(to_worker[0]);
+        close(to_worker[1]);
+        close(from_worker[0]);
+        close(from_worker[1]);
+
+        execlp(python, python, DECODER_FUZZ_WORKER, (char *)NULL);
+        fprintf(stderr, "\n[ERROR]: Failed to run %s %s.\n", python, DECODER_FUZZ_WORKER);
+        _exit(127);
+    }
+
+    close(to_worker[0]);
+    close(from_worker[1]);
+
+    // A dead worker shows up as a failed write instead of killing us
+    signal(SIGPIPE, SIG_IGN);
+
+    Decoder_Fuzzer *fuzzer = (Decoder_Fuzzer *)calloc(1, sizeof(Decoder_Fuzzer));
+    assert(fuzzer != NULL);
+
+    fuzzer->worker = pid;
+    fuzzer->to_worker = to_worker[1];
+    fuzzer->from_worker = fdopen(from_worker[0], "r");
+    assert(fuzzer->from_worker != NULL);
+
+    fuzzer->random_state = seed ? seed : 0x9E3779B97F4A7C15ul;
+
+    // The registers are zeros, cs:ip is 0:0 and the case is at the start of the memory
+    fuzzer->cpu.memory = fuzzer->memory;
+    fuzzer->cpu.quiet = 1;
+
+    return fuzzer;
+}
+
+void decoder_fuzzer_destroy(Decoder_Fuzzer *fuzzer)
+{
+    close(fuzzer->to_worker);
+    fclose(fuzzer->from_worker);
+    waitpid(fuzzer->worker, NULL, 0);
+    free(fuzzer);
+}
+
+static u8 is_prefix_byte(u8 byte)
+{
+    return byte == 0x26 || byte == 0x2E || byte == 0x36 || byte == 0x3E ||
+           byte == 0xF0 || byte == 0xF2 || byte == 0xF3;
+}
+
+static void generate_case(Decoder_Fuzzer *fuzzer, u8 *bytes)
+{
+    static const u8 prefixes[] = {0x26, 0x2E, 0x36, 0x3E, 0xF0, 0xF2, 0xF3};
+
+    u64 words[2] = {random_next(fuzzer), random_next(fuzzer)};
+    memcpy(bytes, words, DECODER_FUZZ_CASE_SIZE);
+
+    u64 choice = random_next(fuzzer);
+    if (choice & 1) {
+        u32 count = (choice >> 1) % 4;
+        for (u32 i = 0; i < count; i++) {
+            bytes[i] = prefixes[(choice >> (8 + i * 8)) % ARRAY_SIZE(prefixes)];
+        }
+        while (is_prefix_byte(bytes[count])) {
+            bytes[count] = (u8)random_next(fuzzer);
+        }
+    }
+}
+
+// Decodes the first instruction of the case with its prefixes, returns its size, the
+// instruction doesn't fit into the case if it is larger than DECODER_FUZZ_CASE_SIZE
+static u32 decode_case(Decoder_Fuzzer *fuzzer, const u8 *bytes)
+{
+    CPU *cpu = &fuzzer->cpu;
+
+    memcpy(fuzzer->memory, bytes, DECODER_FUZZ_CASE_SIZE);
+    cpu->ip = 0;
+    decode_next_instruction(cpu);
+
+    // A case of prefixes only has no instruction, the opcode comes from the zeros after it
+    return cpu->instruction.mem_address >= DECODER_FUZZ_CASE_SIZE ? DECODER_FUZZ_CASE_SIZE + 1 : cpu->decoder_cursor;
+}
+
+static u32 canonical_operand(char *dest, Decoder_Fuzzer *fuzzer, Instruction *instruction, Instruction_Operand *op)
+{
+    u8 opcode = fuzzer->memory[instruction->mem_address];
+
+    switch (op->type) {
+        case Operand_Register: {
+            return sprintf(dest, "r:%s", register_name(register_access(op->reg, op->flags)->reg));
+        }
+        case Operand_Memory: {
+            // The direct far pointers of call and jmp
+            if (opcode == 0x9A || opcode == 0xEA) {
+                return sprintf(dest, "a:%u:%u", op->address.segment, op->address.displacement & 0xFFFF);
+            }
+            return sprintf(dest, "m:%s:%u", effective_address_name(op->address.base), op->address.displacement & 0xFFFF);
+        }
+        case Operand_Immediate: {
+            return sprintf(dest, "i:%u", op->immediate & ((op->flags & Inst_Wide) ? 0xFFFF : 0xFF));
+        }
+        case Operand_Relative_Immediate: {
+            return sprintf(dest, "j:%u", op->immediate & 0xFFFF);
+        }
+        default: {
+            dest[0] = '\0';
+            return 0;
+        }
+    }
+}
+
+static void canonical_instruction(Decoder_Fuzzer *fuzzer, u32 size, char *dest)
+{
+    if (size > DECODER_FUZZ_CASE_SIZE) {
+        strcpy(dest, "fault");
+        return;
+    }
+
+    Instruction *instruction = &fuzzer->cpu.instruction;
+
+    char operands[2][DECODER_FUZZ_CANONICAL_MAX / 2];
+    u32 count = 0;
+    for (u32 i = 0; i < 2; i++) {
+        if (instruction->operands[i].type != Operand_None) {
+            canonical_operand(operands[count++], fuzzer, instruction, &instruction->operands[i]);
+        }
+    }
+
+    // The decoder moves the memory operand of a locked instruction first, the order isn't compared
+    if ((instruction->flags & Inst_Lock) && count == 2 && strcmp(operands[0], operands[1]) > 0) {
+        char swap[DECODER_FUZZ_CANONICAL_MAX / 2];
+        strcpy(swap, operands[0]);
+        strcpy(operands[0], operands[1]);
+        strcpy(operands[1], swap);
+    }
+
+    sprintf(dest, "%u %s %s%s%s", size, mnemonic_name(instruction->mnemonic),
+            count > 0 ? operands[0] : "", count > 1 ? "," : "", count > 1 ? operands[1] : "");
+}
+
+static u8 send_batch(Decoder_Fuzzer *fuzzer)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    // The hex of every case on its own line, the empty line flushes the answers
+    char text[DECODER_FUZZ_BATCH * (2 * DECODER_FUZZ_CASE_SIZE + 1) + 1];
+    char *cursor = text;
+
+    for (u32 i = 0; i < DECODER_FUZZ_BATCH; i++) {
+        Decoder_Fuzz_Case *fuzz_case = &fuzzer->batch[i];
+
+        generate_case(fuzzer, fuzz_case->bytes);
+        u32 size = decode_case(fuzzer, fuzz_case->bytes);
+        canonical_instruction(fuzzer, size, fuzz_case->canonical);
+
+        for (u32 j = 0; j < DECODER_FUZZ_CASE_SIZE; j++) {
+            *cursor++ = hex_digits[fuzz_case->bytes[j] >> 4];
+            *cursor++ = hex_digits[fuzz_case->bytes[j] & 0xF];
+        }
+        *cursor++ = '\n';
+    }
+    *cursor++ = '\n';
+
+    fuzzer->decoded += DECODER_FUZZ_BATCH;
+
+    for (char *data = text; data < cursor;) {
+        ssize_t written = write(fuzzer->to_worker, data, cursor - data);
+        if (written <= 0) {
+            return 0;
+        }
+        data += written;
+    }
+
+    fuzzer->batch_pending = 1;
+    return 1;
+}
+
+static u8 check_batch(Decoder_Fuzzer *fuzzer)
+{
+    fuzzer->batch_pending = 0;
+
+    for (u32 i = 0; i < DECODER_FUZZ_BATCH; i++) {
+        Decoder_Fuzz_Case *fuzz_case = &fuzzer->batch[i];
+
+        char answer[256];
+        if (fgets(answer, sizeof(answer), fuzzer->from_worker) == NULL) {
+            return 0;
+        }
+        answer[strcspn(answer, "\n")] = '\0';
+
+        if (STR_EQUAL(answer, "skip")) {
+            fuzzer->skipped++;
+            continue;
+        }
+
+        fuzzer->checked++;
+
+        if (!STR_EQUAL(answer, fuzz_case->canonical)) {
+            if (fuzzer->mismatches < DECODER_FUZZ_MAX_REPORTS) {
+                printf("[MISMATCH]: ");
+                for (u32 j = 0; j < DECODER_FUZZ_CASE_SIZE; j++) {
+                    printf("%02x", fuzz_case->bytes[j]);
+                }
+                printf("\n\tsim86:     %s\n\treference: %s\n", fuzz_case->canonical, answer);
+            }
+            fuzzer->mismatches++;
+        }
+    }
+
+    return 1;
+}
+
+static u8 answers_ready(Decoder_Fuzzer *fuzzer)
+{
+    struct pollfd poll_fd = {0};
+    poll_fd.fd = fileno(fuzzer->from_worker);
+    poll_fd.events = POLLIN;
+    return poll(&poll_fd, 1, 0) > 0;
+}
+
+void decoder_fuzzer_run(Decoder_Fuzzer *fuzzer, u64 cases)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    u8 worker_alive = 1;
+    u8 bytes[DECODER_FUZZ_CASE_SIZE];
+
+    while (fuzzer->decoded < cases) {
+        if (worker_alive && !fuzzer->batch_pending) {
+            worker_alive = send_batch(fuzzer);
+        }
+
+        // The decoder on its own, it has to survive everything and keep the sizes sane
+        for (u32 i = 0; i < DECODER_FUZZ_ROUND && fuzzer->decoded < cases; i++) {
+            generate_case(fuzzer, bytes);
+            u32 size = decode_case(fuzzer, bytes);
+            assert(size >= 1);
+            fuzzer->decoded++;
+        }
+
+        if (worker_alive && fuzzer->batch_pending && answers_ready(fuzzer)) {
+            worker_alive = check_batch(fuzzer);
+        }
+    }
+
+    if (worker_alive && fuzzer->batch_pending) {
+        worker_alive = check_batch(fuzzer);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (!worker_alive) {
+        printf("\n[ERROR]: The reference worker stopped, run from the repository root with a Python 2 (--fuzz-python).\n");
+    }
+
+    printf("\n[DECODER FUZZ]: %lu cases in %.3f s, %.2f M cases/s, %lu checked against the reference, %lu skipped, %lu mismatches\n",
+           fuzzer->decoded, seconds, fuzzer->decoded / seconds / 1e6, fuzzer->checked, fuzzer->skipped, fuzzer->mismatches);
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef _H_DECODER_FUZZ
+#define _H_DECODER_FUZZ
+
+#include "sim86.h"
+
+// Differential fuzzing of the decoder against the independent reference decoder in
+// docs/reference.py, run from the repository root:
+//
+//   --fuzz-decoder <n>       decode n cases in-process
+//   --fuzz-python <command>  the Python 2 interpreter of the reference worker (python2)
+//   --fuzz-seed <n>          seed of the cases
+//
+// A case is DECODER_FUZZ_CASE_SIZE bytes, every other one is random, the rest start with up to
+// three prefixes and an opcode which isn't one. Only the first instruction of a case (with its
+// prefixes) is decoded.
+//
+// The reference runs in one long-lived worker (tools/decoder_reference_worker.py), it gets a batch
+// of cases while sim86 keeps decoding new cases on its own. When the answers are in, they are
+// compared with sim86's: the length, the mnemonic and the operands in a canonical form, every
+// mismatch is printed. sim86 decodes millions of cases per second, the worker checks a sample.
+//
+// The canonical form is "<length> <mnemonic> <operand>,<operand>" or "fault" if the instruction
+// doesn't fit into the case, an operand is r:<register>, m:<base+index>:<displacement>,
+// a:<segment>:<offset> (far pointer), i:<immediate> or j:<relative offset>, the numbers are
+// unsigned and the immediates have the size of their encoding. The worker answers "skip" where
+// the reference has no answer (a segment register field of 4-7, lea, les and lds with a register
+// operand, which are undefined on the 8086).
+
+#define DECODER_FUZZ_CASE_SIZE 16
+#define DECODER_FUZZ_BATCH 1024      // cases in one batch of the worker
+#define DECODER_FUZZ_ROUND 4096      // cases decoded between two checks for the worker's answers
+#define DECODER_FUZZ_MAX_REPORTS 32  // the mismatches after these are only counted
+#define DECODER_FUZZ_CANONICAL_MAX 96
+
+#define DECODER_FUZZ_WORKER "tools/decoder_reference_worker.py"
+#define DECODER_FUZZ_DEFAULT_PYTHON "python2"
+
+typedef struct {
+    u8 bytes[DECODER_FUZZ_CASE_SIZE];
+    char canonical[DECODER_FUZZ_CANONICAL_MAX]; // sim86's answer
+} Decoder_Fuzz_Case;
+
+typedef struct {
+    int worker; // the pid
+    int to_worker;
+    FILE *from_worker;
+
+    u64 random_state;
+
+    CPU cpu; // only decodes, its memory is the case and zeros after it
+    u8 memory[4 * DECODER_FUZZ_CASE_SIZE];
+
+    Decoder_Fuzz_Case batch[DECODER_FUZZ_BATCH];
+    u8 batch_pending; // sent, the answers are not read yet
+
+    u64 decoded;
+    u64 checked;
+    u64 skipped;
+    u64 mismatches;
+} Decoder_Fuzzer;
+
+// Returns NULL if the worker can't be started, always on Windows
+Decoder_Fuzzer *decoder_fuzzer_create(const char *python, u64 seed);
+void decoder_fuzzer_destroy(Decoder_Fuzzer *fuzzer);
+
+void decoder_fuzzer_run(Decoder_Fuzzer *fuzzer, u64 cases);
+
+#endif
@@ -0,0 +1,52 @@
+# Watches a simulator started with --shm <name>: the registers, the counters and the framebuffer
+#
+#   ./build/sim86.out --quiet --shm sim86 program &
+#   python3 demo/live_view.py sim86
+#
+# The layout is Live_View_Header in live_view.h.
+
+import mmap
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("=8sIIIIII12HHH4xQQQQ")
+REGISTERS = ["ax", "bx", "cx", "dx", "sp", "bp", "si", "di", "es", "cs", "ss", "ds"]
+RUNNING, EXITED = 1, 2
+FRAMEBUFFER_SIZE = 128 * 128 * 2
+
+
+def read_header(view):
+    # Seqlock reader, the copy is only consistent if the sequence was even and didn't change
+    while True:
+        fields = HEADER.unpack_from(view, 0)
+        if fields[5] % 2 == 0 and struct.unpack_from("=I", view, 24)[0] == fields[5]:
+            return fields
+
+
+def main():
+    name = sys.argv[1] if len(sys.argv) > 1 else "sim86"
+    with open("/dev/shm/" + name.lstrip("/"), "rb") as f:
+        view = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+    while True:
+        fields = read_header(view)
+        magic, version, _, memory_offset, _, _, state = fields[:7]
+        if magic.rstrip(b"\0") != b"S86LIVE" or version != 1:
+            sys.exit("not a version 1 live view")
+
+        registers = fields[7:19]
+        ip, flags, instructions, cycles, reads, writes = fields[19:25]
+        framebuffer = view[memory_offset:memory_offset + FRAMEBUFFER_SIZE]
+
+        print(" ".join("%s=%04x" % (n, v) for n, v in zip(REGISTERS, registers)), "ip=%04x flags=%04x" % (ip, flags))
+        print("instructions=%d cycles=%d reads=%d writes=%d lit_pixels=%d"
+              % (instructions, cycles, reads, writes, sum(1 for i in range(0, FRAMEBUFFER_SIZE, 2) if framebuffer[i] | framebuffer[i + 1])))
+
+        if state == EXITED:
+            break
+        time.sleep(0.5)
+
+
+if __name__ == "__main__":
+    main()
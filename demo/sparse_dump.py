@@ -0,0 +1,80 @@
+# Expands a sparse memory dump (--dump-sparse / --dump-every, see dump.h) into a raw memory image
+#
+#   python3 demo/sparse_dump.py memory_dump.s86                 lists the frames
+#   python3 demo/sparse_dump.py memory_dump.s86 <frame> <out>   writes the memory at the frame (-1 is the last)
+
+import struct
+import sys
+
+FILE_HEADER = struct.Struct("=8sIII")
+FRAME_HEADER = struct.Struct("=QII")
+PAGE_HEADER = struct.Struct("=IHH")
+ZERO, RAW, RLE = 0, 1, 2
+
+
+def unpackbits(data, size):
+    out = bytearray()
+    i = 0
+    while len(out) < size:
+        n = data[i]
+        if n < 128:
+            out += data[i + 1:i + 2 + n]
+            i += 2 + n
+        elif n > 128:
+            out += bytes([data[i + 1]]) * (257 - n)
+            i += 2
+        else:
+            i += 1
+    return bytes(out)
+
+
+def frames(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    magic, version, page_size, page_count = FILE_HEADER.unpack_from(data, 0)
+    if magic.rstrip(b"\0") != b"S86DUMP" or version != 1:
+        sys.exit("%s is not a version 1 sparse dump" % path)
+
+    memory = bytearray(page_size * page_count)
+    at = FILE_HEADER.size
+    while at + FRAME_HEADER.size <= len(data):
+        instructions, count, full = FRAME_HEADER.unpack_from(data, at)
+        at += FRAME_HEADER.size
+        for _ in range(count):
+            page, encoding, size = PAGE_HEADER.unpack_from(data, at)
+            at += PAGE_HEADER.size
+            body = data[at:at + size]
+            at += size
+
+            if encoding == ZERO:
+                body = bytes(page_size)
+            elif encoding == RLE:
+                body = unpackbits(body, page_size)
+            memory[page * page_size:(page + 1) * page_size] = body
+
+        yield instructions, count, full, memory
+
+
+def main():
+    if len(sys.argv) == 2:
+        for index, (instructions, count, full, _) in enumerate(frames(sys.argv[1])):
+            print("frame %d: %d instructions, %d pages%s" % (index, instructions, count, " (full)" if full else ""))
+        return
+
+    wanted = int(sys.argv[2])
+    last = None
+    for index, (_, _, _, memory) in enumerate(frames(sys.argv[1])):
+        last = bytes(memory)
+        if index == wanted:
+            break
+    else:
+        if wanted != -1:
+            sys.exit("there is no frame %d" % wanted)
+
+    with open(sys.argv[3], "wb") as f:
+        f.write(last)
+
+
+if __name__ == "__main__":
+    main()
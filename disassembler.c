@@ -0,0 +1,564 @@
+#include "disassembler.h"
+#include "decoder.h"
+#include "simulator.h"
+#include "printer.h"
+#include "decode_output.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+static u16 code_segment(CPU *cpu)
+{
+    return get_data_from_register(cpu, register_access_by_enum(Register_cs));
+}
+
+// Without the register trace, the decode only moves the cs around
+static void set_code_segment(CPU *cpu, u16 segment)
+{
+    u8 quiet = cpu->quiet;
+    cpu->quiet = 1;
+    set_data_to_register(cpu, register_access_by_enum(Register_cs), segment);
+    cpu->quiet = quiet;
+}
+
+// Decodes the instruction with its prefixes at the absolute address into cpu->instruction,
+// returns the size with the prefixes or 0 if it runs past the end
+static u32 decode_at(CPU *cpu, u32 address, u32 end)
+{
+    u16 cs_segment = code_segment(cpu);
+    cpu->ip = address - (cs_segment << 4);
+
+    if (address >= end) {
+        return 0;
+    }
+
+    decode_next_instruction(cpu);
+    cpu->ip = cpu->decoder_cursor - (cs_segment << 4);
+
+    if (cpu->decoder_cursor > end) {
+        return 0;
+    }
+
+    return cpu->decoder_cursor - address;
+}
+
+static u8 is_conditional_jump(Mneumonic mnemonic)
+{
+    switch (mnemonic) {
+        case Mneumonic_jz:  case Mneumonic_jnz: case Mneumonic_jl:  case Mneumonic_jle:
+        case Mneumonic_jb:  case Mneumonic_jbe: case Mneumonic_jp:  case Mneumonic_jo:
+        case Mneumonic_js:  case Mneumonic_jnl: case Mneumonic_jg:  case Mneumonic_jnb:
+        case Mneumonic_ja:  case Mneumonic_jnp: case Mneumonic_jno: case Mneumonic_jns:
+        case Mneumonic_loop: case Mneumonic_loopz: case Mneumonic_loopnz: case Mneumonic_jcxz:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static Instruction_Flow instruction_flow(Mneumonic mnemonic)
+{
+    switch (mnemonic) {
+        case Mneumonic_jmp:  return Flow_Jump;
+        case Mneumonic_call: return Flow_Call;
+        case Mneumonic_ret:
+        case Mneumonic_retf:
+        case Mneumonic_iret: return Flow_Return;
+        case Mneumonic_hlt:  return Flow_Stop;
+        default:             return is_conditional_jump(mnemonic) ? Flow_Branch : Flow_Next;
+    }
+}
+
+// Returns 1 and the absolute target if the jump or call has a direct destination
+static u8 direct_target(CPU *cpu, Instruction *instruction, u32 *target)
+{
+    Instruction_Operand *op = &instruction->operands[0];
+
+    if (op->type == Operand_Relative_Immediate) {
+        u16 cs_segment = code_segment(cpu);
+        u16 offset = (instruction->mem_address + instruction->size - (cs_segment << 4)) + op->immediate;
+        *target = ((cs_segment << 4) + offset) & (MAX_MEMORY - 1);
+        return 1;
+    }
+
+    if (op->type == Operand_Memory && op->address.base == Effective_Address_direct && (instruction->flags & Inst_Far) &&
+        (instruction->mnemonic == Mneumonic_jmp || instruction->mnemonic == Mneumonic_call)) {
+        *target = ((op->address.segment << 4) + (u16)op->address.displacement) & (MAX_MEMORY - 1);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void add_instruction(Disassembly *disassembly, u32 address, u32 size, u32 target, Instruction_Flow flow, Instruction *instruction)
+{
+    if (disassembly->instruction_count == disassembly->instruction_capacity) {
+        disassembly->instruction_capacity = disassembly->instruction_capacity ? disassembly->instruction_capacity * 2 : 1024;
+        disassembly->instructions = (Decoded_Instruction *)realloc(disassembly->instructions, disassembly->instruction_capacity * sizeof(Decoded_Instruction));
+        assert(disassembly->instructions != NULL);
+    }
+
+    Decoded_Instruction *decoded = &disassembly->instructions[disassembly->instruction_count++];
+    decoded->address = address;
+    decoded->size = size;
+    decoded->target = target;
+    decoded->flow = flow;
+    decoded->instruction = *instruction;
+}
+
+static int compare_instructions(const void *a, const void *b)
+{
+    u32 left = ((const Decoded_Instruction *)a)->address;
+    u32 right = ((const Decoded_Instruction *)b)->address;
+    return (left > right) - (left < right);
+}
+
+Disassembly *disassembly_create(CPU *cpu)
+{
+    Disassembly *disassembly = (Disassembly *)calloc(1, sizeof(Disassembly));
+    assert(disassembly != NULL);
+
+    u16 saved_ip = cpu->ip;
+
+    disassembly->start = calc_inst_pointer_address(cpu);
+    disassembly->end = cpu->exec_end > disassembly->start ? cpu->exec_end : disassembly->start;
+
+    u32 length = disassembly->end - disassembly->start;
+    disassembly->kinds = (u8 *)calloc(length ? length : 1, 1);
+    assert(disassembly->kinds != NULL);
+
+    // Only the branches to not yet decoded code are pushed, at most one per decoded instruction
+    u32 worklist_capacity = 256;
+    u32 worklist_count = 0;
+    u32 *worklist = (u32 *)malloc(worklist_capacity * sizeof(u32));
+    assert(worklist != NULL);
+
+    if (length) {
+        worklist[worklist_count++] = disassembly->start;
+    }
+
+    while (worklist_count) {
+        u32 address = worklist[--worklist_count];
+
+        // Follow the path until it ends or reaches the already decoded code
+        while (address >= disassembly->start && address < disassembly->end) {
+            u8 *kind = &disassembly->kinds[address - disassembly->start];
+            if (*kind & Byte_Code) {
+                break;
+            }
+
+            u32 size = decode_at(cpu, address, disassembly->end);
+            Instruction *instruction = &cpu->instruction;
+            if (size == 0 || instruction->mnemonic == Mneumonic_db || instruction->mnemonic == Mneumonic_invalid) {
+                break;
+            }
+
+            // Overlapping an already decoded instruction, the bytes stay with the first one
+            u8 overlaps = 0;
+            for (u32 i = 1; i < size; i++) {
+                overlaps |= kind[i] & Byte_Code;
+            }
+            if (overlaps) {
+                break;
+            }
+
+            kind[0] |= Byte_Instruction_Start;
+            for (u32 i = 0; i < size; i++) {
+                kind[i] |= Byte_Code;
+            }
+
+            Instruction_Flow flow = instruction_flow(instruction->mnemonic);
+            u32 target = DISASSEMBLY_NO_TARGET;
+            if (flow == Flow_Branch || flow == Flow_Jump || flow == Flow_Call) {
+                if (!direct_target(cpu, instruction, &target) || target < disassembly->start || target >= disassembly->end) {
+                    target = DISASSEMBLY_NO_TARGET;
+                }
+            }
+
+            add_instruction(disassembly, address, size, target, flow, instruction);
+
+            if (target != DISASSEMBLY_NO_TARGET) {
+                disassembly->kinds[target - disassembly->start] |= Byte_Jump_Target;
+
+                if (!(disassembly->kinds[target - disassembly->start] & Byte_Code)) {
+                    if (worklist_count == worklist_capacity) {
+                        worklist_capacity *= 2;
+                        worklist = (u32 *)realloc(worklist, worklist_capacity * sizeof(u32));
+                        assert(worklist != NULL);
+                    }
+                    worklist[worklist_count++] = target;
+                }
+            }
+
+            // The calls are expected to return, the rest of the unconditional transfers end the path
+            if (flow == Flow_Jump || flow == Flow_Return || flow == Flow_Stop) {
+                break;
+            }
+
+            address += size;
+        }
+    }
+
+    free(worklist);
+
+    qsort(disassembly->instructions, disassembly->instruction_count, sizeof(Decoded_Instruction), compare_instructions);
+
+    cpu->ip = saved_ip;
+    return disassembly;
+}
+
+void disassembly_destroy(Disassembly *disassembly)
+{
+    free(disassembly->instructions);
+    free(disassembly->kinds);
+    free(disassembly);
+}
+
+static void write_data(CPU *cpu, Text_Writer *writer, u32 address, u32 end)
+{
+    static_assert(DISASSEMBLY_DB_PER_LINE <= FORMAT_DATA_MAX_BYTES, "a db line has to fit into the formatter");
+
+    while (address < end) {
+        u32 count = end - address < DISASSEMBLY_DB_PER_LINE ? end - address : DISASSEMBLY_DB_PER_LINE;
+
+        char *dest = text_writer_reserve(writer, INSTRUCTION_TEXT_MAX);
+        text_writer_commit(writer, format_data(dest, address, cpu->memory + address, count));
+
+        address += count;
+    }
+}
+
+static Text_Writer *create_output(CPU *cpu)
+{
+    fflush(stdout);
+    Text_Writer *writer = text_writer_create(stdout);
+
+    char *dest = text_writer_reserve(writer, DECODE_OUTPUT_MAX);
+    text_writer_commit(writer, format_decode_header(dest, cpu->decode_format));
+
+    return writer;
+}
+
+static void write_decoded(CPU *cpu, Text_Writer *writer, Instruction *instruction, u32 address, u32 size, const u8 *bytes)
+{
+    char *dest = text_writer_reserve(writer, DECODE_OUTPUT_MAX);
+    text_writer_commit(writer, format_decoded(dest, cpu->decode_format, instruction, address, size, bytes));
+}
+
+void disassembly_print(CPU *cpu, Disassembly *disassembly)
+{
+    Text_Writer *writer = create_output(cpu);
+    u8 with_data = cpu->decode_format == Decode_Format_Text;
+
+    u32 address = disassembly->start;
+
+    for (u32 i = 0; i < disassembly->instruction_count; i++) {
+        Decoded_Instruction *decoded = &disassembly->instructions[i];
+
+        if (with_data) {
+            write_data(cpu, writer, address, decoded->address);
+        }
+        write_decoded(cpu, writer, &decoded->instruction, decoded->address, decoded->size, cpu->memory + decoded->address);
+
+        address = decoded->address + decoded->size;
+    }
+
+    if (with_data) {
+        write_data(cpu, writer, address, disassembly->end);
+    }
+
+    text_writer_destroy(writer);
+}
+
+typedef struct {
+    CPU *cpu; // the template, every worker decodes on its own copy
+    Linear_Chunk *chunks;
+    u32 chunk_count;
+    u32 next_chunk;
+} Linear_Job;
+
+static void add_chunk_instruction(Linear_Chunk *chunk, u32 address, u32 offset)
+{
+    // Room for its text too
+    if (offset + DECODE_OUTPUT_MAX > chunk->text_capacity) {
+        chunk->text_capacity = chunk->text_capacity ? chunk->text_capacity * 2 : 64 * 1024;
+        chunk->text = (char *)realloc(chunk->text, chunk->text_capacity);
+        assert(chunk->text != NULL);
+    }
+
+    if (chunk->count + 1 >= chunk->capacity) {
+        chunk->capacity = chunk->capacity ? chunk->capacity * 2 : 4096;
+        chunk->addresses = (u32 *)realloc(chunk->addresses, chunk->capacity * sizeof(u32));
+        chunk->offsets = (u32 *)realloc(chunk->offsets, chunk->capacity * sizeof(u32));
+        assert(chunk->addresses != NULL && chunk->offsets != NULL);
+    }
+
+    chunk->addresses[chunk->count] = address;
+    chunk->offsets[chunk->count] = offset;
+}
+
+// Decodes the instructions which start in [chunk->begin, chunk->end), the last one may run past the end
+static void decode_chunk(CPU *cpu, Linear_Chunk *chunk)
+{
+    chunk->count = 0;
+    u32 text_size = 0;
+
+    // The ip has to stay in the code segment, the printed instructions don't depend on the cs
+    u16 cs_segment = chunk->begin >> 4;
+    set_code_segment(cpu, cs_segment);
+    cpu->ip = chunk->begin - (cs_segment << 4);
+
+    u32 address = chunk->begin;
+    while (address < chunk->end) {
+        add_chunk_instruction(chunk, address, text_size);
+
+        decode_next_instruction(cpu);
+        cpu->ip = cpu->decoder_cursor - (cs_segment << 4);
+
+        // The prefixes at the end of the program have no instruction, they are dropped
+        if (cpu->instruction.mem_address >= cpu->exec_end) {
+            break;
+        }
+
+        text_size += format_decoded(chunk->text + text_size, cpu->decode_format, &cpu->instruction,
+                                    address, cpu->decoder_cursor - address, cpu->memory + address);
+        chunk->count++;
+        address = cpu->decoder_cursor;
+    }
+
+    add_chunk_instruction(chunk, address, text_size);
+    chunk->next = address;
+}
+
+static void *linear_worker(void *arg)
+{
+    Linear_Job *job = (Linear_Job *)arg;
+    CPU cpu = *job->cpu;
+
+    for (;;) {
+#ifdef _WIN32
+        u32 c = job->next_chunk++; // the only worker
+#else
+        u32 c = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+#endif
+        if (c >= job->chunk_count) {
+            break;
+        }
+        decode_chunk(&cpu, &job->chunks[c]);
+    }
+
+    return NULL;
+}
+
+// Returns the index of the instruction which starts at the address or the chunk count
+static u32 find_chunk_instruction(Linear_Chunk *chunk, u32 address)
+{
+    u32 low = 0;
+    u32 high = chunk->count;
+
+    while (low < high) {
+        u32 middle = low + (high - low) / 2;
+        if (chunk->addresses[middle] < address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return (low < chunk->count && chunk->addresses[low] == address) ? low : chunk->count;
+}
+
+void disassembly_print_linear(CPU *cpu, u32 thread_count)
+{
+    u32 start = calc_inst_pointer_address(cpu);
+    u32 end = cpu->exec_end > start ? cpu->exec_end : start;
+
+    u32 chunk_count = (end - start + DISASSEMBLY_CHUNK_SIZE - 1) / DISASSEMBLY_CHUNK_SIZE;
+    Linear_Chunk *chunks = (Linear_Chunk *)calloc(chunk_count ? chunk_count : 1, sizeof(Linear_Chunk));
+    assert(chunks != NULL);
+
+    for (u32 c = 0; c < chunk_count; c++) {
+        u32 chunk_start = start + c * DISASSEMBLY_CHUNK_SIZE;
+        chunks[c].begin = c ? chunk_start - DISASSEMBLY_CHUNK_OVERLAP : chunk_start;
+        chunks[c].end = end - chunk_start > DISASSEMBLY_CHUNK_SIZE ? chunk_start + DISASSEMBLY_CHUNK_SIZE : end;
+    }
+
+    Linear_Job job = {0};
+    job.cpu = cpu;
+    job.chunks = chunks;
+    job.chunk_count = chunk_count;
+
+    if (thread_count > chunk_count) thread_count = chunk_count;
+#ifdef _WIN32
+    // No pthreads, the chunks are decoded on this thread
+    linear_worker(&job);
+#else
+    if (thread_count > 1) {
+        pthread_t *threads = (pthread_t *)malloc(thread_count * sizeof(pthread_t));
+        assert(threads != NULL);
+
+        for (u32 t = 0; t < thread_count; t++) {
+            pthread_create(&threads[t], NULL, linear_worker, &job);
+        }
+        for (u32 t = 0; t < thread_count; t++) {
+            pthread_join(threads[t], NULL);
+        }
+
+        free(threads);
+    } else {
+        linear_worker(&job);
+    }
+#endif
+
+    // The chunks are merged in order, each continues where the previous one ended
+    Text_Writer *writer = create_output(cpu);
+
+    u16 saved_ip = cpu->ip;
+    u16 saved_cs = code_segment(cpu);
+
+    u32 address = start;
+    for (u32 c = 0; c < chunk_count; c++) {
+        Linear_Chunk *chunk = &chunks[c];
+
+        if (address < chunk->end) {
+            u32 first = find_chunk_instruction(chunk, address);
+            if (first == chunk->count) {
+                chunk->begin = address;
+                decode_chunk(cpu, chunk);
+                first = 0;
+            }
+
+            text_writer_write(writer, chunk->text + chunk->offsets[first], chunk->offsets[chunk->count] - chunk->offsets[first]);
+            address = chunk->next;
+        }
+
+        free(chunk->addresses);
+        free(chunk->offsets);
+        free(chunk->text);
+    }
+
+    text_writer_destroy(writer);
+
+    set_code_segment(cpu, saved_cs);
+    cpu->ip = saved_ip;
+
+    free(chunks);
+}
+
+// Writes the prefixes which give the same flags as the decoded ones right before end, returns their count
+static u32 write_folded_prefixes(u8 *end, Instruction *instruction)
+{
+    u8 *cursor = end;
+
+    if (instruction->flags & Inst_Repz) {
+        *--cursor = 0xF3;
+    } else if (instruction->flags & Inst_Repnz) {
+        *--cursor = 0xF2;
+    }
+
+    switch (instruction->extend_with_this_segment) {
+        case Register_es: *--cursor = 0x26; break;
+        case Register_cs: *--cursor = 0x2E; break;
+        case Register_ss: *--cursor = 0x36; break;
+        case Register_ds: *--cursor = 0x3E; break;
+        default: break;
+    }
+
+    if (instruction->flags & Inst_Lock) {
+        *--cursor = 0xF0;
+    }
+
+    return end - cursor;
+}
+
+void disassembly_print_stream(CPU *cpu, FILE *input)
+{
+    u32 base = calc_inst_pointer_address(cpu);
+    int fd = fileno(input);
+
+    // The memory past the read bytes stays zero, the last instruction reads the same as after a loaded program
+    u8 *window = (u8 *)calloc(DISASSEMBLY_STREAM_WINDOW + DISASSEMBLY_STREAM_CARRY, 1);
+    assert(window != NULL);
+
+    CPU decoder = *cpu;
+    decoder.memory = window;
+    set_code_segment(&decoder, 0);
+
+    u64 offset = 0;   // the stream offset of window[0]
+    u32 size = 0;     // the read bytes in the window
+    u32 position = 0; // the next instruction
+    u32 ahead = DISASSEMBLY_STREAM_CARRY; // the bytes it needs after the position
+    u64 folded_start = 0; // the stream offset of the first prefix if the run of them was folded
+    u8 folded = 0;
+    u8 end_of_input = 0;
+
+    Text_Writer *writer = create_output(cpu);
+
+    for (;;) {
+        if (!end_of_input && size - position < ahead) {
+            // The undecoded tail moves to the front, a pipe is decoded as far as it has been written
+            memmove(window, window + position, size - position);
+            offset += position;
+            size -= position;
+            position = 0;
+
+            text_writer_flush(writer);
+
+            while (!end_of_input && size < ahead) {
+                int count = (int)read(fd, window + size, DISASSEMBLY_STREAM_WINDOW - size);
+                if (count <= 0) {
+                    end_of_input = 1;
+                } else {
+                    size += count;
+                }
+            }
+
+            memset(window + size, 0, DISASSEMBLY_STREAM_WINDOW + DISASSEMBLY_STREAM_CARRY - size);
+        }
+
+        if (position >= size) {
+            break;
+        }
+
+        decoder.ip = position;
+        decode_next_instruction(&decoder);
+
+        // The prefixes run into the bytes which are not read yet, it is decoded again with them. A run
+        // which doesn't fit into the window is replaced by the few prefixes it folds into.
+        u32 needed = decoder.instruction.mem_address - position + DISASSEMBLY_STREAM_CARRY;
+        if (!end_of_input && needed > size - position) {
+            if (needed <= DISASSEMBLY_STREAM_WINDOW) {
+                ahead = needed;
+                continue;
+            }
+
+            if (!folded) {
+                folded_start = offset + position;
+                folded = 1;
+            }
+            position = decoder.instruction.mem_address - write_folded_prefixes(window + decoder.instruction.mem_address, &decoder.instruction);
+            continue;
+        }
+        ahead = DISASSEMBLY_STREAM_CARRY;
+
+        // The prefixes at the end have no instruction, they are dropped
+        if (decoder.instruction.mem_address >= size) {
+            break;
+        }
+
+        u64 start = folded ? folded_start : offset + position;
+        u8 *bytes = folded ? NULL : window + position;
+        decoder.instruction.mem_address += base + offset;
+        write_decoded(cpu, writer, &decoder.instruction, base + start, offset + decoder.decoder_cursor - start, bytes);
+
+        position = decoder.decoder_cursor;
+        folded = 0;
+    }
+
+    text_writer_destroy(writer);
+    free(window);
+}
@@ -0,0 +1,93 @@
+#ifndef _H_DISASSEMBLER
+#define _H_DISASSEMBLER
+
+#include "sim86.h"
+
+// Recursive descent disassembly (--decode): the control flow is followed from cs:ip with a
+// worklist, the jump and call targets and the fallthroughs are code, every byte which is
+// never reached is data and printed as db. A byte is decoded at most once, a path stops at
+// the bytes which are already code, at an undefined opcode and where it leaves the program.
+//
+// The indirect jumps and calls can't be followed, the code only reachable through them is data.
+// --decode-linear decodes every byte from cs:ip to the end of the program as code instead.
+//
+// The linear decode splits the program into chunks, the threads (--threads n) decode them into
+// their own text buffers. A chunk starts to decode DISASSEMBLY_CHUNK_OVERLAP bytes early, the
+// instruction boundaries usually agree with the previous chunk by the start of the chunk. The
+// merge continues at the address where the previous chunk's last instruction ends, it is
+// decoded again from there if the chunk has no instruction starting at that address.
+
+#define DISASSEMBLY_DB_PER_LINE 16
+
+#define DISASSEMBLY_CHUNK_SIZE (4 * 1024)  // the cs of a chunk is set to its start, its ip stays in the segment
+#define DISASSEMBLY_CHUNK_OVERLAP 32
+
+// --decode-stream <file> decodes linearly from a file or a pipe (- is stdin) of any size through a
+// small window instead of the guest memory, the addresses continue from cs:ip like the linear decode
+#define DISASSEMBLY_STREAM_WINDOW (32 * 1024)
+#define DISASSEMBLY_STREAM_CARRY 16 // decoded only with this many bytes ahead (after the prefixes), longer than any instruction
+
+typedef enum {
+    Byte_Code              = (1 << 0), // part of an instruction (prefixes included)
+    Byte_Instruction_Start = (1 << 1), // the first byte of an instruction, its first prefix if it has one
+    Byte_Jump_Target       = (1 << 2), // a direct jump or call lands here
+} Byte_Kind;
+
+#define DISASSEMBLY_NO_TARGET 0xFFFFFFFF
+
+// Where the execution can continue after an instruction
+typedef enum {
+    Flow_Next,   // the next instruction
+    Flow_Branch, // conditional jump or loop: the target or the next instruction
+    Flow_Jump,   // the target only, an indirect jump has no known target
+    Flow_Call,   // the target, then the next instruction after the return
+    Flow_Return, // ret, retf, iret
+    Flow_Stop,   // hlt
+} Instruction_Flow;
+
+typedef struct {
+    u32 address; // the first prefix, instruction.mem_address is the opcode
+    u32 size;    // with the prefixes
+    u32 target;  // absolute destination of a direct jump or call inside the program, DISASSEMBLY_NO_TARGET otherwise
+    u8 flow;     // Instruction_Flow
+    Instruction instruction;
+} Decoded_Instruction;
+
+typedef struct {
+    u32 start; // absolute, the entry point
+    u32 end;   // absolute, exclusive
+    u8 *kinds; // Byte_Kind bits of every byte in [start, end)
+
+    Decoded_Instruction *instructions; // in address order
+    u32 instruction_count;
+    u32 instruction_capacity;
+} Disassembly;
+
+typedef struct {
+    u32 begin; // the first decoded instruction
+    u32 end;   // absolute, exclusive, the instructions which start before it belong to the chunk
+    u32 next;  // the address after the last decoded instruction
+
+    u32 *addresses; // the start of every instruction, its first prefix if it has one
+    u32 *offsets;   // the text of instruction i is text[offsets[i], offsets[i + 1])
+    u32 count;
+    u32 capacity;
+
+    char *text;
+    u32 text_capacity;
+} Linear_Chunk;
+
+// The program has to be loaded, the registers and the memory are not changed
+Disassembly *disassembly_create(CPU *cpu);
+void disassembly_destroy(Disassembly *disassembly);
+
+// The printers write to stdout in cpu->decode_format (decode_output.h)
+void disassembly_print(CPU *cpu, Disassembly *disassembly);
+
+// Prints every instruction from cs:ip to the end of the program, on up to thread_count threads
+void disassembly_print_linear(CPU *cpu, u32 thread_count);
+
+// The cpu has to be booted, nothing is loaded into its memory
+void disassembly_print_stream(CPU *cpu, FILE *input);
+
+#endif
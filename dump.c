@@ -0,0 +1,143 @@
+#include "dump.h"
+
+Memory_Dump *memory_dump_create(const char *filename, u64 interval, u8 rle)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        printf("\n[ERROR]: Failed to open %s for the memory dump.\n", filename);
+        return NULL;
+    }
+
+    Memory_Dump *dump = (Memory_Dump *)calloc(1, sizeof(Memory_Dump));
+    assert(dump != NULL);
+
+    dump->file = fp;
+    dump->rle = rle;
+    dump->interval = interval;
+    dump->next_at = interval ? 0 : (u64)-1;
+
+    Dump_File_Header header = {0};
+    memcpy(header.magic, DUMP_FILE_MAGIC, sizeof(header.magic));
+    header.version = DUMP_FILE_VERSION;
+    header.page_size = MEMORY_PAGE_SIZE;
+    header.page_count = MEMORY_PAGE_COUNT;
+
+    fwrite(&header, sizeof(header), 1, fp);
+    dump->bytes = sizeof(header);
+
+    return dump;
+}
+
+void memory_dump_destroy(Memory_Dump *dump)
+{
+    fclose(dump->file);
+    free(dump);
+}
+
+static u8 page_is_zero(u8 *page)
+{
+    for (u32 i = 0; i < MEMORY_PAGE_SIZE; i += sizeof(u64)) {
+        if (*(u64 *)(page + i)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// PackBits, returns the compressed size
+static u32 packbits(const u8 *src, u32 size, u8 *dest)
+{
+    u32 in = 0;
+    u32 out = 0;
+
+    while (in < size) {
+        // Three equal bytes are already worth a repeat
+        u32 run = 1;
+        while (in + run < size && run < 128 && src[in + run] == src[in]) {
+            run++;
+        }
+
+        if (run >= 3) {
+            dest[out++] = (u8)(257 - run);
+            dest[out++] = src[in];
+            in += run;
+            continue;
+        }
+
+        // Literals until the next run
+        u32 start = in;
+        u32 count = 0;
+        while (in < size && count < 128) {
+            if (in + 2 < size && src[in] == src[in + 1] && src[in] == src[in + 2]) {
+                break;
+            }
+            in++;
+            count++;
+        }
+
+        dest[out++] = (u8)(count - 1);
+        memcpy(dest + out, src + start, count);
+        out += count;
+    }
+
+    return out;
+}
+
+void memory_dump_frame(CPU *cpu, Memory_Dump *dump, u8 full)
+{
+    u32 pages[MEMORY_PAGE_COUNT];
+    u32 page_count = 0;
+
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        u8 selected = full ? !page_is_zero(cpu->memory + page * MEMORY_PAGE_SIZE) : (cpu->page_flags[page] & Page_Dirty_Dump);
+        if (selected) {
+            pages[page_count++] = page;
+        }
+
+        cpu->page_flags[page] &= ~Page_Dirty_Dump;
+    }
+
+    Dump_Frame_Header frame = {0};
+    frame.instructions = cpu->stats.instructions;
+    frame.page_count = page_count;
+    frame.full = full;
+    fwrite(&frame, sizeof(frame), 1, dump->file);
+    dump->bytes += sizeof(frame);
+
+    for (u32 i = 0; i < page_count; i++) {
+        u8 *data = cpu->memory + pages[i] * MEMORY_PAGE_SIZE;
+
+        Dump_Page_Header record = {0};
+        record.page = pages[i];
+
+        if (page_is_zero(data)) {
+            record.encoding = Dump_Page_Zero;
+            record.size = 0;
+        } else {
+            record.encoding = Dump_Page_Raw;
+            record.size = MEMORY_PAGE_SIZE;
+
+            if (dump->rle) {
+                u32 size = packbits(data, MEMORY_PAGE_SIZE, dump->scratch);
+                if (size < MEMORY_PAGE_SIZE) {
+                    record.encoding = Dump_Page_Rle;
+                    record.size = size;
+                    data = dump->scratch;
+                }
+            }
+        }
+
+        fwrite(&record, sizeof(record), 1, dump->file);
+        fwrite(data, 1, record.size, dump->file);
+        dump->bytes += sizeof(record) + record.size;
+    }
+
+    // Flushed, so a watcher sees complete frames
+    fflush(dump->file);
+
+    dump->frames++;
+    dump->pages += page_count;
+    if (dump->interval) {
+        dump->next_at = cpu->stats.instructions + dump->interval;
+    }
+}
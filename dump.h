@@ -0,0 +1,71 @@
+#ifndef _H_DUMP
+#define _H_DUMP
+
+#include "sim86.h"
+
+// Sparse memory dumps, only the pages which are worth writing:
+//
+//   --dump-sparse <file>   the non-zero pages at exit (--dump writes the raw megabyte instead)
+//   --dump-every <n>       the non-zero pages before the first instruction, then every n
+//                          instructions and at exit only the pages written since the previous frame
+//   --dump-rle             the pages are PackBits compressed if that makes them smaller
+//
+// Layout (native endian):
+//   Dump_File_Header
+//   frames: Dump_Frame_Header, then page_count times Dump_Page_Header + size bytes
+//
+// The memory at a frame is the previous memory with the pages of the frame replaced, the
+// first frame is applied to a zero memory. A written page which went back to zero is a
+// Dump_Page_Zero record. demo/sparse_dump.py expands a frame into a raw memory image.
+
+#define DUMP_DEFAULT_FILENAME "./memory_dump.s86" // if only --dump-every is given
+#define DUMP_FILE_MAGIC "S86DUMP"
+#define DUMP_FILE_VERSION 1
+
+typedef enum {
+    Dump_Page_Zero, // size 0
+    Dump_Page_Raw,  // size MEMORY_PAGE_SIZE
+    Dump_Page_Rle,  // PackBits: n < 128 copies the next n+1 bytes, n > 128 repeats the next byte 257-n times
+} Dump_Page_Encoding;
+
+typedef struct {
+    char magic[8];
+    u32 version;
+    u32 page_size;
+    u32 page_count;
+} Dump_File_Header;
+
+typedef struct {
+    u64 instructions;
+    u32 page_count;
+    u32 full; // 1 if the frame has every non-zero page, 0 if only the written ones
+} Dump_Frame_Header;
+
+typedef struct {
+    u32 page;
+    u16 encoding; // Dump_Page_Encoding
+    u16 size;
+} Dump_Page_Header;
+
+struct Memory_Dump {
+    FILE *file;
+    u8 rle;
+
+    u64 interval; // 0 if only the exit is dumped
+    u64 next_at;  // the instruction count of the next frame
+
+    u32 frames;
+    u64 pages;
+    u64 bytes;
+
+    u8 scratch[MEMORY_PAGE_SIZE + MEMORY_PAGE_SIZE / 128 + 1]; // worst case PackBits page
+};
+
+// Returns NULL if the file can't be opened
+Memory_Dump *memory_dump_create(const char *filename, u64 interval, u8 rle);
+void memory_dump_destroy(Memory_Dump *dump);
+
+// full: every non-zero page, otherwise the pages written since the previous frame
+void memory_dump_frame(CPU *cpu, Memory_Dump *dump, u8 full);
+
+#endif
@@ -0,0 +1,105 @@
+#include "fork_server.h"
+#include "port_io.h"
+#include "simulator.h"
+
+u8 fork_server_run_to(CPU *cpu, u32 address)
+{
+    while (calc_inst_pointer_address(cpu) != address) {
+        if (calc_inst_pointer_address(cpu) >= cpu->exec_end || cpu->terminate) {
+            printf("\n[ERROR]: The guest stopped before reaching the snapshot point %05X.\n", address);
+            return 0;
+        }
+
+        step_instruction(cpu);
+    }
+
+    return 1;
+}
+
+Fork_Server *fork_server_create(CPU *cpu)
+{
+    Fork_Server *server = (Fork_Server *)calloc(1, sizeof(Fork_Server));
+    assert(server != NULL);
+
+    server->memory = (u8 *)malloc(MAX_MEMORY);
+    assert(server->memory != NULL);
+
+    memcpy(server->memory, cpu->memory, MAX_MEMORY);
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        cpu->page_flags[page] &= ~Page_Dirty_Fork;
+    }
+
+    server->ip = cpu->ip;
+    server->flags = cpu->flags;
+    memcpy(server->regmem, cpu->regmem, sizeof(server->regmem));
+    server->stats = cpu->stats;
+    server->port_input_cursor = cpu->io->input_cursor;
+
+    server->end_address = FORK_SERVER_NO_END;
+    server->instruction_limit = FORK_SERVER_DEFAULT_LIMIT;
+
+    return server;
+}
+
+void fork_server_destroy(Fork_Server *server)
+{
+    free(server->memory);
+    free(server);
+}
+
+void fork_server_restore(CPU *cpu, Fork_Server *server)
+{
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        if (cpu->page_flags[page] & Page_Dirty_Fork) {
+            u32 offset = page * MEMORY_PAGE_SIZE;
+            memcpy(cpu->memory + offset, server->memory + offset, MEMORY_PAGE_SIZE);
+
+            // For the other users the restore is just another write
+            mark_memory_dirty(cpu, offset, MEMORY_PAGE_SIZE);
+            cpu->page_flags[page] &= ~Page_Dirty_Fork;
+            server->restored_pages++;
+        }
+    }
+
+    cpu->ip = server->ip;
+    cpu->flags = server->flags;
+    cpu->terminate = 0;
+    cpu->fault = Cpu_Fault_None;
+    memcpy(cpu->regmem, server->regmem, sizeof(cpu->regmem));
+    cpu->stats = server->stats;
+    cpu->io->input_cursor = server->port_input_cursor;
+}
+
+Fork_Server_Result fork_server_iteration(CPU *cpu, Fork_Server *server)
+{
+    Fork_Server_Result result = Fork_Server_Exit;
+    u64 limit = server->stats.instructions + server->instruction_limit;
+
+    for (;;) {
+        u32 address = calc_inst_pointer_address(cpu);
+        if (address >= cpu->exec_end || address == server->end_address) {
+            break;
+        }
+
+        if (cpu->stats.instructions >= limit) {
+            result = Fork_Server_Timeout;
+            server->timeouts++;
+            break;
+        }
+
+        step_instruction(cpu);
+
+        if (cpu->terminate) {
+            result = Fork_Server_Crash;
+            server->crashes++;
+            break;
+        }
+    }
+
+    server->iterations++;
+    server->instructions += cpu->stats.instructions - server->stats.instructions;
+
+    fork_server_restore(cpu, server);
+
+    return result;
+}
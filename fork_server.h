@@ -0,0 +1,56 @@
+#ifndef _H_FORK_SERVER
+#define _H_FORK_SERVER
+
+#include "sim86.h"
+
+// Persistent mode: the machine state is captured once at the snapshot point, then the guest
+// is executed from there again and again. After every iteration only the pages written
+// since the snapshot (Page_Dirty_Fork) and the register file are restored, so a short
+// routine costs a few page copies instead of a boot() and a load_executable().
+//
+//   --persistent <n>         run n iterations and report the executions per second
+//   --snapshot-at <addr>     run until this absolute address before taking the snapshot (default: entry point)
+//   --iteration-end <addr>   an iteration also ends when it reaches this absolute address
+//   --iteration-limit <n>    instructions per iteration before it is counted as a timeout
+
+#define FORK_SERVER_DEFAULT_LIMIT 1000000
+#define FORK_SERVER_NO_END MAX_MEMORY
+
+typedef struct {
+    u8 *memory; // the guest memory at the snapshot point
+
+    u16 ip;
+    u16 flags;
+    u8 regmem[64];
+    Cpu_Stats stats;
+    u32 port_input_cursor;
+
+    u32 end_address;       // FORK_SERVER_NO_END if only the end of the program stops the iteration
+    u64 instruction_limit;
+
+    u64 iterations;
+    u64 timeouts;
+    u64 crashes;           // the guest hit an unhandled instruction
+    u64 restored_pages;
+    u64 instructions;
+} Fork_Server;
+
+// Runs the guest until the instruction at the absolute address, returns 0 if it stops before reaching it
+u8 fork_server_run_to(CPU *cpu, u32 address);
+
+// Takes the snapshot of the current state of the cpu
+Fork_Server *fork_server_create(CPU *cpu);
+void fork_server_destroy(Fork_Server *server);
+
+typedef enum {
+    Fork_Server_Exit,    // the guest ran off the end of the program or reached the end address
+    Fork_Server_Timeout,
+    Fork_Server_Crash,   // unhandled instruction
+} Fork_Server_Result;
+
+// Runs the guest from the snapshot until it stops, then restores the snapshot
+Fork_Server_Result fork_server_iteration(CPU *cpu, Fork_Server *server);
+
+void fork_server_restore(CPU *cpu, Fork_Server *server);
+
+#endif
@@ -0,0 +1,370 @@
+#include "fuzzer.h"
+#include "fork_server.h"
+#include "port_io.h"
+
+#ifdef _WIN32
+
+// The AFL shared memory and the corpus directory are POSIX, the fuzzer is only in those builds
+Fuzzer *fuzzer_create(u64 seed)
+{
+    printf("\n[ERROR]: The fuzzer (--fuzz) is not available on Windows.\n");
+    return NULL;
+}
+
+void fuzzer_destroy(Fuzzer *fuzzer)
+{
+    free(fuzzer);
+}
+
+void fuzzer_load_corpus(Fuzzer *fuzzer, const char *directory)
+{
+}
+
+void fuzzer_run(CPU *cpu, Fuzzer *fuzzer, u64 executions, u32 end_address, u64 instruction_limit)
+{
+}
+
+#else
+
+#include <time.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+
+#define AFL_SHM_ENV "__AFL_SHM_ID"
+
+// AFL's hit count buckets, the loop counts only matter in orders of magnitude
+static const u8 count_class[256] = {
+    [0]          = 0,
+    [1]          = 1,
+    [2]          = 2,
+    [3]          = 4,
+    [4 ... 7]    = 8,
+    [8 ... 15]   = 16,
+    [16 ... 31]  = 32,
+    [32 ... 127] = 64,
+    [128 ... 255] = 128,
+};
+
+static const u8 interesting_bytes[] = { 0x00, 0x01, 0x10, 0x20, 0x40, 0x7F, 0x80, 0xFF };
+static const u16 interesting_words[] = { 0x0000, 0x0001, 0x00FF, 0x0100, 0x7FFF, 0x8000, 0xFFFE, 0xFFFF };
+
+Fuzzer *fuzzer_create(u64 seed)
+{
+    Fuzzer *fuzzer = (Fuzzer *)calloc(1, sizeof(Fuzzer));
+    assert(fuzzer != NULL);
+
+    memset(fuzzer->virgin, 0xFF, sizeof(fuzzer->virgin));
+    fuzzer->random_state = seed ? seed : 0x9E3779B97F4A7C15ul;
+
+    char *shm_id = getenv(AFL_SHM_ENV);
+    if (shm_id) {
+        void *map = shmat(atoi(shm_id), NULL, 0);
+        if (map == (void *)-1) {
+            printf("\n[ERROR]: Failed to attach the AFL shared memory %s.\n", shm_id);
+            assert(0);
+        }
+
+        fuzzer->coverage.map = (u8 *)map;
+        fuzzer->coverage.shared = 1;
+    } else {
+        fuzzer->coverage.map = (u8 *)calloc(1, COVERAGE_MAP_SIZE);
+        assert(fuzzer->coverage.map != NULL);
+    }
+
+    return fuzzer;
+}
+
+void fuzzer_destroy(Fuzzer *fuzzer)
+{
+    if (fuzzer->coverage.shared) {
+        shmdt(fuzzer->coverage.map);
+    } else {
+        free(fuzzer->coverage.map);
+    }
+
+    for (u32 i = 0; i < fuzzer->corpus_count; i++) {
+        free(fuzzer->corpus[i].data);
+    }
+
+    free(fuzzer->corpus);
+    free(fuzzer);
+}
+
+// xorshift64*
+static u64 random_next(Fuzzer *fuzzer)
+{
+    u64 x = fuzzer->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    fuzzer->random_state = x;
+    return x * 0x2545F4914F6CDD1Dul;
+}
+
+static u32 random_below(Fuzzer *fuzzer, u32 limit)
+{
+    return (u32)(random_next(fuzzer) % limit);
+}
+
+static void corpus_add(Fuzzer *fuzzer, u8 *data, u32 size)
+{
+    if (fuzzer->corpus_count == fuzzer->corpus_capacity) {
+        fuzzer->corpus_capacity = fuzzer->corpus_capacity ? fuzzer->corpus_capacity * 2 : 64;
+        fuzzer->corpus = (Fuzz_Input *)realloc(fuzzer->corpus, fuzzer->corpus_capacity * sizeof(Fuzz_Input));
+        assert(fuzzer->corpus != NULL);
+    }
+
+    Fuzz_Input *input = &fuzzer->corpus[fuzzer->corpus_count++];
+    input->data = (u8 *)malloc(size ? size : 1);
+    assert(input->data != NULL);
+
+    memcpy(input->data, data, size);
+    input->size = size;
+}
+
+// The id is the next one to try, the existing files of an earlier run are skipped instead of overwritten
+static void save_input(const char *directory, const char *subdirectory, u64 *id, u8 *data, u32 size)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s%s", directory, subdirectory);
+    mkdir(directory, 0755);
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        printf("\n[ERROR]: Failed to create the %s directory.\n", path);
+        return;
+    }
+
+    int fd;
+    do {
+        snprintf(path, sizeof(path), "%s%s/id_%06lu", directory, subdirectory, (*id)++);
+        fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    } while (fd < 0 && errno == EEXIST);
+
+    if (fd < 0) {
+        printf("\n[ERROR]: Failed to open %s for the fuzzer input.\n", path);
+        return;
+    }
+
+    FILE *fp = fdopen(fd, "wb");
+    assert(fp != NULL);
+    fwrite(data, 1, size, fp);
+    fclose(fp);
+}
+
+void fuzzer_load_corpus(Fuzzer *fuzzer, const char *directory)
+{
+    fuzzer->corpus_directory = directory;
+
+    DIR *dir = opendir(directory);
+    if (dir == NULL) {
+        return; // created at the first save
+    }
+
+    u8 *buffer = (u8 *)malloc(FUZZ_MAX_INPUT);
+    assert(buffer != NULL);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+
+        struct stat file_stat;
+        if (stat(path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+            continue;
+        }
+
+        FILE *fp = fopen(path, "rb");
+        if (fp == NULL) {
+            continue;
+        }
+
+        u32 size = fread(buffer, 1, FUZZ_MAX_INPUT, fp);
+        fclose(fp);
+
+        corpus_add(fuzzer, buffer, size);
+    }
+
+    closedir(dir);
+    free(buffer);
+}
+
+// A few stacked byte level mutations, the size only changes for the port stream
+static void mutate(Fuzzer *fuzzer, u8 *data, u32 *size, u32 capacity, u8 fixed_size)
+{
+    u32 count = 1 + random_below(fuzzer, FUZZ_MAX_STACKED_MUTATIONS);
+
+    for (u32 i = 0; i < count; i++) {
+        if (*size == 0) {
+            data[(*size)++] = (u8)random_next(fuzzer);
+            continue;
+        }
+
+        u32 at = random_below(fuzzer, *size);
+
+        switch (random_below(fuzzer, fixed_size ? 5 : 7)) {
+            case 0: data[at] ^= 1 << random_below(fuzzer, 8); break;
+            case 1: data[at] = (u8)random_next(fuzzer); break;
+            case 2: data[at] = interesting_bytes[random_below(fuzzer, ARRAY_SIZE(interesting_bytes))]; break;
+            case 3: data[at] += (u8)(random_below(fuzzer, 35) - 17); break;
+            case 4: {
+                if (at + 1 < *size) {
+                    u16 word = interesting_words[random_below(fuzzer, ARRAY_SIZE(interesting_words))];
+                    data[at] = word & 0xFF;
+                    data[at + 1] = word >> 8;
+                }
+                break;
+            }
+            case 5: {
+                if (*size < capacity) {
+                    memmove(data + at + 1, data + at, *size - at);
+                    data[at] = (u8)random_next(fuzzer);
+                    (*size)++;
+                }
+                break;
+            }
+            case 6: {
+                memmove(data + at, data + at + 1, *size - at - 1);
+                (*size)--;
+                break;
+            }
+        }
+    }
+}
+
+// Returns 1 if the last execution reached a new edge or a new hit count bucket
+static u8 update_virgin(Fuzzer *fuzzer)
+{
+    u8 *map = fuzzer->coverage.map;
+    u8 new_coverage = 0;
+
+    for (u32 i = 0; i < COVERAGE_MAP_SIZE; i++) {
+        // The map is mostly empty, skip it a word at a time
+        if ((i % sizeof(u64)) == 0 && *(u64 *)(map + i) == 0) {
+            i += sizeof(u64) - 1;
+            continue;
+        }
+
+        if (map[i] == 0) {
+            continue;
+        }
+
+        u8 bucket = count_class[map[i]];
+        if (bucket & fuzzer->virgin[i]) {
+            if (fuzzer->virgin[i] == 0xFF) {
+                fuzzer->edges++;
+            }
+            fuzzer->virgin[i] &= ~bucket;
+            new_coverage = 1;
+        }
+    }
+
+    return new_coverage;
+}
+
+static Fork_Server_Result execute(CPU *cpu, Fuzzer *fuzzer, Fork_Server *server, u8 *input, u32 size, u8 *new_coverage)
+{
+    ZERO_MEMORY(fuzzer->coverage.map, COVERAGE_MAP_SIZE);
+    fuzzer->coverage.previous = 0;
+
+    if (fuzzer->memory_size) {
+        memcpy(cpu->memory + fuzzer->memory_address, input, size);
+        mark_memory_dirty(cpu, fuzzer->memory_address, size);
+    } else {
+        cpu->io->input = input;
+        cpu->io->input_size = size;
+        cpu->io->input_cursor = 0;
+    }
+
+    Fork_Server_Result result = fork_server_iteration(cpu, server);
+    fuzzer->executions++;
+
+    if (result == Fork_Server_Crash)   fuzzer->crashes++;
+    if (result == Fork_Server_Timeout) fuzzer->timeouts++;
+
+    *new_coverage = update_virgin(fuzzer);
+    return result;
+}
+
+void fuzzer_run(CPU *cpu, Fuzzer *fuzzer, u64 executions, u32 end_address, u64 instruction_limit)
+{
+    u8 fixed_size = fuzzer->memory_size != 0;
+    u32 capacity = fixed_size ? fuzzer->memory_size : FUZZ_MAX_INPUT;
+    assert(fuzzer->memory_address + fuzzer->memory_size <= MAX_MEMORY);
+
+    Fork_Server *server = fork_server_create(cpu);
+    server->end_address = end_address;
+    if (instruction_limit) {
+        server->instruction_limit = instruction_limit;
+    }
+
+    // The port stream is replaced for the executions
+    u8 *original_input = cpu->io->input;
+    u32 original_input_size = cpu->io->input_size;
+
+    u8 *input = (u8 *)calloc(1, capacity);
+    assert(input != NULL);
+
+    if (fuzzer->corpus_count == 0) {
+        corpus_add(fuzzer, input, fixed_size ? capacity : FUZZ_DEFAULT_INPUT);
+    }
+
+    cpu->coverage = &fuzzer->coverage;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // The seeds run first, so what they already cover is not new later
+    u8 new_coverage = 0;
+    u32 seed_count = fuzzer->corpus_count;
+    for (u32 i = 0; i < seed_count; i++) {
+        u32 size = fuzzer->corpus[i].size < capacity ? fuzzer->corpus[i].size : capacity;
+        ZERO_MEMORY(input, capacity);
+        memcpy(input, fuzzer->corpus[i].data, size);
+        execute(cpu, fuzzer, server, input, fixed_size ? capacity : size, &new_coverage);
+    }
+
+    for (u64 n = 0; n < executions; n++) {
+        Fuzz_Input *parent = &fuzzer->corpus[random_below(fuzzer, fuzzer->corpus_count)];
+
+        u32 size = parent->size < capacity ? parent->size : capacity;
+        ZERO_MEMORY(input, capacity);
+        memcpy(input, parent->data, size);
+        if (fixed_size) {
+            size = capacity;
+        }
+
+        mutate(fuzzer, input, &size, capacity, fixed_size);
+
+        Fork_Server_Result result = execute(cpu, fuzzer, server, input, size, &new_coverage);
+
+        if (result == Fork_Server_Crash) {
+            if (new_coverage && fuzzer->corpus_directory) {
+                save_input(fuzzer->corpus_directory, "/crashes", &fuzzer->crash_id, input, size);
+            }
+        } else if (result == Fork_Server_Exit && new_coverage) {
+            corpus_add(fuzzer, input, size);
+            if (fuzzer->corpus_directory) {
+                save_input(fuzzer->corpus_directory, "", &fuzzer->queue_id, input, size);
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("\n[FUZZ]: %lu executions in %.3f s, %.0f executions/s\n", fuzzer->executions, seconds, fuzzer->executions / seconds);
+    printf("[FUZZ]: %u edges, %u corpus entries, %lu crashes, %lu timeouts\n",
+           fuzzer->edges, fuzzer->corpus_count, fuzzer->crashes, fuzzer->timeouts);
+
+    cpu->coverage = NULL;
+    cpu->io->input = original_input;
+    cpu->io->input_size = original_input_size;
+
+    free(input);
+    fork_server_destroy(server);
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef _H_FUZZER
+#define _H_FUZZER
+
+#include "sim86.h"
+
+// Coverage guided fuzzing on top of the fork server (make fuzz). The input is mutated
+// from the corpus and fed to the guest either through the port input stream or through a
+// buffer in the guest memory, then the guest runs from the snapshot point:
+//
+//   --fuzz <n>                    run n executions
+//   --corpus <dir>                the seeds are read from here and the new interesting inputs
+//                                 are written here, the crashing ones into <dir>/crashes, the
+//                                 files of an earlier run are kept and the new ids follow them
+//   --fuzz-memory <addr>:<size>   write the input to this absolute hex address instead of the port stream
+//   --fuzz-seed <n>               seed of the mutations
+//
+// The snapshot point and the end of an execution are set with the fork server options.
+//
+// The coverage is AFL style: every conditional jump and loop decision is an edge between the
+// previous and the current (address, taken) location, counted in a 64KiB map. If the
+// __AFL_SHM_ID environment variable is set the map is the AFL shared memory, so external
+// tools see the coverage too (the AFL fork server handshake is not implemented, run
+// afl-fuzz with AFL_NO_FORKSRV=1).
+
+#define COVERAGE_MAP_SIZE (1 << 16)
+
+#define FUZZ_MAX_INPUT 4096
+#define FUZZ_DEFAULT_INPUT 16 // size of the initial zero seed of the port stream if the corpus is empty
+#define FUZZ_MAX_STACKED_MUTATIONS 8
+
+struct Coverage {
+    u8 *map;
+    u32 previous; // the previous location shifted by one, so A->B and B->A are different edges
+    u8 shared;    // the map is attached AFL shared memory
+};
+
+typedef struct {
+    u8 *data;
+    u32 size;
+} Fuzz_Input;
+
+typedef struct {
+    Coverage coverage;
+    u8 virgin[COVERAGE_MAP_SIZE]; // the bucketed counts not seen yet, AFL's virgin_bits
+
+    Fuzz_Input *corpus;
+    u32 corpus_count;
+    u32 corpus_capacity;
+    const char *corpus_directory; // NULL if nothing is saved
+    u64 queue_id;                 // the next id_ of the saved inputs, the taken ones are skipped
+    u64 crash_id;                 // the same in <dir>/crashes
+
+    u32 memory_address; // the input goes to the guest memory if memory_size is not 0
+    u32 memory_size;
+
+    u64 random_state;
+
+    u64 executions;
+    u64 crashes;
+    u64 timeouts;
+    u32 edges;
+} Fuzzer;
+
+// Returns NULL on Windows
+Fuzzer *fuzzer_create(u64 seed);
+void fuzzer_destroy(Fuzzer *fuzzer);
+
+void fuzzer_load_corpus(Fuzzer *fuzzer, const char *directory);
+
+// The cpu has to be at the snapshot point
+void fuzzer_run(CPU *cpu, Fuzzer *fuzzer, u64 executions, u32 end_address, u64 instruction_limit);
+
+static inline u8 coverage_branch(CPU *cpu, u8 taken)
+{
+    Coverage *coverage = cpu->coverage;
+    if (coverage) {
+        // Cheap integer hash, so nearby addresses don't cluster in the map
+        u32 location = (cpu->instruction.mem_address * 2 + taken) * 2654435761u;
+        location = (location >> 16) & (COVERAGE_MAP_SIZE - 1);
+
+        coverage->map[location ^ coverage->previous]++;
+        coverage->previous = location >> 1;
+    }
+
+    return taken;
+}
+
+#endif
@@ -0,0 +1,558 @@
+#include "gdbstub.h"
+#include "debugger.h"
+#include "simulator.h"
+#include "replay.h"
+
+#ifdef _WIN32
+
+// No BSD sockets, the stub is only in the POSIX builds
+Gdb_Stub *gdb_stub_create(const char *address)
+{
+    printf("\n[ERROR]: The gdb stub (--gdb %s) is not available on Windows.\n", address);
+    return NULL;
+}
+
+void gdb_stub_destroy(Gdb_Stub *stub)
+{
+    free(stub);
+}
+
+u8 gdb_stub_stop(CPU *cpu)
+{
+    return 0;
+}
+
+void gdb_stub_exited(CPU *cpu)
+{
+}
+
+#else
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define GDB_SIGTRAP 5
+#define GDB_SIGINT  2
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static u32 parse_hex(const char **text)
+{
+    u32 value = 0;
+    int digit;
+    while ((digit = hex_value(**text)) >= 0) {
+        value = (value << 4) | digit;
+        (*text)++;
+    }
+    return value;
+}
+
+// Appends the value as little endian hex bytes, the way gdb sends the registers
+static char *put_hex_le(char *dest, u32 value, u32 bytes)
+{
+    for (u32 i = 0; i < bytes; i++) {
+        u8 byte = (value >> (i * 8)) & 0xFF;
+        *dest++ = hex_digits[byte >> 4];
+        *dest++ = hex_digits[byte & 0xF];
+    }
+    *dest = '\0';
+    return dest;
+}
+
+static u32 parse_hex_le(const char *text, u32 bytes)
+{
+    u32 value = 0;
+    for (u32 i = 0; i < bytes; i++) {
+        int hi = hex_value(text[i*2]);
+        int lo = hex_value(text[i*2 + 1]);
+        if (hi < 0 || lo < 0) break;
+        value |= (u32)((hi << 4) | lo) << (i * 8);
+    }
+    return value;
+}
+
+///////////////////////////////////////////////////
+// :Socket
+
+static int stub_read_byte(Gdb_Stub *stub)
+{
+    if (stub->input_cursor == stub->input_used) {
+        ssize_t received = recv(stub->fd, stub->input, sizeof(stub->input), 0);
+        if (received <= 0) {
+            return -1;
+        }
+        stub->input_used = received;
+        stub->input_cursor = 0;
+    }
+
+    return stub->input[stub->input_cursor++];
+}
+
+static void stub_write(Gdb_Stub *stub, const char *data, u32 size)
+{
+    while (size) {
+        ssize_t sent = send(stub->fd, data, size, 0);
+        if (sent <= 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += sent;
+        size -= sent;
+    }
+}
+
+static void send_packet(Gdb_Stub *stub, const char *payload)
+{
+    char *frame = stub->frame;
+
+    u32 length = strlen(payload);
+    assert(length < GDB_PACKET_SIZE);
+
+    u8 checksum = 0;
+    frame[0] = '$';
+    for (u32 i = 0; i < length; i++) {
+        frame[i+1] = payload[i];
+        checksum += (u8)payload[i];
+    }
+    frame[length+1] = '#';
+    frame[length+2] = hex_digits[checksum >> 4];
+    frame[length+3] = hex_digits[checksum & 0xF];
+
+    stub_write(stub, frame, length + 4);
+}
+
+// Returns the payload of the next packet in stub->packet, or NULL if the connection is closed.
+// A ctrl+c outside of a packet is returned as the "\x03" payload.
+static char *receive_packet(Gdb_Stub *stub)
+{
+    for (;;) {
+        int c = stub_read_byte(stub);
+        if (c < 0) {
+            return NULL;
+        }
+
+        if (c == 0x03) {
+            stub->packet[0] = 0x03;
+            stub->packet[1] = '\0';
+            return stub->packet;
+        }
+
+        if (c != '$') {
+            continue; // acks and the noise between the packets
+        }
+
+        u32 length = 0;
+        u8 checksum = 0;
+        while ((c = stub_read_byte(stub)) >= 0 && c != '#') {
+            if (length < GDB_PACKET_SIZE - 1) {
+                stub->packet[length++] = c;
+            }
+            checksum += (u8)c;
+        }
+        stub->packet[length] = '\0';
+
+        int hi = stub_read_byte(stub);
+        int lo = stub_read_byte(stub);
+        if (hi < 0 || lo < 0) {
+            return NULL;
+        }
+
+        if (hex_value(hi) * 16 + hex_value(lo) != checksum) {
+            stub_write(stub, "-", 1);
+            continue;
+        }
+
+        stub_write(stub, "+", 1);
+        return stub->packet;
+    }
+}
+
+// Non blocking check for the ctrl+c break
+static u8 break_requested(Gdb_Stub *stub)
+{
+    while (stub->input_cursor < stub->input_used) {
+        if (stub->input[stub->input_cursor++] == 0x03) {
+            return 1;
+        }
+    }
+
+    u8 byte;
+    while (recv(stub->fd, &byte, 1, MSG_DONTWAIT) == 1) {
+        if (byte == 0x03) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+Gdb_Stub *gdb_stub_create(const char *address)
+{
+    Gdb_Stub *stub = (Gdb_Stub *)calloc(1, sizeof(Gdb_Stub));
+    assert(stub != NULL);
+
+    if (strchr(address, '/')) {
+        struct sockaddr_un local = {0};
+        local.sun_family = AF_UNIX;
+        assert(strlen(address) < sizeof(local.sun_path));
+        strcpy(local.sun_path, address);
+        unlink(address);
+
+        stub->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(stub->listen_fd >= 0);
+
+        if (bind(stub->listen_fd, (struct sockaddr *)&local, sizeof(local)) != 0) {
+            printf("\n[ERROR]: Failed to bind the gdb stub to %s\n", address);
+            assert(0);
+        }
+    } else {
+        struct sockaddr_in local = {0};
+        local.sin_family = AF_INET;
+        local.sin_port = htons((u16)atoi(address));
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        stub->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(stub->listen_fd >= 0);
+
+        int reuse = 1;
+        setsockopt(stub->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (bind(stub->listen_fd, (struct sockaddr *)&local, sizeof(local)) != 0) {
+            printf("\n[ERROR]: Failed to bind the gdb stub to 127.0.0.1:%s\n", address);
+            assert(0);
+        }
+    }
+
+    listen(stub->listen_fd, 1);
+    fprintf(stderr, "[GDB]: waiting for gdb on %s\n", address);
+
+    stub->fd = accept(stub->listen_fd, NULL, NULL);
+    assert(stub->fd >= 0);
+
+    int no_delay = 1;
+    setsockopt(stub->fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    fprintf(stderr, "[GDB]: connected\n");
+
+    return stub;
+}
+
+void gdb_stub_destroy(Gdb_Stub *stub)
+{
+    if (stub->fd >= 0) close(stub->fd);
+    close(stub->listen_fd);
+    free(stub);
+}
+
+///////////////////////////////////////////////////
+// :Registers
+
+// The i386 register order: eax ecx edx ebx esp ebp esi edi eip eflags cs ss ds es fs gs
+// Register_none stands for the flags, Register_count for the fs and gs which don't exist on the 8086.
+static const Register gdb_register_map[GDB_REGISTER_COUNT] = {
+    Register_ax, Register_cx, Register_dx, Register_bx,
+    Register_sp, Register_bp, Register_si, Register_di,
+    Register_ip, Register_none,
+    Register_cs, Register_ss, Register_ds, Register_es,
+    Register_count, Register_count
+};
+
+static u32 read_gdb_register(CPU *cpu, u32 index)
+{
+    Register reg = gdb_register_map[index];
+
+    if (reg == Register_ip)    return calc_inst_pointer_address(cpu);
+    if (reg == Register_none)  return cpu->flags;
+    if (reg == Register_count) return 0;
+
+    return get_data_from_register(cpu, register_access_by_enum(reg));
+}
+
+static void write_gdb_register(CPU *cpu, u32 index, u32 value)
+{
+    Register reg = gdb_register_map[index];
+
+    if (reg == Register_ip) {
+        u16 cs_segment = get_data_from_register(cpu, register_access_by_enum(Register_cs));
+        cpu->ip = value - (cs_segment << 4);
+    }
+    else if (reg == Register_none) {
+        cpu->flags = value;
+    }
+    else if (reg != Register_count) {
+        set_data_to_register(cpu, register_access_by_enum(reg), value);
+    }
+}
+
+///////////////////////////////////////////////////
+// :Breakpoints
+
+static u8 update_breakpoint(CPU *cpu, const char *args, u8 insert)
+{
+    Debugger *debugger = cpu->debugger;
+
+    u32 type = parse_hex(&args);
+    if (*args++ != ',') return 0;
+    u32 address = parse_hex(&args) & (MAX_MEMORY - 1);
+    if (*args++ != ',') return 0;
+    u32 length = parse_hex(&args);
+
+    switch (type) {
+        case 0: // software
+        case 1: // hardware
+            if (insert) debugger->breakpoints[address >> 3] |= (1 << (address & 7));
+            else        debugger->breakpoints[address >> 3] &= ~(1 << (address & 7));
+            return 1;
+        case 2: // write watchpoint
+        case 3: // read watchpoint
+        case 4: // access watchpoint
+        {
+            u8 kind = (type == 2) ? Page_Watch_Write : (type == 3) ? Page_Watch_Read : (Page_Watch_Read|Page_Watch_Write);
+            for (u32 i = 0; i < (length ? length : 1); i++) {
+                u32 watched = (address + i) & (MAX_MEMORY - 1);
+                u8 current = debugger->watchpoints[watched];
+                debugger_set_watchpoint(cpu, watched, insert ? (current | kind) : (current & ~kind));
+            }
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////
+// :Commands
+
+static void send_stop_reply(CPU *cpu, u8 signal)
+{
+    Debugger *debugger = cpu->debugger;
+    Gdb_Stub *stub = cpu->gdb;
+
+    char *reply = stub->reply;
+    reply += sprintf(reply, "T%02x", signal);
+
+    if (debugger->watch_hit_kind) {
+        const char *kind = (debugger->watch_hit_kind == Page_Watch_Write) ? "watch" : "rwatch";
+        reply += sprintf(reply, "%s:%x;", kind, debugger->watch_hit_address);
+        debugger->watch_hit_kind = 0;
+    }
+
+    send_packet(stub, stub->reply);
+}
+
+// Serves the packets until gdb resumes the guest. Returns 0 if the simulation has to stop.
+static u8 serve_commands(CPU *cpu)
+{
+    Debugger *debugger = cpu->debugger;
+    Gdb_Stub *stub = cpu->gdb;
+
+    char *reply = stub->reply;
+
+    for (;;) {
+        char *packet = receive_packet(stub);
+        if (packet == NULL) {
+            return 0;
+        }
+
+        const char *args = packet + 1;
+        reply[0] = '\0';
+
+        switch (packet[0]) {
+            case 0x03:
+            case '?': {
+                send_stop_reply(cpu, GDB_SIGTRAP);
+                continue;
+            }
+            case 'g': {
+                char *dest = reply;
+                for (u32 i = 0; i < GDB_REGISTER_COUNT; i++) {
+                    dest = put_hex_le(dest, read_gdb_register(cpu, i), 4);
+                }
+                break;
+            }
+            case 'G': {
+                for (u32 i = 0; i < GDB_REGISTER_COUNT && strlen(args) >= (i + 1) * 8; i++) {
+                    write_gdb_register(cpu, i, parse_hex_le(args + i * 8, 4));
+                }
+                strcpy(reply, "OK");
+                break;
+            }
+            case 'p': {
+                u32 index = parse_hex(&args);
+                if (index < GDB_REGISTER_COUNT) put_hex_le(reply, read_gdb_register(cpu, index), 4);
+                else                            strcpy(reply, "E01");
+                break;
+            }
+            case 'P': {
+                u32 index = parse_hex(&args);
+                if (index < GDB_REGISTER_COUNT && *args == '=') {
+                    write_gdb_register(cpu, index, parse_hex_le(args + 1, 4));
+                    strcpy(reply, "OK");
+                } else {
+                    strcpy(reply, "E01");
+                }
+                break;
+            }
+            case 'm': {
+                u32 address = parse_hex(&args);
+                args++;
+                u32 length = parse_hex(&args);
+                if (length * 2 >= GDB_PACKET_SIZE) length = GDB_PACKET_SIZE / 2 - 1;
+
+                char *dest = reply;
+                for (u32 i = 0; i < length; i++) {
+                    dest = put_hex_le(dest, cpu->memory[(address + i) & (MAX_MEMORY - 1)], 1);
+                }
+                break;
+            }
+            case 'M': {
+                u32 address = parse_hex(&args);
+                args++;
+                u32 length = parse_hex(&args);
+                args++;
+
+                for (u32 i = 0; i < length && args[i*2] && args[i*2+1]; i++) {
+                    cpu->memory[(address + i) & (MAX_MEMORY - 1)] = parse_hex_le(args + i * 2, 1);
+                    mark_memory_dirty(cpu, address + i, 1);
+                }
+                strcpy(reply, "OK");
+                break;
+            }
+            case 'c':
+            case 's': {
+                if (*args) {
+                    write_gdb_register(cpu, 8, parse_hex(&args));
+                }
+
+                stub->resumed = 1;
+                stub->continuing = (packet[0] == 'c');
+                debugger->steps_left = stub->continuing ? GDB_POLL_INTERVAL : 1;
+                return 1;
+            }
+            case 'b': {
+                // Reverse execution, only offered in qSupported with --record
+                if (cpu->replay == NULL || (*args != 's' && *args != 'c')) {
+                    break;
+                }
+
+                u8 moved = 1;
+                if (*args == 's') {
+                    u64 current = cpu->stats.instructions;
+                    moved = current > replay_first_instruction(cpu->replay);
+                    replay_seek(cpu, current ? current - 1 : 0);
+                } else {
+                    moved = replay_reverse_continue(cpu);
+                }
+
+                if (moved) {
+                    send_stop_reply(cpu, GDB_SIGTRAP);
+                } else {
+                    sprintf(reply, "T%02xreplaylog:begin;", GDB_SIGTRAP);
+                    send_packet(stub, reply);
+                }
+                continue;
+            }
+            case 'Z':
+            case 'z': {
+                strcpy(reply, update_breakpoint(cpu, args, packet[0] == 'Z') ? "OK" : "");
+                break;
+            }
+            case 'H': {
+                strcpy(reply, "OK");
+                break;
+            }
+            case 'k': {
+                return 0;
+            }
+            case 'D': {
+                send_packet(stub, "OK");
+
+                // Let the guest finish on its own
+                close(stub->fd);
+                stub->fd = -1;
+                ZERO_MEMORY(debugger->breakpoints, sizeof(debugger->breakpoints));
+                return 1;
+            }
+            case 'q': {
+                if (strncmp(packet, "qSupported", 10) == 0) {
+                    sprintf(reply, "PacketSize=%x;swbreak+;hwbreak+%s", GDB_PACKET_SIZE - 1,
+                            cpu->replay ? ";ReverseStep+;ReverseContinue+" : "");
+                } else if (STR_EQUAL(packet, "qAttached")) {
+                    strcpy(reply, "1");
+                } else if (STR_EQUAL(packet, "qC")) {
+                    strcpy(reply, "QC1");
+                } else if (STR_EQUAL(packet, "qfThreadInfo")) {
+                    strcpy(reply, "m1");
+                } else if (STR_EQUAL(packet, "qsThreadInfo")) {
+                    strcpy(reply, "l");
+                }
+                break;
+            }
+            default: {
+                // Empty reply: not supported
+                break;
+            }
+        }
+
+        send_packet(stub, reply);
+    }
+}
+
+u8 gdb_stub_stop(CPU *cpu)
+{
+    Debugger *debugger = cpu->debugger;
+    Gdb_Stub *stub = cpu->gdb;
+
+    if (stub->fd < 0) {
+        return 1; // detached
+    }
+
+    u32 address = calc_inst_pointer_address(cpu);
+    u8 breakpoint_hit = (debugger->breakpoints[address >> 3] & (1 << (address & 7))) != 0;
+    u8 signal = GDB_SIGTRAP;
+
+    // The poll interval ran out while continuing, nothing really stopped the guest
+    if (stub->continuing && !debugger->stop_requested && !breakpoint_hit) {
+        if (!break_requested(stub)) {
+            debugger->steps_left = GDB_POLL_INTERVAL;
+            return 1;
+        }
+        signal = GDB_SIGINT;
+    }
+
+    debugger->stop_requested = 0;
+    debugger->steps_left = 0;
+    stub->continuing = 0;
+
+    // The initial stop is not reported, gdb asks for it with '?' after the connection
+    if (stub->resumed) {
+        stub->resumed = 0;
+        send_stop_reply(cpu, signal);
+    }
+
+    return serve_commands(cpu);
+}
+
+void gdb_stub_exited(CPU *cpu)
+{
+    Gdb_Stub *stub = cpu->gdb;
+
+    if (stub->fd >= 0) {
+        send_packet(stub, cpu->terminate ? "X06" : "W00");
+    }
+}
+
+#endif
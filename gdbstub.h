@@ -0,0 +1,45 @@
+#ifndef _H_GDBSTUB
+#define _H_GDBSTUB
+
+#include "sim86.h"
+
+// GDB remote serial protocol server. Start with --gdb <port> (127.0.0.1) or --gdb <path> (unix socket)
+// and connect with:
+//
+//     (gdb) set architecture i8086
+//     (gdb) target remote :1234
+//
+// The register file is reported in the i386 layout gdb expects. The eip is the linear
+// (cs << 4) + ip address, so the pc, the memory and the breakpoints are all in the same
+// 20bit address space; writing the eip moves the ip within the current code segment.
+
+#define GDB_PACKET_SIZE 0x4000
+#define GDB_REGISTER_COUNT 16
+
+// While the guest runs, the socket is only checked for the ctrl+c (0x03) break in every this many instructions
+#define GDB_POLL_INTERVAL (64 * 1024)
+
+struct Gdb_Stub {
+    int listen_fd;
+    int fd;
+
+    u8 resumed;    // gdb waits for a stop reply
+    u8 continuing; // the stops of the debugger are only poll points until something hits
+
+    char packet[GDB_PACKET_SIZE];
+    char reply[GDB_PACKET_SIZE];
+    char frame[GDB_PACKET_SIZE + 4];
+    u8 input[GDB_PACKET_SIZE];
+    u32 input_used;
+    u32 input_cursor;
+};
+
+// Blocks until gdb connects, returns NULL on Windows
+Gdb_Stub *gdb_stub_create(const char *address);
+void gdb_stub_destroy(Gdb_Stub *stub);
+
+// Called when the debugger stops before an instruction, returns 0 if the simulation has to stop
+u8 gdb_stub_stop(CPU *cpu);
+void gdb_stub_exited(CPU *cpu);
+
+#endif
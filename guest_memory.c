@@ -0,0 +1,123 @@
+#include "guest_memory.h"
+
+#ifdef _WIN32
+
+// No anonymous mappings, the memory is allocated zeroed and a reset always zeroes the dirty pages
+u8 *memory_map(void)
+{
+    u8 *memory = (u8 *)calloc(1, GUEST_MEMORY_SIZE);
+    if (memory == NULL) {
+        printf("\n[ERROR]: Failed to allocate the guest memory.\n");
+        assert(0);
+    }
+
+    return memory;
+}
+
+void memory_unmap(u8 *memory)
+{
+    free(memory);
+}
+
+#else
+
+#include <sys/mman.h>
+
+u8 *memory_map(void)
+{
+    u8 *memory = (u8 *)mmap(NULL, GUEST_MEMORY_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        printf("\n[ERROR]: Failed to map the guest memory.\n");
+        assert(0);
+    }
+
+    return memory;
+}
+
+void memory_unmap(u8 *memory)
+{
+    munmap(memory, GUEST_MEMORY_SIZE);
+}
+
+#endif
+
+void memory_reset(u8 *memory, u8 *page_flags, u8 shared)
+{
+    u32 dirty_count = 0;
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        if (page_flags[page] & Page_Dirty_Reset) {
+            dirty_count++;
+        }
+    }
+
+#ifndef _WIN32
+    if (dirty_count > MEMORY_RESET_ZERO_LIMIT && !shared) {
+        // Not madvise(MADV_DONTNEED): a loaded machine state is a private file mapping at the
+        // same place, and that would bring back the content of the file instead of zeroes.
+        void *remapped = mmap(memory, GUEST_MEMORY_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+        if (remapped == MAP_FAILED) {
+            printf("\n[ERROR]: Failed to reset the guest memory.\n");
+            assert(0);
+        }
+
+        for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+            page_flags[page] |= PAGE_DIRTY_ALL;
+            page_flags[page] &= ~Page_Dirty_Reset;
+        }
+
+        return;
+    }
+#endif
+
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT && dirty_count; page++) {
+        if (page_flags[page] & Page_Dirty_Reset) {
+            ZERO_MEMORY(memory + page * MEMORY_PAGE_SIZE, MEMORY_PAGE_SIZE);
+            page_flags[page] |= PAGE_DIRTY_ALL;
+            page_flags[page] &= ~Page_Dirty_Reset;
+            dirty_count--;
+        }
+    }
+
+    // The byte spilled by a word access at the last address is not tracked by any page
+    ZERO_MEMORY(memory + MAX_MEMORY, 2);
+}
+
+Memory_Pool *memory_pool_create(void)
+{
+    Memory_Pool *pool = (Memory_Pool *)calloc(1, sizeof(Memory_Pool));
+    assert(pool != NULL);
+
+    return pool;
+}
+
+void memory_pool_destroy(Memory_Pool *pool)
+{
+    for (u32 i = 0; i < pool->free_count; i++) {
+        memory_unmap(pool->free[i]);
+    }
+
+    free(pool->free);
+    free(pool);
+}
+
+u8 *memory_pool_acquire(Memory_Pool *pool)
+{
+    if (pool->free_count) {
+        return pool->free[--pool->free_count];
+    }
+
+    return memory_map();
+}
+
+void memory_pool_release(Memory_Pool *pool, u8 *memory, u8 *page_flags)
+{
+    memory_reset(memory, page_flags, 0);
+
+    if (pool->free_count == pool->capacity) {
+        pool->capacity = pool->capacity ? pool->capacity * 2 : 16;
+        pool->free = (u8 **)realloc(pool->free, pool->capacity * sizeof(u8 *));
+        assert(pool->free != NULL);
+    }
+
+    pool->free[pool->free_count++] = memory;
+}
@@ -0,0 +1,38 @@
+#ifndef _H_GUEST_MEMORY
+#define _H_GUEST_MEMORY
+
+#include "sim86.h"
+
+// The guest memory is an anonymous mapping, so the kernel hands out the zero pages on the
+// first touch and a machine which only uses a few kilobytes costs only a few pages.
+//
+// A word access at the last address spills one byte past the megabyte, the extra page keeps it inside the mapping.
+#define GUEST_MEMORY_SIZE (MAX_MEMORY + MEMORY_PAGE_SIZE)
+
+// Resetting zeroes the dirty pages one by one up to this many, the whole mapping is
+// dropped above it and refaulted with zero pages on demand.
+#define MEMORY_RESET_ZERO_LIMIT 32
+
+// The memories of the stopped machines are kept for the next ones. Everything is reset
+// when it comes back, so an acquired memory is always zero.
+struct Memory_Pool {
+    u8 **free;
+    u32 free_count;
+    u32 capacity;
+};
+
+u8 *memory_map(void);
+void memory_unmap(u8 *memory);
+
+// Zeroes the pages marked with Page_Dirty_Reset. For the other users of the dirty
+// tracking the zeroed pages are written pages. A shared memory is never remapped, that
+// would detach it from the other processes.
+void memory_reset(u8 *memory, u8 *page_flags, u8 shared);
+
+Memory_Pool *memory_pool_create(void);
+void memory_pool_destroy(Memory_Pool *pool);
+
+u8 *memory_pool_acquire(Memory_Pool *pool);
+void memory_pool_release(Memory_Pool *pool, u8 *memory, u8 *page_flags);
+
+#endif
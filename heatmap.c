@@ -0,0 +1,88 @@
+#include "heatmap.h"
+
+Heatmap *heatmap_create(void)
+{
+    Heatmap *heatmap = ALLOC_MEMORY(Heatmap);
+    assert(heatmap != NULL);
+
+    for (u32 kind = 0; kind < Heatmap_Kind_Count; kind++) {
+        heatmap->counters[kind] = (u16 *)calloc(MAX_MEMORY, sizeof(u16));
+        assert(heatmap->counters[kind] != NULL);
+    }
+
+    return heatmap;
+}
+
+void heatmap_destroy(Heatmap *heatmap)
+{
+    for (u32 kind = 0; kind < Heatmap_Kind_Count; kind++) {
+        free(heatmap->counters[kind]);
+    }
+    free(heatmap);
+}
+
+void heatmap_write_binary(Heatmap *heatmap, const char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        printf("\n[ERROR]: Failed to open %s for the heatmap.\n", filename);
+        return;
+    }
+
+    Heatmap_File_Header header = {0};
+    memcpy(header.magic, HEATMAP_FILE_MAGIC, sizeof(HEATMAP_FILE_MAGIC));
+    header.version = HEATMAP_FILE_VERSION;
+    header.address_count = MAX_MEMORY;
+
+    fwrite(&header, sizeof(header), 1, fp);
+    for (u32 kind = 0; kind < Heatmap_Kind_Count; kind++) {
+        fwrite(heatmap->counters[kind], sizeof(u16), MAX_MEMORY, fp);
+    }
+
+    fclose(fp);
+}
+
+// Logarithmic scale, otherwise a single hot loop counter washes out everything else.
+// Untouched addresses stay black, a single access is already clearly visible.
+static u8 heatmap_intensity(u16 count)
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    u8 bits = 0;
+    while (count) {
+        bits++;
+        count >>= 1;
+    }
+
+    return 32 + (bits * (0xFF - 32)) / 16;
+}
+
+void heatmap_write_image(Heatmap *heatmap, const char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        printf("\n[ERROR]: Failed to open %s for the heatmap image.\n", filename);
+        return;
+    }
+
+    u32 width = HEATMAP_IMAGE_WIDTH;
+    u32 height = MAX_MEMORY / HEATMAP_IMAGE_WIDTH;
+
+    // Binary PPM, red: writes, green: reads, blue: executed bytes
+    fprintf(fp, "P6\n%u %u\n255\n", width, height);
+
+    u8 row[HEATMAP_IMAGE_WIDTH * 3];
+    for (u32 y = 0; y < height; y++) {
+        for (u32 x = 0; x < width; x++) {
+            u32 address = y * width + x;
+            row[x*3 + 0] = heatmap_intensity(heatmap->counters[Heatmap_Write][address]);
+            row[x*3 + 1] = heatmap_intensity(heatmap->counters[Heatmap_Read][address]);
+            row[x*3 + 2] = heatmap_intensity(heatmap->counters[Heatmap_Exec][address]);
+        }
+        fwrite(row, 1, sizeof(row), fp);
+    }
+
+    fclose(fp);
+}
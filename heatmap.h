@@ -0,0 +1,56 @@
+#ifndef _H_HEATMAP
+#define _H_HEATMAP
+
+#include "sim86.h"
+
+// Per-address access counters over the whole 1 MiB address space. The counters are 16bit and
+// saturating, so the three maps together only cost 6 MiB and a hot loop can't wrap them around.
+#define HEATMAP_COUNTER_MAX 0xFFFF
+
+// Binary output layout (native endian):
+//   Heatmap_File_Header
+//   u16 reads[MAX_MEMORY]
+//   u16 writes[MAX_MEMORY]
+//   u16 execs[MAX_MEMORY]
+#define HEATMAP_FILE_MAGIC "S86HEAT"
+#define HEATMAP_FILE_VERSION 1
+
+// The image is one pixel per address, 1024 addresses per row.
+#define HEATMAP_IMAGE_WIDTH 1024
+
+typedef enum {
+    Heatmap_Read,
+    Heatmap_Write,
+    Heatmap_Exec,
+
+    Heatmap_Kind_Count
+} Heatmap_Kind;
+
+struct Heatmap {
+    u16 *counters[Heatmap_Kind_Count];
+};
+
+typedef struct {
+    char magic[8];
+    u32 version;
+    u32 address_count;
+} Heatmap_File_Header;
+
+Heatmap *heatmap_create(void);
+void heatmap_destroy(Heatmap *heatmap);
+
+void heatmap_write_binary(Heatmap *heatmap, const char *filename);
+void heatmap_write_image(Heatmap *heatmap, const char *filename);
+
+static inline void heatmap_count(Heatmap *heatmap, Heatmap_Kind kind, u32 address, u32 size)
+{
+    u16 *counters = heatmap->counters[kind];
+    for (u32 i = 0; i < size; i++) {
+        u32 index = (address + i) & (MAX_MEMORY - 1);
+        if (counters[index] != HEATMAP_COUNTER_MAX) {
+            counters[index]++;
+        }
+    }
+}
+
+#endif
@@ -1,3 +1,5 @@
+// Generated by tools/gen_i8086_table.py from docs/8086_table.txt, edit those and run make.
+
 #ifndef _H_i8086_TABLE
 #define _H_i8086_TABLE 1
 
@@ -5,7 +7,6 @@
 
 typedef enum {
     Mneumonic_none,
-
     Mneumonic_add,
     Mneumonic_push,
     Mneumonic_pop,
@@ -93,7 +94,6 @@ typedef enum {
     Mneumonic_sti,
     Mneumonic_cld,
     Mneumonic_std,
-
     Mneumonic_rol,
     Mneumonic_ror,
     Mneumonic_rcl,
@@ -107,295 +107,537 @@ typedef enum {
     Mneumonic_imul,
     Mneumonic_div,
     Mneumonic_idiv,
-
     Mneumonic_db,
-
     Mneumonic_grp1,
     Mneumonic_grp2,
     Mneumonic_grp3a,
     Mneumonic_grp3b,
     Mneumonic_grp4,
     Mneumonic_grp5,
-
     Mneumonic_invalid,
-
     Mneumonic_count,
 } Mneumonic;
 
+// "???" for a reg field without an instruction in a group, NULL for Mneumonic_none
+static const char *const i8086_mnemonic_names[Mneumonic_count] = {
+    [Mneumonic_add]     = "add",
+    [Mneumonic_push]    = "push",
+    [Mneumonic_pop]     = "pop",
+    [Mneumonic_or]      = "or",
+    [Mneumonic_adc]     = "adc",
+    [Mneumonic_sbb]     = "sbb",
+    [Mneumonic_and]     = "and",
+    [Mneumonic_es]      = "es",
+    [Mneumonic_daa]     = "daa",
+    [Mneumonic_sub]     = "sub",
+    [Mneumonic_cs]      = "cs",
+    [Mneumonic_das]     = "das",
+    [Mneumonic_xor]     = "xor",
+    [Mneumonic_ss]      = "ss",
+    [Mneumonic_aaa]     = "aaa",
+    [Mneumonic_cmp]     = "cmp",
+    [Mneumonic_ds]      = "ds",
+    [Mneumonic_aas]     = "aas",
+    [Mneumonic_inc]     = "inc",
+    [Mneumonic_dec]     = "dec",
+    [Mneumonic_jo]      = "jo",
+    [Mneumonic_jno]     = "jno",
+    [Mneumonic_jb]      = "jb",
+    [Mneumonic_jnb]     = "jnb",
+    [Mneumonic_jz]      = "jz",
+    [Mneumonic_jnz]     = "jnz",
+    [Mneumonic_jbe]     = "jbe",
+    [Mneumonic_ja]      = "ja",
+    [Mneumonic_js]      = "js",
+    [Mneumonic_jns]     = "jns",
+    [Mneumonic_jp]      = "jp",
+    [Mneumonic_jnp]     = "jnp",
+    [Mneumonic_jl]      = "jl",
+    [Mneumonic_jnl]     = "jnl",
+    [Mneumonic_jle]     = "jle",
+    [Mneumonic_jg]      = "jg",
+    [Mneumonic_test]    = "test",
+    [Mneumonic_xchg]    = "xchg",
+    [Mneumonic_mov]     = "mov",
+    [Mneumonic_lea]     = "lea",
+    [Mneumonic_nop]     = "nop",
+    [Mneumonic_cbw]     = "cbw",
+    [Mneumonic_cwd]     = "cwd",
+    [Mneumonic_call]    = "call",
+    [Mneumonic_wait]    = "wait",
+    [Mneumonic_pushf]   = "pushf",
+    [Mneumonic_popf]    = "popf",
+    [Mneumonic_sahf]    = "sahf",
+    [Mneumonic_lahf]    = "lahf",
+    [Mneumonic_movsb]   = "movsb",
+    [Mneumonic_movsw]   = "movsw",
+    [Mneumonic_cmpsb]   = "cmpsb",
+    [Mneumonic_cmpsw]   = "cmpsw",
+    [Mneumonic_stosb]   = "stosb",
+    [Mneumonic_stosw]   = "stosw",
+    [Mneumonic_lodsb]   = "lodsb",
+    [Mneumonic_lodsw]   = "lodsw",
+    [Mneumonic_scasb]   = "scasb",
+    [Mneumonic_scasw]   = "scasw",
+    [Mneumonic_ret]     = "ret",
+    [Mneumonic_les]     = "les",
+    [Mneumonic_lds]     = "lds",
+    [Mneumonic_retf]    = "retf",
+    [Mneumonic_int]     = "int",
+    [Mneumonic_into]    = "into",
+    [Mneumonic_iret]    = "iret",
+    [Mneumonic_aam]     = "aam",
+    [Mneumonic_aad]     = "aad",
+    [Mneumonic_xlat]    = "xlat",
+    [Mneumonic_loopnz]  = "loopnz",
+    [Mneumonic_loopz]   = "loopz",
+    [Mneumonic_loop]    = "loop",
+    [Mneumonic_jcxz]    = "jcxz",
+    [Mneumonic_in]      = "in",
+    [Mneumonic_out]     = "out",
+    [Mneumonic_jmp]     = "jmp",
+    [Mneumonic_lock]    = "lock",
+    [Mneumonic_repnz]   = "repnz",
+    [Mneumonic_repz]    = "repz",
+    [Mneumonic_hlt]     = "hlt",
+    [Mneumonic_cmc]     = "cmc",
+    [Mneumonic_clc]     = "clc",
+    [Mneumonic_stc]     = "stc",
+    [Mneumonic_cli]     = "cli",
+    [Mneumonic_sti]     = "sti",
+    [Mneumonic_cld]     = "cld",
+    [Mneumonic_std]     = "std",
+    [Mneumonic_rol]     = "rol",
+    [Mneumonic_ror]     = "ror",
+    [Mneumonic_rcl]     = "rcl",
+    [Mneumonic_rcr]     = "rcr",
+    [Mneumonic_shl]     = "shl",
+    [Mneumonic_shr]     = "shr",
+    [Mneumonic_sar]     = "sar",
+    [Mneumonic_not]     = "not",
+    [Mneumonic_neg]     = "neg",
+    [Mneumonic_mul]     = "mul",
+    [Mneumonic_imul]    = "imul",
+    [Mneumonic_div]     = "div",
+    [Mneumonic_idiv]    = "idiv",
+    [Mneumonic_db]      = "db",
+    [Mneumonic_grp1]    = "grp1",
+    [Mneumonic_grp2]    = "grp2",
+    [Mneumonic_grp3a]   = "grp3a",
+    [Mneumonic_grp3b]   = "grp3b",
+    [Mneumonic_grp4]    = "grp4",
+    [Mneumonic_grp5]    = "grp5",
+    [Mneumonic_invalid] = "???",
+};
+
+// An operand of the opcode map packed into 16 bits: the kind in the low 4 bits, then the size
+// (2 bits) and the register or the constant (3 bits). Operand_Spec_Eb is the "Eb" of the map.
+typedef u16 Operand_Spec;
+
+typedef enum {
+    Spec_None,
+    Spec_Register,         // AL, eAX, DX: a fixed general register, the value is its encoding
+    Spec_Segment_Register, // ES, CS, SS, DS: a fixed segment register
+    Spec_Far_Pointer,      // A: segment:offset in the instruction, no ModR/M byte
+    Spec_Relative,         // J: offset from the next instruction
+    Spec_Modrm,            // E: register or memory of the ModR/M byte
+    Spec_Modrm_Reg,        // G: general register of the reg field
+    Spec_Immediate,        // I: immediate data
+    Spec_Aam_Base,         // I0: the base of aam and aad
+    Spec_Offset,           // O: direct offset in the instruction, no ModR/M byte
+    Spec_Modrm_Segment,    // S: segment register of the reg field
+    Spec_Modrm_Memory,     // M: memory only ModR/M byte
+    Spec_Constant,         // 1, 3: the value is the constant
+} Operand_Spec_Kind;
+
+typedef enum {
+    Spec_Size_None,
+    Spec_Size_Byte,    // b
+    Spec_Size_Word,    // v, w and the wide registers
+    Spec_Size_Pointer, // p, a 32 bit segment:offset
+} Operand_Spec_Size;
+
+#define OPERAND_SPEC(_kind, _size, _value) ((_kind) | ((_size) << 4) | ((_value) << 6))
+#define OPERAND_SPEC_KIND(_spec)  ((_spec) & 0xF)
+#define OPERAND_SPEC_SIZE(_spec)  (((_spec) >> 4) & 0x3)
+#define OPERAND_SPEC_VALUE(_spec) (((_spec) >> 6) & 0x7)
+
+enum {
+    Operand_Spec_none = 0,
+    Operand_Spec_AH = OPERAND_SPEC(Spec_Register, Spec_Size_Byte, 4),
+    Operand_Spec_AL = OPERAND_SPEC(Spec_Register, Spec_Size_Byte, 0),
+    Operand_Spec_Ap = OPERAND_SPEC(Spec_Far_Pointer, Spec_Size_Pointer, 0),
+    Operand_Spec_BH = OPERAND_SPEC(Spec_Register, Spec_Size_Byte, 7),
+    Operand_Spec_BL = OPERAND_SPEC(Spec_Register, Spec_Size_Byte, 3),
+    Operand_Spec_CH = OPERAND_SPEC(Spec_Register, Spec_Size_Byte, 5),
+    Operand_Spec_CL = OPERAND_SPEC(Spec_Register, Spec_Size_Byte, 1),
+    Operand_Spec_CS = OPERAND_SPEC(Spec_Segment_Register, Spec_Size_None, 1),
+    Operand_Spec_DH = OPERAND_SPEC(Spec_Register, Spec_Size_Byte, 6),
+    Operand_Spec_DL = OPERAND_SPEC(Spec_Register, Spec_Size_Byte, 2),
+    Operand_Spec_DS = OPERAND_SPEC(Spec_Segment_Register, Spec_Size_None, 3),
+    Operand_Spec_DX = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 2),
+    Operand_Spec_eAX = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 0),
+    Operand_Spec_Eb = OPERAND_SPEC(Spec_Modrm, Spec_Size_Byte, 0),
+    Operand_Spec_eBP = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 5),
+    Operand_Spec_eBX = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 3),
+    Operand_Spec_eCX = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 1),
+    Operand_Spec_eDI = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 7),
+    Operand_Spec_eDX = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 2),
+    Operand_Spec_ES = OPERAND_SPEC(Spec_Segment_Register, Spec_Size_None, 0),
+    Operand_Spec_eSI = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 6),
+    Operand_Spec_eSP = OPERAND_SPEC(Spec_Register, Spec_Size_Word, 4),
+    Operand_Spec_Ev = OPERAND_SPEC(Spec_Modrm, Spec_Size_Word, 0),
+    Operand_Spec_Ew = OPERAND_SPEC(Spec_Modrm, Spec_Size_Word, 0),
+    Operand_Spec_Gb = OPERAND_SPEC(Spec_Modrm_Reg, Spec_Size_Byte, 0),
+    Operand_Spec_Gv = OPERAND_SPEC(Spec_Modrm_Reg, Spec_Size_Word, 0),
+    Operand_Spec_I0 = OPERAND_SPEC(Spec_Aam_Base, Spec_Size_Byte, 0),
+    Operand_Spec_Ib = OPERAND_SPEC(Spec_Immediate, Spec_Size_Byte, 0),
+    Operand_Spec_Iv = OPERAND_SPEC(Spec_Immediate, Spec_Size_Word, 0),
+    Operand_Spec_Iw = OPERAND_SPEC(Spec_Immediate, Spec_Size_Word, 0),
+    Operand_Spec_Jb = OPERAND_SPEC(Spec_Relative, Spec_Size_Byte, 0),
+    Operand_Spec_Jv = OPERAND_SPEC(Spec_Relative, Spec_Size_Word, 0),
+    Operand_Spec_M = OPERAND_SPEC(Spec_Modrm_Memory, Spec_Size_None, 0),
+    Operand_Spec_Mp = OPERAND_SPEC(Spec_Modrm_Memory, Spec_Size_Pointer, 0),
+    Operand_Spec_Ob = OPERAND_SPEC(Spec_Offset, Spec_Size_Byte, 0),
+    Operand_Spec_Ov = OPERAND_SPEC(Spec_Offset, Spec_Size_Word, 0),
+    Operand_Spec_SS = OPERAND_SPEC(Spec_Segment_Register, Spec_Size_None, 2),
+    Operand_Spec_Sw = OPERAND_SPEC(Spec_Modrm_Segment, Spec_Size_Word, 0),
+    Operand_Spec_1 = OPERAND_SPEC(Spec_Constant, Spec_Size_None, 1),
+    Operand_Spec_3 = OPERAND_SPEC(Spec_Constant, Spec_Size_None, 3),
+};
+
 typedef struct i8086_Inst_Table i8086_Inst_Table;
 
 struct i8086_Inst_Table {
-    u8 opcode;
+    u8 opcode; // the reg field of the ModR/M byte in the group tables
     Mneumonic mnemonic;
-    const char* arg1;
-    const char* arg2;
+    Operand_Spec arg1;
+    Operand_Spec arg2;
     Instruction_Type type;
 };
 
-/*
-  Instruction_Type_move
-  Instruction_Type_arithmetic,
-  Instruction_Type_flow,
-  Instruction_Type_stack,
-*/
+static const i8086_Inst_Table i8086_inst_table[256] = {
+    { 0x00, Mneumonic_add, Operand_Spec_Eb, Operand_Spec_Gb, Instruction_Type_arithmetic },
+    { 0x01, Mneumonic_add, Operand_Spec_Ev, Operand_Spec_Gv, Instruction_Type_arithmetic },
+    { 0x02, Mneumonic_add, Operand_Spec_Gb, Operand_Spec_Eb, Instruction_Type_arithmetic },
+    { 0x03, Mneumonic_add, Operand_Spec_Gv, Operand_Spec_Ev, Instruction_Type_arithmetic },
+    { 0x04, Mneumonic_add, Operand_Spec_AL, Operand_Spec_Ib, Instruction_Type_arithmetic },
+    { 0x05, Mneumonic_add, Operand_Spec_eAX, Operand_Spec_Iv, Instruction_Type_arithmetic },
+    { 0x06, Mneumonic_push, Operand_Spec_ES, Operand_Spec_none, Instruction_Type_stack },
+    { 0x07, Mneumonic_pop, Operand_Spec_ES, Operand_Spec_none, Instruction_Type_stack },
+    { 0x08, Mneumonic_or, Operand_Spec_Eb, Operand_Spec_Gb },
+    { 0x09, Mneumonic_or, Operand_Spec_Ev, Operand_Spec_Gv },
+    { 0x0A, Mneumonic_or, Operand_Spec_Gb, Operand_Spec_Eb },
+    { 0x0B, Mneumonic_or, Operand_Spec_Gv, Operand_Spec_Ev },
+    { 0x0C, Mneumonic_or, Operand_Spec_AL, Operand_Spec_Ib },
+    { 0x0D, Mneumonic_or, Operand_Spec_eAX, Operand_Spec_Iv },
+    { 0x0E, Mneumonic_push, Operand_Spec_CS, Operand_Spec_none, Instruction_Type_stack },
+    { 0x0F, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x10, Mneumonic_adc, Operand_Spec_Eb, Operand_Spec_Gb },
+    { 0x11, Mneumonic_adc, Operand_Spec_Ev, Operand_Spec_Gv },
+    { 0x12, Mneumonic_adc, Operand_Spec_Gb, Operand_Spec_Eb },
+    { 0x13, Mneumonic_adc, Operand_Spec_Gv, Operand_Spec_Ev },
+    { 0x14, Mneumonic_adc, Operand_Spec_AL, Operand_Spec_Ib },
+    { 0x15, Mneumonic_adc, Operand_Spec_eAX, Operand_Spec_Iv },
+    { 0x16, Mneumonic_push, Operand_Spec_SS, Operand_Spec_none, Instruction_Type_stack },
+    { 0x17, Mneumonic_pop, Operand_Spec_SS, Operand_Spec_none, Instruction_Type_stack },
+    { 0x18, Mneumonic_sbb, Operand_Spec_Eb, Operand_Spec_Gb },
+    { 0x19, Mneumonic_sbb, Operand_Spec_Ev, Operand_Spec_Gv },
+    { 0x1A, Mneumonic_sbb, Operand_Spec_Gb, Operand_Spec_Eb },
+    { 0x1B, Mneumonic_sbb, Operand_Spec_Gv, Operand_Spec_Ev },
+    { 0x1C, Mneumonic_sbb, Operand_Spec_AL, Operand_Spec_Ib },
+    { 0x1D, Mneumonic_sbb, Operand_Spec_eAX, Operand_Spec_Iv },
+    { 0x1E, Mneumonic_push, Operand_Spec_DS, Operand_Spec_none, Instruction_Type_stack },
+    { 0x1F, Mneumonic_pop, Operand_Spec_DS, Operand_Spec_none, Instruction_Type_stack },
+    { 0x20, Mneumonic_and, Operand_Spec_Eb, Operand_Spec_Gb },
+    { 0x21, Mneumonic_and, Operand_Spec_Ev, Operand_Spec_Gv },
+    { 0x22, Mneumonic_and, Operand_Spec_Gb, Operand_Spec_Eb },
+    { 0x23, Mneumonic_and, Operand_Spec_Gv, Operand_Spec_Ev },
+    { 0x24, Mneumonic_and, Operand_Spec_AL, Operand_Spec_Ib },
+    { 0x25, Mneumonic_and, Operand_Spec_eAX, Operand_Spec_Iv },
+    { 0x26, Mneumonic_es, Operand_Spec_none, Operand_Spec_none },
+    { 0x27, Mneumonic_daa, Operand_Spec_none, Operand_Spec_none },
+    { 0x28, Mneumonic_sub, Operand_Spec_Eb, Operand_Spec_Gb },
+    { 0x29, Mneumonic_sub, Operand_Spec_Ev, Operand_Spec_Gv },
+    { 0x2A, Mneumonic_sub, Operand_Spec_Gb, Operand_Spec_Eb },
+    { 0x2B, Mneumonic_sub, Operand_Spec_Gv, Operand_Spec_Ev },
+    { 0x2C, Mneumonic_sub, Operand_Spec_AL, Operand_Spec_Ib },
+    { 0x2D, Mneumonic_sub, Operand_Spec_eAX, Operand_Spec_Iv },
+    { 0x2E, Mneumonic_cs, Operand_Spec_none, Operand_Spec_none },
+    { 0x2F, Mneumonic_das, Operand_Spec_none, Operand_Spec_none },
+    { 0x30, Mneumonic_xor, Operand_Spec_Eb, Operand_Spec_Gb, Instruction_Type_logical },
+    { 0x31, Mneumonic_xor, Operand_Spec_Ev, Operand_Spec_Gv, Instruction_Type_logical },
+    { 0x32, Mneumonic_xor, Operand_Spec_Gb, Operand_Spec_Eb, Instruction_Type_logical },
+    { 0x33, Mneumonic_xor, Operand_Spec_Gv, Operand_Spec_Ev, Instruction_Type_logical },
+    { 0x34, Mneumonic_xor, Operand_Spec_AL, Operand_Spec_Ib, Instruction_Type_logical },
+    { 0x35, Mneumonic_xor, Operand_Spec_eAX, Operand_Spec_Iv, Instruction_Type_logical },
+    { 0x36, Mneumonic_ss, Operand_Spec_none, Operand_Spec_none },
+    { 0x37, Mneumonic_aaa, Operand_Spec_none, Operand_Spec_none },
+    { 0x38, Mneumonic_cmp, Operand_Spec_Eb, Operand_Spec_Gb, Instruction_Type_arithmetic },
+    { 0x39, Mneumonic_cmp, Operand_Spec_Ev, Operand_Spec_Gv, Instruction_Type_arithmetic },
+    { 0x3A, Mneumonic_cmp, Operand_Spec_Gb, Operand_Spec_Eb, Instruction_Type_arithmetic },
+    { 0x3B, Mneumonic_cmp, Operand_Spec_Gv, Operand_Spec_Ev, Instruction_Type_arithmetic },
+    { 0x3C, Mneumonic_cmp, Operand_Spec_AL, Operand_Spec_Ib, Instruction_Type_arithmetic },
+    { 0x3D, Mneumonic_cmp, Operand_Spec_eAX, Operand_Spec_Iv, Instruction_Type_arithmetic },
+    { 0x3E, Mneumonic_ds, Operand_Spec_none, Operand_Spec_none },
+    { 0x3F, Mneumonic_aas, Operand_Spec_none, Operand_Spec_none },
+    { 0x40, Mneumonic_inc, Operand_Spec_eAX, Operand_Spec_none },
+    { 0x41, Mneumonic_inc, Operand_Spec_eCX, Operand_Spec_none },
+    { 0x42, Mneumonic_inc, Operand_Spec_eDX, Operand_Spec_none },
+    { 0x43, Mneumonic_inc, Operand_Spec_eBX, Operand_Spec_none },
+    { 0x44, Mneumonic_inc, Operand_Spec_eSP, Operand_Spec_none },
+    { 0x45, Mneumonic_inc, Operand_Spec_eBP, Operand_Spec_none },
+    { 0x46, Mneumonic_inc, Operand_Spec_eSI, Operand_Spec_none },
+    { 0x47, Mneumonic_inc, Operand_Spec_eDI, Operand_Spec_none },
+    { 0x48, Mneumonic_dec, Operand_Spec_eAX, Operand_Spec_none },
+    { 0x49, Mneumonic_dec, Operand_Spec_eCX, Operand_Spec_none },
+    { 0x4A, Mneumonic_dec, Operand_Spec_eDX, Operand_Spec_none },
+    { 0x4B, Mneumonic_dec, Operand_Spec_eBX, Operand_Spec_none },
+    { 0x4C, Mneumonic_dec, Operand_Spec_eSP, Operand_Spec_none },
+    { 0x4D, Mneumonic_dec, Operand_Spec_eBP, Operand_Spec_none },
+    { 0x4E, Mneumonic_dec, Operand_Spec_eSI, Operand_Spec_none },
+    { 0x4F, Mneumonic_dec, Operand_Spec_eDI, Operand_Spec_none },
+    { 0x50, Mneumonic_push, Operand_Spec_eAX, Operand_Spec_none, Instruction_Type_stack },
+    { 0x51, Mneumonic_push, Operand_Spec_eCX, Operand_Spec_none, Instruction_Type_stack },
+    { 0x52, Mneumonic_push, Operand_Spec_eDX, Operand_Spec_none, Instruction_Type_stack },
+    { 0x53, Mneumonic_push, Operand_Spec_eBX, Operand_Spec_none, Instruction_Type_stack },
+    { 0x54, Mneumonic_push, Operand_Spec_eSP, Operand_Spec_none, Instruction_Type_stack },
+    { 0x55, Mneumonic_push, Operand_Spec_eBP, Operand_Spec_none, Instruction_Type_stack },
+    { 0x56, Mneumonic_push, Operand_Spec_eSI, Operand_Spec_none, Instruction_Type_stack },
+    { 0x57, Mneumonic_push, Operand_Spec_eDI, Operand_Spec_none, Instruction_Type_stack },
+    { 0x58, Mneumonic_pop, Operand_Spec_eAX, Operand_Spec_none, Instruction_Type_stack },
+    { 0x59, Mneumonic_pop, Operand_Spec_eCX, Operand_Spec_none, Instruction_Type_stack },
+    { 0x5A, Mneumonic_pop, Operand_Spec_eDX, Operand_Spec_none, Instruction_Type_stack },
+    { 0x5B, Mneumonic_pop, Operand_Spec_eBX, Operand_Spec_none, Instruction_Type_stack },
+    { 0x5C, Mneumonic_pop, Operand_Spec_eSP, Operand_Spec_none, Instruction_Type_stack },
+    { 0x5D, Mneumonic_pop, Operand_Spec_eBP, Operand_Spec_none, Instruction_Type_stack },
+    { 0x5E, Mneumonic_pop, Operand_Spec_eSI, Operand_Spec_none, Instruction_Type_stack },
+    { 0x5F, Mneumonic_pop, Operand_Spec_eDI, Operand_Spec_none, Instruction_Type_stack },
+    { 0x60, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x61, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x62, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x63, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x64, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x65, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x66, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x67, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x68, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x69, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x6A, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x6B, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x6C, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x6D, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x6E, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x6F, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0x70, Mneumonic_jo, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x71, Mneumonic_jno, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x72, Mneumonic_jb, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x73, Mneumonic_jnb, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x74, Mneumonic_jz, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x75, Mneumonic_jnz, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x76, Mneumonic_jbe, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x77, Mneumonic_ja, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x78, Mneumonic_js, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x79, Mneumonic_jns, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x7A, Mneumonic_jp, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x7B, Mneumonic_jnp, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x7C, Mneumonic_jl, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x7D, Mneumonic_jnl, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x7E, Mneumonic_jle, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x7F, Mneumonic_jg, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0x80, Mneumonic_grp1, Operand_Spec_Eb, Operand_Spec_Ib },
+    { 0x81, Mneumonic_grp1, Operand_Spec_Ev, Operand_Spec_Iv },
+    { 0x82, Mneumonic_grp1, Operand_Spec_Eb, Operand_Spec_Ib },
+    { 0x83, Mneumonic_grp1, Operand_Spec_Ev, Operand_Spec_Ib },
+    { 0x84, Mneumonic_test, Operand_Spec_Gb, Operand_Spec_Eb },
+    { 0x85, Mneumonic_test, Operand_Spec_Gv, Operand_Spec_Ev },
+    { 0x86, Mneumonic_xchg, Operand_Spec_Gb, Operand_Spec_Eb },
+    { 0x87, Mneumonic_xchg, Operand_Spec_Gv, Operand_Spec_Ev },
+    { 0x88, Mneumonic_mov, Operand_Spec_Eb, Operand_Spec_Gb, Instruction_Type_move },
+    { 0x89, Mneumonic_mov, Operand_Spec_Ev, Operand_Spec_Gv, Instruction_Type_move },
+    { 0x8A, Mneumonic_mov, Operand_Spec_Gb, Operand_Spec_Eb, Instruction_Type_move },
+    { 0x8B, Mneumonic_mov, Operand_Spec_Gv, Operand_Spec_Ev, Instruction_Type_move },
+    { 0x8C, Mneumonic_mov, Operand_Spec_Ew, Operand_Spec_Sw, Instruction_Type_move },
+    { 0x8D, Mneumonic_lea, Operand_Spec_Gv, Operand_Spec_M },
+    { 0x8E, Mneumonic_mov, Operand_Spec_Sw, Operand_Spec_Ew, Instruction_Type_move },
+    { 0x8F, Mneumonic_pop, Operand_Spec_Ev, Operand_Spec_none, Instruction_Type_stack },
+    { 0x90, Mneumonic_nop, Operand_Spec_none, Operand_Spec_none },
+    { 0x91, Mneumonic_xchg, Operand_Spec_eCX, Operand_Spec_eAX },
+    { 0x92, Mneumonic_xchg, Operand_Spec_eDX, Operand_Spec_eAX },
+    { 0x93, Mneumonic_xchg, Operand_Spec_eBX, Operand_Spec_eAX },
+    { 0x94, Mneumonic_xchg, Operand_Spec_eSP, Operand_Spec_eAX },
+    { 0x95, Mneumonic_xchg, Operand_Spec_eBP, Operand_Spec_eAX },
+    { 0x96, Mneumonic_xchg, Operand_Spec_eSI, Operand_Spec_eAX },
+    { 0x97, Mneumonic_xchg, Operand_Spec_eDI, Operand_Spec_eAX },
+    { 0x98, Mneumonic_cbw, Operand_Spec_none, Operand_Spec_none },
+    { 0x99, Mneumonic_cwd, Operand_Spec_none, Operand_Spec_none },
+    { 0x9A, Mneumonic_call, Operand_Spec_Ap, Operand_Spec_none },
+    { 0x9B, Mneumonic_wait, Operand_Spec_none, Operand_Spec_none },
+    { 0x9C, Mneumonic_pushf, Operand_Spec_none, Operand_Spec_none, Instruction_Type_stack },
+    { 0x9D, Mneumonic_popf, Operand_Spec_none, Operand_Spec_none, Instruction_Type_stack },
+    { 0x9E, Mneumonic_sahf, Operand_Spec_none, Operand_Spec_none },
+    { 0x9F, Mneumonic_lahf, Operand_Spec_none, Operand_Spec_none },
+    { 0xA0, Mneumonic_mov, Operand_Spec_AL, Operand_Spec_Ob, Instruction_Type_move },
+    { 0xA1, Mneumonic_mov, Operand_Spec_eAX, Operand_Spec_Ov, Instruction_Type_move },
+    { 0xA2, Mneumonic_mov, Operand_Spec_Ob, Operand_Spec_AL, Instruction_Type_move },
+    { 0xA3, Mneumonic_mov, Operand_Spec_Ov, Operand_Spec_eAX, Instruction_Type_move },
+    { 0xA4, Mneumonic_movsb, Operand_Spec_none, Operand_Spec_none, Instruction_Type_move },
+    { 0xA5, Mneumonic_movsw, Operand_Spec_none, Operand_Spec_none, Instruction_Type_move },
+    { 0xA6, Mneumonic_cmpsb, Operand_Spec_none, Operand_Spec_none, Instruction_Type_arithmetic },
+    { 0xA7, Mneumonic_cmpsw, Operand_Spec_none, Operand_Spec_none, Instruction_Type_arithmetic },
+    { 0xA8, Mneumonic_test, Operand_Spec_AL, Operand_Spec_Ib },
+    { 0xA9, Mneumonic_test, Operand_Spec_eAX, Operand_Spec_Iv },
+    { 0xAA, Mneumonic_stosb, Operand_Spec_none, Operand_Spec_none, Instruction_Type_string },
+    { 0xAB, Mneumonic_stosw, Operand_Spec_none, Operand_Spec_none, Instruction_Type_string },
+    { 0xAC, Mneumonic_lodsb, Operand_Spec_none, Operand_Spec_none },
+    { 0xAD, Mneumonic_lodsw, Operand_Spec_none, Operand_Spec_none },
+    { 0xAE, Mneumonic_scasb, Operand_Spec_none, Operand_Spec_none },
+    { 0xAF, Mneumonic_scasw, Operand_Spec_none, Operand_Spec_none },
+    { 0xB0, Mneumonic_mov, Operand_Spec_AL, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xB1, Mneumonic_mov, Operand_Spec_CL, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xB2, Mneumonic_mov, Operand_Spec_DL, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xB3, Mneumonic_mov, Operand_Spec_BL, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xB4, Mneumonic_mov, Operand_Spec_AH, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xB5, Mneumonic_mov, Operand_Spec_CH, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xB6, Mneumonic_mov, Operand_Spec_DH, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xB7, Mneumonic_mov, Operand_Spec_BH, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xB8, Mneumonic_mov, Operand_Spec_eAX, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xB9, Mneumonic_mov, Operand_Spec_eCX, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xBA, Mneumonic_mov, Operand_Spec_eDX, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xBB, Mneumonic_mov, Operand_Spec_eBX, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xBC, Mneumonic_mov, Operand_Spec_eSP, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xBD, Mneumonic_mov, Operand_Spec_eBP, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xBE, Mneumonic_mov, Operand_Spec_eSI, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xBF, Mneumonic_mov, Operand_Spec_eDI, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xC0, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xC1, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xC2, Mneumonic_ret, Operand_Spec_Iw, Operand_Spec_none },
+    { 0xC3, Mneumonic_ret, Operand_Spec_none, Operand_Spec_none },
+    { 0xC4, Mneumonic_les, Operand_Spec_Gv, Operand_Spec_Mp },
+    { 0xC5, Mneumonic_lds, Operand_Spec_Gv, Operand_Spec_Mp },
+    { 0xC6, Mneumonic_mov, Operand_Spec_Eb, Operand_Spec_Ib, Instruction_Type_move },
+    { 0xC7, Mneumonic_mov, Operand_Spec_Ev, Operand_Spec_Iv, Instruction_Type_move },
+    { 0xC8, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xC9, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xCA, Mneumonic_retf, Operand_Spec_Iw, Operand_Spec_none },
+    { 0xCB, Mneumonic_retf, Operand_Spec_none, Operand_Spec_none },
+    { 0xCC, Mneumonic_int, Operand_Spec_3, Operand_Spec_none },
+    { 0xCD, Mneumonic_int, Operand_Spec_Ib, Operand_Spec_none },
+    { 0xCE, Mneumonic_into, Operand_Spec_none, Operand_Spec_none },
+    { 0xCF, Mneumonic_iret, Operand_Spec_none, Operand_Spec_none },
+    { 0xD0, Mneumonic_grp2, Operand_Spec_Eb, Operand_Spec_1 },
+    { 0xD1, Mneumonic_grp2, Operand_Spec_Ev, Operand_Spec_1 },
+    { 0xD2, Mneumonic_grp2, Operand_Spec_Eb, Operand_Spec_CL },
+    { 0xD3, Mneumonic_grp2, Operand_Spec_Ev, Operand_Spec_CL },
+    { 0xD4, Mneumonic_aam, Operand_Spec_I0, Operand_Spec_none },
+    { 0xD5, Mneumonic_aad, Operand_Spec_I0, Operand_Spec_none },
+    { 0xD6, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xD7, Mneumonic_xlat, Operand_Spec_none, Operand_Spec_none },
+    { 0xD8, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xD9, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xDA, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xDB, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xDC, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xDD, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xDE, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xDF, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xE0, Mneumonic_loopnz, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0xE1, Mneumonic_loopz, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0xE2, Mneumonic_loop, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0xE3, Mneumonic_jcxz, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0xE4, Mneumonic_in, Operand_Spec_AL, Operand_Spec_Ib },
+    { 0xE5, Mneumonic_in, Operand_Spec_eAX, Operand_Spec_Ib },
+    { 0xE6, Mneumonic_out, Operand_Spec_Ib, Operand_Spec_AL, Instruction_Type_io },
+    { 0xE7, Mneumonic_out, Operand_Spec_Ib, Operand_Spec_eAX, Instruction_Type_io },
+    { 0xE8, Mneumonic_call, Operand_Spec_Jv, Operand_Spec_none },
+    { 0xE9, Mneumonic_jmp, Operand_Spec_Jv, Operand_Spec_none, Instruction_Type_flow },
+    { 0xEA, Mneumonic_jmp, Operand_Spec_Ap, Operand_Spec_none, Instruction_Type_flow },
+    { 0xEB, Mneumonic_jmp, Operand_Spec_Jb, Operand_Spec_none, Instruction_Type_flow },
+    { 0xEC, Mneumonic_in, Operand_Spec_AL, Operand_Spec_DX },
+    { 0xED, Mneumonic_in, Operand_Spec_eAX, Operand_Spec_DX },
+    { 0xEE, Mneumonic_out, Operand_Spec_DX, Operand_Spec_AL, Instruction_Type_io },
+    { 0xEF, Mneumonic_out, Operand_Spec_DX, Operand_Spec_eAX, Instruction_Type_io },
+    { 0xF0, Mneumonic_lock, Operand_Spec_none, Operand_Spec_none },
+    { 0xF1, Mneumonic_db, Operand_Spec_none, Operand_Spec_none },
+    { 0xF2, Mneumonic_repnz, Operand_Spec_none, Operand_Spec_none },
+    { 0xF3, Mneumonic_repz, Operand_Spec_none, Operand_Spec_none },
+    { 0xF4, Mneumonic_hlt, Operand_Spec_none, Operand_Spec_none },
+    { 0xF5, Mneumonic_cmc, Operand_Spec_none, Operand_Spec_none },
+    { 0xF6, Mneumonic_grp3a, Operand_Spec_Eb, Operand_Spec_none },
+    { 0xF7, Mneumonic_grp3b, Operand_Spec_Ev, Operand_Spec_none },
+    { 0xF8, Mneumonic_clc, Operand_Spec_none, Operand_Spec_none },
+    { 0xF9, Mneumonic_stc, Operand_Spec_none, Operand_Spec_none },
+    { 0xFA, Mneumonic_cli, Operand_Spec_none, Operand_Spec_none },
+    { 0xFB, Mneumonic_sti, Operand_Spec_none, Operand_Spec_none },
+    { 0xFC, Mneumonic_cld, Operand_Spec_none, Operand_Spec_none },
+    { 0xFD, Mneumonic_std, Operand_Spec_none, Operand_Spec_none },
+    { 0xFE, Mneumonic_grp4, Operand_Spec_Eb, Operand_Spec_none },
+    { 0xFF, Mneumonic_grp5, Operand_Spec_Ev, Operand_Spec_none },
+};
+
+#define I8086_GROUP_COUNT 6
 
-static const i8086_Inst_Table i8086_inst_table[] = {
-    { 0x00, Mneumonic_add, "Eb", "Gb", Instruction_Type_arithmetic },
-    { 0x01, Mneumonic_add, "Ev", "Gv", Instruction_Type_arithmetic },
-    { 0x02, Mneumonic_add, "Gb", "Eb", Instruction_Type_arithmetic },
-    { 0x03, Mneumonic_add, "Gv", "Ev", Instruction_Type_arithmetic },
-    { 0x04, Mneumonic_add, "AL", "Ib", Instruction_Type_arithmetic },
-    { 0x05, Mneumonic_add, "eAX", "Iv", Instruction_Type_arithmetic },
-    { 0x06, Mneumonic_push, "ES", NULL, Instruction_Type_stack },
-    { 0x07, Mneumonic_pop, "ES", NULL, Instruction_Type_stack },
-    { 0x08, Mneumonic_or, "Eb", "Gb" },
-    { 0x09, Mneumonic_or, "Ev", "Gv" },
-    { 0x0A, Mneumonic_or, "Gb", "Eb" },
-    { 0x0B, Mneumonic_or, "Gv", "Ev" },
-    { 0x0C, Mneumonic_or, "AL", "Ib" },
-    { 0x0D, Mneumonic_or, "eAX", "Iv" },
-    { 0x0E, Mneumonic_push, "CS", NULL, Instruction_Type_stack },
-    { 0x0F, Mneumonic_db, NULL, NULL },
-    { 0x10, Mneumonic_adc, "Eb", "Gb" },
-    { 0x11, Mneumonic_adc, "Ev", "Gv" },
-    { 0x12, Mneumonic_adc, "Gb", "Eb" },
-    { 0x13, Mneumonic_adc, "Gv", "Ev" },
-    { 0x14, Mneumonic_adc, "AL", "Ib" },
-    { 0x15, Mneumonic_adc, "eAX", "Iv" },
-    { 0x16, Mneumonic_push, "SS", NULL, Instruction_Type_stack },
-    { 0x17, Mneumonic_pop, "SS", NULL, Instruction_Type_stack },
-    { 0x18, Mneumonic_sbb, "Eb", "Gb" },
-    { 0x19, Mneumonic_sbb, "Ev", "Gv" },
-    { 0x1A, Mneumonic_sbb, "Gb", "Eb" },
-    { 0x1B, Mneumonic_sbb, "Gv", "Ev" },
-    { 0x1C, Mneumonic_sbb, "AL", "Ib" },
-    { 0x1D, Mneumonic_sbb, "eAX", "Iv" },
-    { 0x1E, Mneumonic_push, "DS", NULL, Instruction_Type_stack },
-    { 0x1F, Mneumonic_pop, "DS", NULL, Instruction_Type_stack },
-    { 0x20, Mneumonic_and, "Eb", "Gb" },
-    { 0x21, Mneumonic_and, "Ev", "Gv" },
-    { 0x22, Mneumonic_and, "Gb", "Eb" },
-    { 0x23, Mneumonic_and, "Gv", "Ev" },
-    { 0x24, Mneumonic_and, "AL", "Ib" },
-    { 0x25, Mneumonic_and, "eAX", "Iv" },
-    { 0x26, Mneumonic_es, NULL, NULL },
-    { 0x27, Mneumonic_daa, NULL, NULL },
-    { 0x28, Mneumonic_sub, "Eb", "Gb" },
-    { 0x29, Mneumonic_sub, "Ev", "Gv" },
-    { 0x2A, Mneumonic_sub, "Gb", "Eb" },
-    { 0x2B, Mneumonic_sub, "Gv", "Ev" },
-    { 0x2C, Mneumonic_sub, "AL", "Ib" },
-    { 0x2D, Mneumonic_sub, "eAX", "Iv" },
-    { 0x2E, Mneumonic_cs, NULL, NULL },
-    { 0x2F, Mneumonic_das, NULL, NULL },
-    { 0x30, Mneumonic_xor, "Eb", "Gb", Instruction_Type_logical },
-    { 0x31, Mneumonic_xor, "Ev", "Gv", Instruction_Type_logical },
-    { 0x32, Mneumonic_xor, "Gb", "Eb", Instruction_Type_logical },
-    { 0x33, Mneumonic_xor, "Gv", "Ev", Instruction_Type_logical },
-    { 0x34, Mneumonic_xor, "AL", "Ib", Instruction_Type_logical },
-    { 0x35, Mneumonic_xor, "eAX", "Iv", Instruction_Type_logical },
-    { 0x36, Mneumonic_ss, NULL, NULL },
-    { 0x37, Mneumonic_aaa, NULL, NULL },
-    { 0x38, Mneumonic_cmp, "Eb", "Gb", Instruction_Type_arithmetic },
-    { 0x39, Mneumonic_cmp, "Ev", "Gv", Instruction_Type_arithmetic },
-    { 0x3A, Mneumonic_cmp, "Gb", "Eb", Instruction_Type_arithmetic },
-    { 0x3B, Mneumonic_cmp, "Gv", "Ev", Instruction_Type_arithmetic },
-    { 0x3C, Mneumonic_cmp, "AL", "Ib", Instruction_Type_arithmetic },
-    { 0x3D, Mneumonic_cmp, "eAX", "Iv", Instruction_Type_arithmetic },
-    { 0x3E, Mneumonic_ds, NULL, NULL },
-    { 0x3F, Mneumonic_aas, NULL, NULL },
-    { 0x40, Mneumonic_inc, "eAX", NULL },
-    { 0x41, Mneumonic_inc, "eCX", NULL },
-    { 0x42, Mneumonic_inc, "eDX", NULL },
-    { 0x43, Mneumonic_inc, "eBX", NULL },
-    { 0x44, Mneumonic_inc, "eSP", NULL },
-    { 0x45, Mneumonic_inc, "eBP", NULL },
-    { 0x46, Mneumonic_inc, "eSI", NULL },
-    { 0x47, Mneumonic_inc, "eDI", NULL },
-    { 0x48, Mneumonic_dec, "eAX", NULL },
-    { 0x49, Mneumonic_dec, "eCX", NULL },
-    { 0x4A, Mneumonic_dec, "eDX", NULL },
-    { 0x4B, Mneumonic_dec, "eBX", NULL },
-    { 0x4C, Mneumonic_dec, "eSP", NULL },
-    { 0x4D, Mneumonic_dec, "eBP", NULL },
-    { 0x4E, Mneumonic_dec, "eSI", NULL },
-    { 0x4F, Mneumonic_dec, "eDI", NULL },
-    { 0x50, Mneumonic_push, "eAX", NULL, Instruction_Type_stack },
-    { 0x51, Mneumonic_push, "eCX", NULL, Instruction_Type_stack },
-    { 0x52, Mneumonic_push, "eDX", NULL, Instruction_Type_stack },
-    { 0x53, Mneumonic_push, "eBX", NULL, Instruction_Type_stack },
-    { 0x54, Mneumonic_push, "eSP", NULL, Instruction_Type_stack },
-    { 0x55, Mneumonic_push, "eBP", NULL, Instruction_Type_stack },
-    { 0x56, Mneumonic_push, "eSI", NULL, Instruction_Type_stack },
-    { 0x57, Mneumonic_push, "eDI", NULL, Instruction_Type_stack },
-    { 0x58, Mneumonic_pop, "eAX", NULL, Instruction_Type_stack },
-    { 0x59, Mneumonic_pop, "eCX", NULL, Instruction_Type_stack },
-    { 0x5A, Mneumonic_pop, "eDX", NULL, Instruction_Type_stack },
-    { 0x5B, Mneumonic_pop, "eBX", NULL, Instruction_Type_stack },
-    { 0x5C, Mneumonic_pop, "eSP", NULL, Instruction_Type_stack },
-    { 0x5D, Mneumonic_pop, "eBP", NULL, Instruction_Type_stack },
-    { 0x5E, Mneumonic_pop, "eSI", NULL, Instruction_Type_stack },
-    { 0x5F, Mneumonic_pop, "eDI", NULL, Instruction_Type_stack },
-    { 0x60, Mneumonic_db, NULL, NULL },
-    { 0x61, Mneumonic_db, NULL, NULL },
-    { 0x62, Mneumonic_db, NULL, NULL },
-    { 0x63, Mneumonic_db, NULL, NULL },
-    { 0x64, Mneumonic_db, NULL, NULL },
-    { 0x65, Mneumonic_db, NULL, NULL },
-    { 0x66, Mneumonic_db, NULL, NULL },
-    { 0x67, Mneumonic_db, NULL, NULL },
-    { 0x68, Mneumonic_db, NULL, NULL },
-    { 0x69, Mneumonic_db, NULL, NULL },
-    { 0x6A, Mneumonic_db, NULL, NULL },
-    { 0x6B, Mneumonic_db, NULL, NULL },
-    { 0x6C, Mneumonic_db, NULL, NULL },
-    { 0x6D, Mneumonic_db, NULL, NULL },
-    { 0x6E, Mneumonic_db, NULL, NULL },
-    { 0x6F, Mneumonic_db, NULL, NULL },
-    { 0x70, Mneumonic_jo, "Jb", NULL, Instruction_Type_flow },
-    { 0x71, Mneumonic_jno, "Jb", NULL, Instruction_Type_flow },
-    { 0x72, Mneumonic_jb, "Jb", NULL, Instruction_Type_flow },
-    { 0x73, Mneumonic_jnb, "Jb", NULL, Instruction_Type_flow },
-    { 0x74, Mneumonic_jz, "Jb", NULL, Instruction_Type_flow },
-    { 0x75, Mneumonic_jnz, "Jb", NULL, Instruction_Type_flow },
-    { 0x76, Mneumonic_jbe, "Jb", NULL, Instruction_Type_flow },
-    { 0x77, Mneumonic_ja, "Jb", NULL, Instruction_Type_flow },
-    { 0x78, Mneumonic_js, "Jb", NULL, Instruction_Type_flow },
-    { 0x79, Mneumonic_jns, "Jb", NULL, Instruction_Type_flow },
-    { 0x7A, Mneumonic_jp, "Jb", NULL, Instruction_Type_flow },
-    { 0x7B, Mneumonic_jnp, "Jb", NULL, Instruction_Type_flow },
-    { 0x7C, Mneumonic_jl, "Jb", NULL, Instruction_Type_flow },
-    { 0x7D, Mneumonic_jnl, "Jb", NULL, Instruction_Type_flow },
-    { 0x7E, Mneumonic_jle, "Jb", NULL, Instruction_Type_flow },
-    { 0x7F, Mneumonic_jg, "Jb", NULL, Instruction_Type_flow },
-    { 0x80, Mneumonic_grp1, "Eb", "Ib" },
-    { 0x81, Mneumonic_grp1, "Ev", "Iv" },
-    { 0x82, Mneumonic_grp1, "Eb", "Ib" },
-    { 0x83, Mneumonic_grp1, "Ev", "Ib" },
-    { 0x84, Mneumonic_test, "Gb", "Eb" },
-    { 0x85, Mneumonic_test, "Gv", "Ev" },
-    { 0x86, Mneumonic_xchg, "Gb", "Eb" },
-    { 0x87, Mneumonic_xchg, "Gv", "Ev" },
-    { 0x88, Mneumonic_mov, "Eb", "Gb", Instruction_Type_move },
-    { 0x89, Mneumonic_mov, "Ev", "Gv", Instruction_Type_move },
-    { 0x8A, Mneumonic_mov, "Gb", "Eb", Instruction_Type_move },
-    { 0x8B, Mneumonic_mov, "Gv", "Ev", Instruction_Type_move },
-    { 0x8C, Mneumonic_mov, "Ew", "Sw", Instruction_Type_move },
-    { 0x8D, Mneumonic_lea, "Gv", "M" },
-    { 0x8E, Mneumonic_mov, "Sw", "Ew", Instruction_Type_move },
-    { 0x8F, Mneumonic_pop, "Ev", NULL, Instruction_Type_stack },
-    { 0x90, Mneumonic_nop, NULL, NULL },
-    { 0x91, Mneumonic_xchg, "eCX", "eAX" },
-    { 0x92, Mneumonic_xchg, "eDX", "eAX" },
-    { 0x93, Mneumonic_xchg, "eBX", "eAX" },
-    { 0x94, Mneumonic_xchg, "eSP", "eAX" },
-    { 0x95, Mneumonic_xchg, "eBP", "eAX" },
-    { 0x96, Mneumonic_xchg, "eSI", "eAX" },
-    { 0x97, Mneumonic_xchg, "eDI", "eAX" },
-    { 0x98, Mneumonic_cbw, NULL, NULL },
-    { 0x99, Mneumonic_cwd, NULL, NULL },
-    { 0x9A, Mneumonic_call, "Ap", NULL },
-    { 0x9B, Mneumonic_wait, NULL, NULL },
-    { 0x9C, Mneumonic_pushf, NULL, NULL, Instruction_Type_stack },
-    { 0x9D, Mneumonic_popf, NULL, NULL, Instruction_Type_stack },
-    { 0x9E, Mneumonic_sahf, NULL, NULL },
-    { 0x9F, Mneumonic_lahf, NULL, NULL },
-    { 0xA0, Mneumonic_mov, "AL", "Ob",  Instruction_Type_move },
-    { 0xA1, Mneumonic_mov, "eAX", "Ov", Instruction_Type_move },
-    { 0xA2, Mneumonic_mov, "Ob", "AL",  Instruction_Type_move },
-    { 0xA3, Mneumonic_mov, "Ov", "eAX", Instruction_Type_move },
-    { 0xA4, Mneumonic_movsb, NULL, NULL, Instruction_Type_move },
-    { 0xA5, Mneumonic_movsw, NULL, NULL, Instruction_Type_move },
-    { 0xA6, Mneumonic_cmpsb, NULL, NULL, Instruction_Type_arithmetic },
-    { 0xA7, Mneumonic_cmpsw, NULL, NULL, Instruction_Type_arithmetic },
-    { 0xA8, Mneumonic_test, "AL", "Ib" },
-    { 0xA9, Mneumonic_test, "eAX", "Iv" },
-    { 0xAA, Mneumonic_stosb, NULL, NULL, Instruction_Type_string },
-    { 0xAB, Mneumonic_stosw, NULL, NULL, Instruction_Type_string },
-    { 0xAC, Mneumonic_lodsb, NULL, NULL },
-    { 0xAD, Mneumonic_lodsw, NULL, NULL },
-    { 0xAE, Mneumonic_scasb, NULL, NULL },
-    { 0xAF, Mneumonic_scasw, NULL, NULL },
-    { 0xB0, Mneumonic_mov, "AL", "Ib", Instruction_Type_move },
-    { 0xB1, Mneumonic_mov, "CL", "Ib", Instruction_Type_move },
-    { 0xB2, Mneumonic_mov, "DL", "Ib", Instruction_Type_move },
-    { 0xB3, Mneumonic_mov, "BL", "Ib", Instruction_Type_move },
-    { 0xB4, Mneumonic_mov, "AH", "Ib", Instruction_Type_move },
-    { 0xB5, Mneumonic_mov, "CH", "Ib", Instruction_Type_move },
-    { 0xB6, Mneumonic_mov, "DH", "Ib", Instruction_Type_move },
-    { 0xB7, Mneumonic_mov, "BH", "Ib", Instruction_Type_move },
-    { 0xB8, Mneumonic_mov, "eAX", "Iv", Instruction_Type_move },
-    { 0xB9, Mneumonic_mov, "eCX", "Iv", Instruction_Type_move },
-    { 0xBA, Mneumonic_mov, "eDX", "Iv", Instruction_Type_move },
-    { 0xBB, Mneumonic_mov, "eBX", "Iv", Instruction_Type_move },
-    { 0xBC, Mneumonic_mov, "eSP", "Iv", Instruction_Type_move },
-    { 0xBD, Mneumonic_mov, "eBP", "Iv", Instruction_Type_move },
-    { 0xBE, Mneumonic_mov, "eSI", "Iv", Instruction_Type_move },
-    { 0xBF, Mneumonic_mov, "eDI", "Iv", Instruction_Type_move },
-    { 0xC0, Mneumonic_db, NULL, NULL },
-    { 0xC1, Mneumonic_db, NULL, NULL },
-    { 0xC2, Mneumonic_ret, "Iw", NULL },
-    { 0xC3, Mneumonic_ret, NULL, NULL },
-    { 0xC4, Mneumonic_les, "Gv", "Mp" },
-    { 0xC5, Mneumonic_lds, "Gv", "Mp" },
-    { 0xC6, Mneumonic_mov, "Eb", "Ib", Instruction_Type_move },
-    { 0xC7, Mneumonic_mov, "Ev", "Iv", Instruction_Type_move },
-    { 0xC8, Mneumonic_db, NULL, NULL },
-    { 0xC9, Mneumonic_db, NULL, NULL },
-    { 0xCA, Mneumonic_retf, "Iw", NULL },
-    { 0xCB, Mneumonic_retf, NULL, NULL },
-    { 0xCC, Mneumonic_int, "3", NULL },
-    { 0xCD, Mneumonic_int, "Ib", NULL },
-    { 0xCE, Mneumonic_into, NULL, NULL },
-    { 0xCF, Mneumonic_iret, NULL, NULL },
-    { 0xD0, Mneumonic_grp2, "Eb", "1" },
-    { 0xD1, Mneumonic_grp2, "Ev", "1" },
-    { 0xD2, Mneumonic_grp2, "Eb", "CL" },
-    { 0xD3, Mneumonic_grp2, "Ev", "CL" },
-    { 0xD4, Mneumonic_aam, "I0", NULL },
-    { 0xD5, Mneumonic_aad, "I0", NULL },
-    { 0xD6, Mneumonic_db, NULL, NULL },
-    { 0xD7, Mneumonic_xlat, NULL, NULL },
-    { 0xD8, Mneumonic_db, NULL, NULL },
-    { 0xD9, Mneumonic_db, NULL, NULL },
-    { 0xDA, Mneumonic_db, NULL, NULL },
-    { 0xDB, Mneumonic_db, NULL, NULL },
-    { 0xDC, Mneumonic_db, NULL, NULL },
-    { 0xDD, Mneumonic_db, NULL, NULL },
-    { 0xDE, Mneumonic_db, NULL, NULL },
-    { 0xDF, Mneumonic_db, NULL, NULL },
-    { 0xE0, Mneumonic_loopnz, "Jb", NULL, Instruction_Type_flow },
-    { 0xE1, Mneumonic_loopz, "Jb", NULL, Instruction_Type_flow },
-    { 0xE2, Mneumonic_loop, "Jb", NULL, Instruction_Type_flow },
-    { 0xE3, Mneumonic_jcxz, "Jb", NULL, Instruction_Type_flow },
-    { 0xE4, Mneumonic_in, "AL", "Ib" },
-    { 0xE5, Mneumonic_in, "eAX", "Ib" },
-    { 0xE6, Mneumonic_out, "Ib", "AL", Instruction_Type_io },
-    { 0xE7, Mneumonic_out, "Ib", "eAX", Instruction_Type_io },
-    { 0xE8, Mneumonic_call, "Jv", NULL },
-    { 0xE9, Mneumonic_jmp, "Jv", NULL, Instruction_Type_flow },
-    { 0xEA, Mneumonic_jmp, "Ap", NULL, Instruction_Type_flow },
-    { 0xEB, Mneumonic_jmp, "Jb", NULL, Instruction_Type_flow },
-    { 0xEC, Mneumonic_in, "AL", "DX" },
-    { 0xED, Mneumonic_in, "eAX", "DX" },
-    { 0xEE, Mneumonic_out, "DX", "AL", Instruction_Type_io },
-    { 0xEF, Mneumonic_out, "DX", "eAX", Instruction_Type_io },
-    { 0xF0, Mneumonic_lock, NULL, NULL },
-    { 0xF1, Mneumonic_db, NULL, NULL },
-    { 0xF2, Mneumonic_repnz, NULL, NULL },
-    { 0xF3, Mneumonic_repz, NULL, NULL },
-    { 0xF4, Mneumonic_hlt, NULL, NULL },
-    { 0xF5, Mneumonic_cmc, NULL, NULL },
-    { 0xF6, Mneumonic_grp3a, "Eb", NULL },
-    { 0xF7, Mneumonic_grp3b, "Ev", NULL },
-    { 0xF8, Mneumonic_clc, NULL, NULL },
-    { 0xF9, Mneumonic_stc, NULL, NULL },
-    { 0xFA, Mneumonic_cli, NULL, NULL },
-    { 0xFB, Mneumonic_sti, NULL, NULL },
-    { 0xFC, Mneumonic_cld, NULL, NULL},
-    { 0xFD, Mneumonic_std, NULL, NULL },
-    { 0xFE, Mneumonic_grp4, "Eb", NULL },
-    { 0xFF, Mneumonic_grp5, "Ev", NULL },
+static const i8086_Inst_Table i8086_group_table[I8086_GROUP_COUNT][8] = {
+    [Mneumonic_grp1 - Mneumonic_grp1] = {
+        { 0, Mneumonic_add, Operand_Spec_none, Operand_Spec_none },
+        { 1, Mneumonic_or, Operand_Spec_none, Operand_Spec_none },
+        { 2, Mneumonic_adc, Operand_Spec_none, Operand_Spec_none },
+        { 3, Mneumonic_sbb, Operand_Spec_none, Operand_Spec_none },
+        { 4, Mneumonic_and, Operand_Spec_none, Operand_Spec_none },
+        { 5, Mneumonic_sub, Operand_Spec_none, Operand_Spec_none },
+        { 6, Mneumonic_xor, Operand_Spec_none, Operand_Spec_none },
+        { 7, Mneumonic_cmp, Operand_Spec_none, Operand_Spec_none },
+    },
+    [Mneumonic_grp2 - Mneumonic_grp1] = {
+        { 0, Mneumonic_rol, Operand_Spec_none, Operand_Spec_none },
+        { 1, Mneumonic_ror, Operand_Spec_none, Operand_Spec_none },
+        { 2, Mneumonic_rcl, Operand_Spec_none, Operand_Spec_none },
+        { 3, Mneumonic_rcr, Operand_Spec_none, Operand_Spec_none },
+        { 4, Mneumonic_shl, Operand_Spec_none, Operand_Spec_none },
+        { 5, Mneumonic_shr, Operand_Spec_none, Operand_Spec_none },
+        { 6, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+        { 7, Mneumonic_sar, Operand_Spec_none, Operand_Spec_none },
+    },
+    [Mneumonic_grp3a - Mneumonic_grp1] = {
+        { 0, Mneumonic_test, Operand_Spec_Eb, Operand_Spec_Ib },
+        { 1, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+        { 2, Mneumonic_not, Operand_Spec_none, Operand_Spec_none },
+        { 3, Mneumonic_neg, Operand_Spec_none, Operand_Spec_none },
+        { 4, Mneumonic_mul, Operand_Spec_none, Operand_Spec_none },
+        { 5, Mneumonic_imul, Operand_Spec_none, Operand_Spec_none },
+        { 6, Mneumonic_div, Operand_Spec_none, Operand_Spec_none },
+        { 7, Mneumonic_idiv, Operand_Spec_none, Operand_Spec_none },
+    },
+    [Mneumonic_grp3b - Mneumonic_grp1] = {
+        { 0, Mneumonic_test, Operand_Spec_Ev, Operand_Spec_Iv },
+        { 1, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+        { 2, Mneumonic_not, Operand_Spec_none, Operand_Spec_none },
+        { 3, Mneumonic_neg, Operand_Spec_none, Operand_Spec_none },
+        { 4, Mneumonic_mul, Operand_Spec_none, Operand_Spec_none },
+        { 5, Mneumonic_imul, Operand_Spec_none, Operand_Spec_none },
+        { 6, Mneumonic_div, Operand_Spec_none, Operand_Spec_none },
+        { 7, Mneumonic_idiv, Operand_Spec_none, Operand_Spec_none },
+    },
+    [Mneumonic_grp4 - Mneumonic_grp1] = {
+        { 0, Mneumonic_inc, Operand_Spec_none, Operand_Spec_none },
+        { 1, Mneumonic_dec, Operand_Spec_none, Operand_Spec_none },
+        { 2, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+        { 3, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+        { 4, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+        { 5, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+        { 6, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+        { 7, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+    },
+    [Mneumonic_grp5 - Mneumonic_grp1] = {
+        { 0, Mneumonic_inc, Operand_Spec_none, Operand_Spec_none },
+        { 1, Mneumonic_dec, Operand_Spec_none, Operand_Spec_none },
+        { 2, Mneumonic_call, Operand_Spec_none, Operand_Spec_none },
+        { 3, Mneumonic_call, Operand_Spec_Mp, Operand_Spec_none },
+        { 4, Mneumonic_jmp, Operand_Spec_none, Operand_Spec_none },
+        { 5, Mneumonic_jmp, Operand_Spec_Mp, Operand_Spec_none },
+        { 6, Mneumonic_push, Operand_Spec_none, Operand_Spec_none },
+        { 7, Mneumonic_invalid, Operand_Spec_none, Operand_Spec_none },
+    },
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,283 @@
+#include "libsim86.h"
+#include "sim86.h"
+#include "simulator.h"
+#include "port_io.h"
+#include "micro_op.h"
+
+struct Sim86 {
+    CPU cpu;
+
+    Sim86_Port_Write port_write;
+    Sim86_Port_Read port_read;
+    void *port_user;
+
+    Sim86_Video_Callback video;
+    void *video_user;
+    u64 video_interval;
+    u64 video_countdown;
+
+    u8 memory_exposed; // the memory was written behind the dirty tracking
+    u8 stop;
+};
+
+static const Register sim86_registers[] = {
+    [Sim86_Register_ax] = Register_ax,
+    [Sim86_Register_bx] = Register_bx,
+    [Sim86_Register_cx] = Register_cx,
+    [Sim86_Register_dx] = Register_dx,
+    [Sim86_Register_sp] = Register_sp,
+    [Sim86_Register_bp] = Register_bp,
+    [Sim86_Register_si] = Register_si,
+    [Sim86_Register_di] = Register_di,
+    [Sim86_Register_es] = Register_es,
+    [Sim86_Register_cs] = Register_cs,
+    [Sim86_Register_ss] = Register_ss,
+    [Sim86_Register_ds] = Register_ds,
+};
+
+static void sim86_port_write(CPU *cpu, void *user, u16 port, u16 data, u8 wide)
+{
+    Sim86 *sim = (Sim86 *)user;
+    if (sim->port_write) {
+        sim->port_write(sim->port_user, port, data, wide);
+    }
+}
+
+static u16 sim86_port_read(CPU *cpu, void *user, u16 port, u8 wide)
+{
+    Sim86 *sim = (Sim86 *)user;
+    if (sim->port_read) {
+        return sim->port_read(sim->port_user, port, wide);
+    }
+
+    return wide ? PORT_OPEN_BUS : (PORT_OPEN_BUS & 0xFF);
+}
+
+Sim86 *sim86_create(void)
+{
+    Sim86 *sim = (Sim86 *)calloc(1, sizeof(Sim86));
+    if (sim == NULL) {
+        return NULL;
+    }
+
+    CPU *cpu = &sim->cpu;
+    cpu->quiet = 1;
+
+    // Every port is ours, so the default handlers never write ./port.out
+    cpu->io = port_io_create();
+    port_io_set_handler(cpu->io, 0, PORT_COUNT - 1, sim86_port_write, sim86_port_read, sim);
+
+    boot(cpu);
+    return sim;
+}
+
+void sim86_destroy(Sim86 *sim)
+{
+    power_off(&sim->cpu);
+    port_io_destroy(sim->cpu.io);
+    free(sim);
+}
+
+Sim86_Status sim86_load_memory(Sim86 *sim, const void *program, uint32_t size)
+{
+    CPU *cpu = &sim->cpu;
+    if (sim->memory_exposed) {
+        mark_memory_dirty(cpu, 0, MAX_MEMORY);
+    }
+    boot(cpu);
+
+    if (calc_inst_pointer_address(cpu) + (u64)size > MAX_MEMORY) {
+        return Sim86_Error;
+    }
+
+    load_executable_from_memory(cpu, (const u8 *)program, size);
+    sim->video_countdown = sim->video_interval;
+
+    return Sim86_Ok;
+}
+
+Sim86_Status sim86_load(Sim86 *sim, const char *filename)
+{
+    // load_executable() asserts on the errors, the file is read here instead
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        return Sim86_Error;
+    }
+
+    u8 *program = (u8 *)malloc(MAX_MEMORY);
+    if (program == NULL) {
+        fclose(fp);
+        return Sim86_Error;
+    }
+
+    // Reading one byte more than the memory tells apart the files which don't fit
+    u32 size = fread(program, 1, MAX_MEMORY, fp);
+    u8 too_big = fgetc(fp) != EOF;
+    fclose(fp);
+
+    Sim86_Status status = too_big ? Sim86_Error : sim86_load_memory(sim, program, size);
+    free(program);
+
+    return status;
+}
+
+static Sim86_Status machine_status(CPU *cpu)
+{
+    if (cpu->fault) {
+        return Sim86_Fault;
+    }
+
+    if (cpu->terminate) {
+        return Sim86_Unhandled;
+    }
+
+    if (calc_inst_pointer_address(cpu) >= cpu->exec_end) {
+        return Sim86_Halted;
+    }
+
+    return Sim86_Ok;
+}
+
+static void step(Sim86 *sim)
+{
+    step_instruction(&sim->cpu);
+
+    if (sim->video && --sim->video_countdown == 0) {
+        sim->video(sim->video_user, sim->cpu.memory + SIM86_VIDEO_ADDRESS);
+        sim->video_countdown = sim->video_interval;
+    }
+}
+
+Sim86_Status sim86_step_n(Sim86 *sim, uint64_t count)
+{
+    sim->stop = 0;
+
+    for (u64 i = 0; i < count; i++) {
+        Sim86_Status status = machine_status(&sim->cpu);
+        if (status != Sim86_Ok) {
+            return status;
+        }
+
+        step(sim);
+
+        if (sim->stop) {
+            return Sim86_Stopped;
+        }
+    }
+
+    return machine_status(&sim->cpu);
+}
+
+Sim86_Status sim86_run_until(Sim86 *sim, uint32_t address, uint64_t limit)
+{
+    CPU *cpu = &sim->cpu;
+    sim->stop = 0;
+
+    for (u64 executed = 0; !limit || executed < limit; executed++) {
+        Sim86_Status status = machine_status(cpu);
+        if (status != Sim86_Ok) {
+            return status;
+        }
+
+        step(sim);
+
+        if (sim->stop) {
+            return Sim86_Stopped;
+        }
+
+        if (calc_inst_pointer_address(cpu) == address) {
+            return Sim86_Reached;
+        }
+    }
+
+    return Sim86_Limit;
+}
+
+uint16_t sim86_read_reg(Sim86 *sim, Sim86_Register reg)
+{
+    assert(reg < Sim86_Register_Count);
+
+    if (reg == Sim86_Register_ip)    return sim->cpu.ip;
+    if (reg == Sim86_Register_flags) return sim->cpu.flags;
+
+    return get_data_from_register(&sim->cpu, register_access_by_enum(sim86_registers[reg]));
+}
+
+void sim86_write_reg(Sim86 *sim, Sim86_Register reg, uint16_t value)
+{
+    assert(reg < Sim86_Register_Count);
+
+    if (reg == Sim86_Register_ip) {
+        sim->cpu.ip = value;
+    } else if (reg == Sim86_Register_flags) {
+        sim->cpu.flags = value;
+    } else {
+        // Directly into the register file, set_data_to_register() would trace the change
+        Register_Access *access = register_access_by_enum(sim86_registers[reg]);
+        *(u16 *)(sim->cpu.regmem + access->index) = BYTE_SWAP(value);
+    }
+}
+
+void sim86_read_mem(Sim86 *sim, uint32_t address, void *dest, uint32_t size)
+{
+    u8 *bytes = (u8 *)dest;
+    for (u32 i = 0; i < size; i++) {
+        bytes[i] = sim->cpu.memory[(address + i) & (MAX_MEMORY - 1)];
+    }
+}
+
+void sim86_write_mem(Sim86 *sim, uint32_t address, const void *src, uint32_t size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    const u8 *bytes = (const u8 *)src;
+    for (u32 i = 0; i < size; i++) {
+        sim->cpu.memory[(address + i) & (MAX_MEMORY - 1)] = bytes[i];
+    }
+
+    mark_memory_dirty(&sim->cpu, address, size < MAX_MEMORY ? size : MAX_MEMORY);
+}
+
+uint8_t *sim86_memory(Sim86 *sim)
+{
+    sim->memory_exposed = 1;
+
+    // The writes of the caller don't invalidate the decoded instructions, every one is decoded when it runs
+    sim->cpu.no_micro_op_cache = 1;
+    if (sim->cpu.micro_ops) {
+        micro_op_cache_destroy(sim->cpu.micro_ops);
+        sim->cpu.micro_ops = NULL;
+    }
+
+    return sim->cpu.memory;
+}
+
+void sim86_get_stats(Sim86 *sim, Sim86_Stats *stats)
+{
+    stats->instructions  = sim->cpu.stats.instructions;
+    stats->cycles        = sim->cpu.stats.cycles;
+    stats->memory_reads  = sim->cpu.stats.memory_reads;
+    stats->memory_writes = sim->cpu.stats.memory_writes;
+}
+
+void sim86_set_port_callbacks(Sim86 *sim, Sim86_Port_Write write, Sim86_Port_Read read, void *user)
+{
+    sim->port_write = write;
+    sim->port_read = read;
+    sim->port_user = user;
+}
+
+void sim86_set_video_callback(Sim86 *sim, Sim86_Video_Callback callback, void *user, uint64_t interval)
+{
+    sim->video = interval ? callback : NULL;
+    sim->video_user = user;
+    sim->video_interval = interval;
+    sim->video_countdown = interval;
+}
+
+void sim86_stop(Sim86 *sim)
+{
+    sim->stop = 1;
+}
@@ -0,0 +1,122 @@
+#ifndef _H_LIBSIM86
+#define _H_LIBSIM86
+
+#include <stdint.h>
+
+// Embeddable simulator (make lib: ./build/libsim86.a and ./build/libsim86.so).
+//
+// Every machine is a separate handle with its own memory, registers and devices. The library
+// keeps no global state, so any number of machines can run on any number of threads, as long
+// as one machine is only used by one thread at a time. Nothing is printed and no file is
+// written, the outs of the guest only go to the port callback.
+//
+//   Sim86 *sim = sim86_create();
+//   if (sim86_load(sim, "input/listing_0052_memory_add_loop") == Sim86_Ok) {
+//       Sim86_Status status = sim86_run_until(sim, SIM86_NO_ADDRESS, 1000000);
+//       uint16_t bx = sim86_read_reg(sim, Sim86_Register_bx);
+//   }
+//   sim86_destroy(sim);
+//
+// The program is loaded to f000:0100 and the machine runs until the ip leaves the loaded bytes.
+
+#if defined(__GNUC__)
+#define SIM86_API __attribute__((visibility("default")))
+#else
+#define SIM86_API
+#endif
+
+#define SIM86_MEMORY_SIZE (1024 * 1024)
+#define SIM86_NO_ADDRESS 0xFFFFFFFF // run_until() only stops at the end of the program or at the limit
+
+// The guest draws to a 128x128 framebuffer at the start of the memory, the pixels are 16bit
+// R5G6B5 words stored high byte first and the bottom row comes first.
+#define SIM86_VIDEO_ADDRESS 0
+#define SIM86_VIDEO_WIDTH 128
+#define SIM86_VIDEO_HEIGHT 128
+#define SIM86_VIDEO_SIZE (SIM86_VIDEO_WIDTH * SIM86_VIDEO_HEIGHT * 2)
+
+typedef struct Sim86 Sim86;
+
+typedef enum {
+    Sim86_Ok,        // the machine can continue
+    Sim86_Halted,    // the ip left the program
+    Sim86_Unhandled, // the guest hit an instruction the simulator doesn't handle yet
+    Sim86_Reached,   // run_until() arrived at the address
+    Sim86_Limit,     // run_until() used up its instructions
+    Sim86_Stopped,   // a callback called sim86_stop()
+    Sim86_Error,     // the program can't be read or doesn't fit into the memory
+    Sim86_Fault,     // the guest divided by zero or hit a form the simulator can't execute, the ip stays on it
+} Sim86_Status;
+
+typedef enum {
+    Sim86_Register_ax,
+    Sim86_Register_bx,
+    Sim86_Register_cx,
+    Sim86_Register_dx,
+    Sim86_Register_sp,
+    Sim86_Register_bp,
+    Sim86_Register_si,
+    Sim86_Register_di,
+    Sim86_Register_es,
+    Sim86_Register_cs,
+    Sim86_Register_ss,
+    Sim86_Register_ds,
+    Sim86_Register_ip,
+    Sim86_Register_flags,
+
+    Sim86_Register_Count
+} Sim86_Register;
+
+typedef struct {
+    uint64_t instructions;
+    uint64_t cycles;        // modelled 8086 clocks
+    uint64_t memory_reads;  // bytes
+    uint64_t memory_writes; // bytes
+} Sim86_Stats;
+
+// wide is 0 for a byte sized in or out, the byte sized data is in the low 8 bits
+typedef void (*Sim86_Port_Write)(void *user, uint16_t port, uint16_t data, uint8_t wide);
+typedef uint16_t (*Sim86_Port_Read)(void *user, uint16_t port, uint8_t wide);
+
+// Called with the framebuffer (SIM86_VIDEO_SIZE bytes), it is only valid during the call
+typedef void (*Sim86_Video_Callback)(void *user, const uint8_t *framebuffer);
+
+// Returns NULL if the memory of the machine can't be allocated
+SIM86_API Sim86 *sim86_create(void);
+SIM86_API void sim86_destroy(Sim86 *sim);
+
+// Both reset the machine (memory, registers, stats) before loading, the callbacks are kept
+SIM86_API Sim86_Status sim86_load(Sim86 *sim, const char *filename);
+SIM86_API Sim86_Status sim86_load_memory(Sim86 *sim, const void *program, uint32_t size);
+
+// Executes up to count instructions, Sim86_Ok if all of them ran
+SIM86_API Sim86_Status sim86_step_n(Sim86 *sim, uint64_t count);
+
+// Runs until the instruction at the absolute address is next (after at least one instruction)
+// or limit instructions are executed, 0 is no limit
+SIM86_API Sim86_Status sim86_run_until(Sim86 *sim, uint32_t address, uint64_t limit);
+
+SIM86_API uint16_t sim86_read_reg(Sim86 *sim, Sim86_Register reg);
+SIM86_API void sim86_write_reg(Sim86 *sim, Sim86_Register reg, uint16_t value);
+
+// The accesses wrap around at SIM86_MEMORY_SIZE like the 20bit address bus
+SIM86_API void sim86_read_mem(Sim86 *sim, uint32_t address, void *dest, uint32_t size);
+SIM86_API void sim86_write_mem(Sim86 *sim, uint32_t address, const void *src, uint32_t size);
+
+// The guest memory itself (SIM86_MEMORY_SIZE bytes), the pointer is valid until sim86_destroy().
+// It can be written freely, after the first call every load resets the whole memory.
+SIM86_API uint8_t *sim86_memory(Sim86 *sim);
+
+SIM86_API void sim86_get_stats(Sim86 *sim, Sim86_Stats *stats);
+
+// Every port goes to these, a NULL write drops the outs and a NULL read reads back 0xFFFF (open bus)
+SIM86_API void sim86_set_port_callbacks(Sim86 *sim, Sim86_Port_Write write, Sim86_Port_Read read, void *user);
+
+// The callback is called after every interval executed instructions, NULL disables it
+SIM86_API void sim86_set_video_callback(Sim86 *sim, Sim86_Video_Callback callback, void *user, uint64_t interval);
+
+// Makes the running step_n() or run_until() return Sim86_Stopped after the current instruction,
+// only meant to be called from the callbacks
+SIM86_API void sim86_stop(Sim86 *sim);
+
+#endif
@@ -0,0 +1,107 @@
+#include "live_view.h"
+#include "simulator.h"
+#include "guest_memory.h"
+
+#ifdef _WIN32
+
+// No POSIX shared memory objects, the machine runs without the live view
+Live_View *live_view_create(const char *name)
+{
+    printf("\n[ERROR]: The live view (--shm %s) is not available on Windows.\n", name);
+    return NULL;
+}
+
+void live_view_destroy(Live_View *view)
+{
+    free(view);
+}
+
+void live_view_publish(CPU *cpu, Live_View_State state)
+{
+}
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define LIVE_VIEW_SIZE (LIVE_VIEW_HEADER_SIZE + GUEST_MEMORY_SIZE)
+
+static const Register live_view_registers[12] = {
+    Register_ax, Register_bx, Register_cx, Register_dx,
+    Register_sp, Register_bp, Register_si, Register_di,
+    Register_es, Register_cs, Register_ss, Register_ds
+};
+
+Live_View *live_view_create(const char *name)
+{
+    static_assert(sizeof(Live_View_Header) <= LIVE_VIEW_HEADER_SIZE, "the live view header has to fit into its page");
+
+    int fd = shm_open(name, O_RDWR|O_CREAT, 0644);
+    if (fd < 0) {
+        printf("\n[ERROR]: Failed to open the %s shared memory object.\n", name);
+        assert(0);
+    }
+
+    // Truncating first drops the content of a previous run with the same name
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, LIVE_VIEW_SIZE) != 0) {
+        printf("\n[ERROR]: Failed to resize the %s shared memory object.\n", name);
+        assert(0);
+    }
+
+    u8 *mapping = (u8 *)mmap(NULL, LIVE_VIEW_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        printf("\n[ERROR]: Failed to map the %s shared memory object.\n", name);
+        assert(0);
+    }
+
+    Live_View *view = (Live_View *)calloc(1, sizeof(Live_View));
+    assert(view != NULL);
+
+    view->header = (Live_View_Header *)mapping;
+    view->memory = mapping + LIVE_VIEW_HEADER_SIZE;
+
+    Live_View_Header *header = view->header;
+    header->version = LIVE_VIEW_VERSION;
+    header->header_size = LIVE_VIEW_HEADER_SIZE;
+    header->memory_offset = LIVE_VIEW_HEADER_SIZE;
+    header->memory_size = MAX_MEMORY;
+    header->state = Live_View_Running;
+
+    // The magic goes last, a reader which sees it sees a complete header
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(header->magic, LIVE_VIEW_MAGIC, sizeof(header->magic));
+
+    return view;
+}
+
+void live_view_destroy(Live_View *view)
+{
+    munmap(view->header, LIVE_VIEW_SIZE);
+    free(view);
+}
+
+void live_view_publish(CPU *cpu, Live_View_State state)
+{
+    Live_View_Header *header = cpu->live_view->header;
+
+    // Seqlock: odd while writing, the fences keep the field stores between the two increments
+    u32 sequence = header->sequence;
+    __atomic_store_n(&header->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for (u32 i = 0; i < ARRAY_SIZE(live_view_registers); i++) {
+        header->registers[i] = get_data_from_register(cpu, register_access_by_enum(live_view_registers[i]));
+    }
+    header->ip = cpu->ip;
+    header->flags = cpu->flags;
+    header->stats = cpu->stats;
+    header->state = state;
+
+    __atomic_store_n(&header->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+#endif
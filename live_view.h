@@ -0,0 +1,57 @@
+#ifndef _H_LIVE_VIEW
+#define _H_LIVE_VIEW
+
+#include "sim86.h"
+
+// The guest memory and a state block in a named POSIX shared memory object (--shm <name>),
+// so other processes (a viewer, a dashboard, a test harness) can watch the machine while it
+// runs without any copy or message:
+//
+//   Live_View_Header, zero padded to LIVE_VIEW_HEADER_SIZE
+//   u8 memory[GUEST_MEMORY_SIZE]   at header.memory_offset, the guest memory itself
+//
+// The memory is live, the registers and the stats are published every LIVE_VIEW_PUBLISH_INTERVAL
+// instructions and at exit. The sequence is odd while they are written, a reader copies them
+// and retries if the sequence was odd or changed meanwhile. The object is kept after the exit,
+// so the final state can be read too (shm_unlink, or rm /dev/shm/<name> on Linux).
+//
+// demo/live_view.py is an example reader.
+
+#define LIVE_VIEW_MAGIC "S86LIVE"
+#define LIVE_VIEW_VERSION 1
+#define LIVE_VIEW_HEADER_SIZE MEMORY_PAGE_SIZE
+#define LIVE_VIEW_PUBLISH_INTERVAL 4096
+
+typedef enum {
+    Live_View_Running = 1,
+    Live_View_Exited  = 2,
+} Live_View_State;
+
+typedef struct {
+    char magic[8];
+    u32 version;
+    u32 header_size;
+    u32 memory_offset;
+    u32 memory_size;
+
+    u32 sequence;
+    u32 state; // Live_View_State
+
+    u16 registers[12]; // ax, bx, cx, dx, sp, bp, si, di, es, cs, ss, ds
+    u16 ip;
+    u16 flags;
+    Cpu_Stats stats;
+} Live_View_Header;
+
+struct Live_View {
+    Live_View_Header *header;
+    u8 *memory; // handed to the cpu instead of a private mapping
+};
+
+// The object is created or truncated, so it is all zero. Returns NULL on Windows.
+Live_View *live_view_create(const char *name);
+void live_view_destroy(Live_View *view);
+
+void live_view_publish(CPU *cpu, Live_View_State state);
+
+#endif
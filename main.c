@@ -1,18 +1,200 @@
 #include "sim86.h"
 #include "decoder.h"
 #include "simulator.h"
+#include "heatmap.h"
+#include "profiler.h"
+#include "port_io.h"
+#include "debugger.h"
+#include "gdbstub.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "guest_memory.h"
+#include "fork_server.h"
+#include "fuzzer.h"
+#include "batch.h"
+#include "live_view.h"
+#include "dump.h"
+#include "cfg.h"
+#include "disassembler.h"
+#include "decode_output.h"
+#include "decoder_fuzz.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include <time.h>
+
+// Boots, loads and runs the program count times on pooled memories, the machines share
+// the options and the devices of the template cpu
+static void bench_machines(CPU *template_cpu, char *input_filename, u32 count)
+{
+    assert(template_cpu->debugger == NULL && template_cpu->replay == NULL);
+
+    Memory_Pool *pool = memory_pool_create();
+    u64 instructions = 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (u32 i = 0; i < count; i++) {
+        CPU cpu = *template_cpu;
+        cpu.memory_pool = pool;
+
+        boot(&cpu);
+        load_executable(&cpu, input_filename);
+        run(&cpu);
+
+        instructions += cpu.stats.instructions;
+        power_off(&cpu);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("\n[BENCH]: %u machines in %.3f s, %.0f machines/s, %lu instructions\n",
+           count, seconds, count / seconds, instructions);
+
+    memory_pool_destroy(pool);
+}
+
+// Writes the control-flow graph of the loaded program, nothing is executed
+static void export_cfg(CPU *cpu, char *json_filename, char *dot_filename)
+{
+    Control_Flow_Graph *cfg = cfg_create(cpu);
+
+    if (json_filename) {
+        FILE *fp = fopen(json_filename, "w");
+        if (fp == NULL) {
+            printf("\n[ERROR]: Failed to open %s for the control-flow graph.\n", json_filename);
+        } else {
+            cfg_write_json(cfg, fp);
+            fclose(fp);
+        }
+    }
+
+    if (dot_filename) {
+        FILE *fp = fopen(dot_filename, "w");
+        if (fp == NULL) {
+            printf("\n[ERROR]: Failed to open %s for the control-flow graph.\n", dot_filename);
+        } else {
+            cfg_write_dot(cfg, fp);
+            fclose(fp);
+        }
+    }
+
+    printf("[CFG]: %u blocks, %u edges, %u functions, %u loops\n", cfg->block_count, cfg->edge_count, cfg->function_count, cfg->loop_count);
+
+    cfg_destroy(cfg);
+}
+
+static void run_batch(char *manifest, char *report, u32 thread_count)
+{
+    Batch *batch = batch_load_manifest(manifest);
+    if (batch == NULL) {
+        return;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    batch_run(batch, thread_count);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    FILE *fp = fopen(report, "w");
+    if (fp == NULL) {
+        printf("\n[ERROR]: Failed to open %s for the batch report.\n", report);
+    } else {
+        batch_write_report(batch, fp, seconds);
+        fclose(fp);
+        printf("\n[BATCH]: %u runs on %u threads in %.3f s, report: %s\n", batch->run_count, batch->thread_count, seconds, report);
+    }
+
+    batch_destroy(batch);
+}
+
+// Runs the guest to the snapshot point, then the iterations on the fork server
+static void run_persistent(CPU *cpu, u64 iterations, u32 snapshot_at, u32 end_address, u64 instruction_limit)
+{
+    assert(cpu->debugger == NULL && cpu->replay == NULL);
+
+    if (!fork_server_run_to(cpu, snapshot_at)) {
+        return;
+    }
+
+    Fork_Server *server = fork_server_create(cpu);
+    server->end_address = end_address;
+    if (instruction_limit) {
+        server->instruction_limit = instruction_limit;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (u64 i = 0; i < iterations; i++) {
+        fork_server_iteration(cpu, server);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("\n[PERSISTENT]: %lu executions in %.3f s, %.0f executions/s\n", server->iterations, seconds, server->iterations / seconds);
+    printf("[PERSISTENT]: %lu instructions, %lu timeouts, %lu crashes, %.1f restored pages per execution\n",
+           server->instructions, server->timeouts, server->crashes, (double)server->restored_pages / server->iterations);
+
+    fork_server_destroy(server);
+}
 
 int main(int argc, char **argv)
 {
     assert(argc > 1);
 
     CPU cpu = {0};
-    boot(&cpu);
+    cpu.io = port_io_create();
 
     u8 dump_out = 0;
+    char *sparse_dump_filename = NULL;
+    u64 dump_interval = 0;
+    u8 dump_rle = 0;
 
     char *input_filename = NULL;
+    char *gdb_address = NULL;
+    u8 record = 0;
+    u64 checkpoint_interval = 0;
+
+    char *save_state_filename = NULL;
+    char *load_state_filename = NULL;
+    char *shm_name = NULL;
+
+    u32 bench_machine_count = 0;
+
+    u64 persistent_iterations = 0;
+    u32 snapshot_at = MAX_MEMORY; // entry point
+    u32 iteration_end = FORK_SERVER_NO_END;
+    u64 iteration_limit = 0;
+
+    u64 fuzz_executions = 0;
+    u64 fuzz_seed = 0;
+    char *corpus_directory = NULL;
+    u32 fuzz_memory_address = 0;
+    u32 fuzz_memory_size = 0;
+
+    char *batch_manifest = NULL;
+    char *batch_report = BATCH_DEFAULT_REPORT;
+#ifdef _WIN32
+    u32 thread_count = 1; // the batch and the linear decode run on one thread there
+#else
+    u32 thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    char *cfg_json_filename = NULL;
+    char *cfg_dot_filename = NULL;
+    char *stream_filename = NULL;
+
+    u64 decoder_fuzz_cases = 0;
+    char *fuzz_python = DECODER_FUZZ_DEFAULT_PYTHON;
 
     for (int i = 0; i < argc; i++) {
         if (argv[i]) {
@@ -21,14 +203,217 @@ int main(int argc, char **argv)
                     dump_out = 1;
                 }
 
+                if (STR_EQUAL(argv[i], "--dump-sparse")) {
+                    assert(i+1 < argc);
+                    sparse_dump_filename = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--dump-every")) {
+                    assert(i+1 < argc);
+                    dump_interval = strtoull(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--dump-rle")) {
+                    dump_rle = 1;
+                }
+
+                if (STR_EQUAL(argv[i], "--heatmap")) {
+                    cpu.heatmap = heatmap_create();
+                }
+
+                if (STR_EQUAL(argv[i], "--profile")) {
+                    cpu.profiler = profiler_create();
+                }
+
+                if (STR_EQUAL(argv[i], "--port-out")) {
+                    assert(i+1 < argc);
+                    cpu.io->log_filename = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--port-in")) {
+                    assert(i+1 < argc);
+                    port_io_load_input(cpu.io, argv[++i]);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--record")) {
+                    record = 1;
+                }
+
+                if (STR_EQUAL(argv[i], "--checkpoint-interval")) {
+                    assert(i+1 < argc);
+                    checkpoint_interval = strtoull(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--save-state")) {
+                    assert(i+1 < argc);
+                    save_state_filename = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--load-state")) {
+                    assert(i+1 < argc);
+                    load_state_filename = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--shm")) {
+                    assert(i+1 < argc);
+                    shm_name = argv[++i];
+                    continue;
+                }
+
+                // Stop after this many instructions (counted from the boot, also for a loaded state), the
+                // state is saved there with --save-state
+                if (STR_EQUAL(argv[i], "--save-at")) {
+                    assert(i+1 < argc);
+                    cpu.max_instructions = strtoull(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--bench-machines")) {
+                    assert(i+1 < argc);
+                    bench_machine_count = strtoul(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--persistent")) {
+                    assert(i+1 < argc);
+                    persistent_iterations = strtoull(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--snapshot-at")) {
+                    assert(i+1 < argc);
+                    snapshot_at = strtoul(argv[++i], NULL, 16);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--iteration-end")) {
+                    assert(i+1 < argc);
+                    iteration_end = strtoul(argv[++i], NULL, 16);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--iteration-limit")) {
+                    assert(i+1 < argc);
+                    iteration_limit = strtoull(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--fuzz")) {
+                    assert(i+1 < argc);
+                    fuzz_executions = strtoull(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--corpus")) {
+                    assert(i+1 < argc);
+                    corpus_directory = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--fuzz-memory")) {
+                    assert(i+1 < argc);
+                    char *end = NULL;
+                    fuzz_memory_address = strtoul(argv[++i], &end, 16);
+                    assert(*end == ':');
+                    fuzz_memory_size = strtoul(end + 1, NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--fuzz-seed")) {
+                    assert(i+1 < argc);
+                    fuzz_seed = strtoull(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--fuzz-decoder")) {
+                    assert(i+1 < argc);
+                    decoder_fuzz_cases = strtoull(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--fuzz-python")) {
+                    assert(i+1 < argc);
+                    fuzz_python = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--batch")) {
+                    assert(i+1 < argc);
+                    batch_manifest = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--batch-report")) {
+                    assert(i+1 < argc);
+                    batch_report = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--threads")) {
+                    assert(i+1 < argc);
+                    thread_count = strtoul(argv[++i], NULL, 10);
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--quiet")) {
+                    cpu.quiet = 1;
+                }
+
+                if (STR_EQUAL(argv[i], "--no-micro-op-cache")) {
+                    cpu.no_micro_op_cache = 1;
+                }
+
+                if (STR_EQUAL(argv[i], "--gdb")) {
+                    assert(i+1 < argc);
+                    gdb_address = argv[++i];
+                    continue;
+                }
+
                 if (STR_EQUAL(argv[i], "--decode")) {
-                    cpu.decode_only = 1;
+                    cpu.decode_only = Decode_Recursive;
+                }
+
+                if (STR_EQUAL(argv[i], "--decode-linear")) {
+                    cpu.decode_only = Decode_Linear;
+                }
+
+                if (STR_EQUAL(argv[i], "--decode-stream")) {
+                    assert(i+1 < argc);
+                    stream_filename = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--decode-format")) {
+                    assert(i+1 < argc);
+                    Decode_Format format = Decode_Format_Text;
+                    if (!decode_format_parse(argv[++i], &format)) {
+                        return 1;
+                    }
+                    cpu.decode_format = format;
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--cfg")) {
+                    assert(i+1 < argc);
+                    cfg_json_filename = argv[++i];
+                    continue;
+                }
+
+                if (STR_EQUAL(argv[i], "--cfg-dot")) {
+                    assert(i+1 < argc);
+                    cfg_dot_filename = argv[++i];
+                    continue;
                 }
 
                 if (STR_EQUAL(argv[i], "--debug")) {
-                    // @Todo: The i8086/88 contains the debug flag so later we simulate this too
-                    // instead of this boolean
-                    cpu.debug_mode = 1;
+                    cpu.debugger = debugger_create();
                 }
             } else {
                 input_filename = argv[i];
@@ -37,18 +422,189 @@ int main(int argc, char **argv)
         }
     }
 
-    printf("\nbinary: %s\n\n", input_filename);
+    cpu.decode_threads = thread_count;
+
+    if (decoder_fuzz_cases) {
+        Decoder_Fuzzer *fuzzer = decoder_fuzzer_create(fuzz_python, fuzz_seed);
+        if (fuzzer == NULL) {
+            port_io_destroy(cpu.io);
+            return 1;
+        }
+        decoder_fuzzer_run(fuzzer, decoder_fuzz_cases);
+        decoder_fuzzer_destroy(fuzzer);
+        port_io_destroy(cpu.io);
+        return 0;
+    }
+
+    if (batch_manifest) {
+        run_batch(batch_manifest, batch_report, thread_count);
+        port_io_destroy(cpu.io);
+        return 0;
+    }
+
+    // Only the decoded instructions are printed, the output can be assembled again
+    if (stream_filename) {
+        FILE *fp = STR_EQUAL(stream_filename, "-") ? stdin : fopen(stream_filename, "rb");
+        if (fp == NULL) {
+            printf("\n[ERROR]: Failed to open %s for the decode.\n", stream_filename);
+        } else {
+            cpu.quiet = 1;
+            boot(&cpu);
+            disassembly_print_stream(&cpu, fp);
+            power_off(&cpu);
+
+            if (fp != stdin) {
+                fclose(fp);
+            }
+        }
+
+        port_io_destroy(cpu.io);
+        return 0;
+    }
+
+    // The machine readable decodes have nothing else on stdout
+    if (cpu.decode_only && cpu.decode_format != Decode_Format_Text) {
+        cpu.quiet = 1;
+    } else {
+        printf("\nbinary: %s\n\n", load_state_filename ? load_state_filename : input_filename);
+    }
+
+    if (record) {
+        cpu.replay = replay_create(checkpoint_interval);
+    }
+
+    if (cpu.profiler) {
+        profiler_attach(cpu.profiler, cpu.io);
+    }
 
-    cpu.out = fopen("./port.out", "w");
+    if (bench_machine_count) {
+        bench_machines(&cpu, input_filename, bench_machine_count);
+        port_io_destroy(cpu.io);
+        return 0;
+    }
+
+    if (shm_name) {
+        cpu.live_view = live_view_create(shm_name);
+    }
 
     boot(&cpu);
-    load_executable(&cpu, input_filename);
-    run(&cpu);
+    if (load_state_filename) {
+        snapshot_load(&cpu, load_state_filename);
+    } else {
+        load_executable(&cpu, input_filename);
+    }
+
+    if (gdb_address) {
+        if (cpu.debugger == NULL) {
+            cpu.debugger = debugger_create();
+        }
+        cpu.gdb = gdb_stub_create(gdb_address);
+        if (cpu.gdb == NULL) {
+            power_off(&cpu);
+            port_io_destroy(cpu.io);
+            return 1;
+        }
+    }
+
+    if (dump_interval && sparse_dump_filename == NULL) {
+        sparse_dump_filename = DUMP_DEFAULT_FILENAME;
+    }
+
+    if (sparse_dump_filename) {
+        cpu.dump = memory_dump_create(sparse_dump_filename, dump_interval, dump_rle);
+        if (cpu.dump && dump_interval) {
+            memory_dump_frame(&cpu, cpu.dump, 1);
+        }
+    }
+
+    if (snapshot_at == MAX_MEMORY) {
+        snapshot_at = calc_inst_pointer_address(&cpu);
+    }
+
+    if (cfg_json_filename || cfg_dot_filename) {
+        export_cfg(&cpu, cfg_json_filename, cfg_dot_filename);
+    } else if (fuzz_executions) {
+#ifndef FUZZ_ENABLED
+        printf("\n[WARNING]: Built without FUZZ_ENABLED, the fuzzer gets no coverage feedback (make fuzz).\n");
+#endif
+        Fuzzer *fuzzer = fuzzer_create(fuzz_seed);
+        if (fuzzer == NULL) {
+            power_off(&cpu);
+            port_io_destroy(cpu.io);
+            return 1;
+        }
+        fuzzer->memory_address = fuzz_memory_address;
+        fuzzer->memory_size = fuzz_memory_size;
+        if (corpus_directory) {
+            fuzzer_load_corpus(fuzzer, corpus_directory);
+        }
+
+        if (fork_server_run_to(&cpu, snapshot_at)) {
+            fuzzer_run(&cpu, fuzzer, fuzz_executions, iteration_end, iteration_limit);
+        }
+        fuzzer_destroy(fuzzer);
+    } else if (persistent_iterations) {
+        run_persistent(&cpu, persistent_iterations, snapshot_at, iteration_end, iteration_limit);
+    } else {
+        run(&cpu);
+    }
+
+    if (cpu.fault) {
+        printf("\n[ERROR]: The guest stopped at %#x: %s.\n", calc_inst_pointer_address(&cpu), cpu_fault_name(cpu.fault));
+    }
+
+    if (cpu.gdb) {
+        gdb_stub_exited(&cpu);
+        gdb_stub_destroy(cpu.gdb);
+    }
+
+    if (save_state_filename) {
+        snapshot_save(&cpu, save_state_filename);
+    }
 
     if (dump_out) {
-        FILE *fp = fopen("memory_dump.data", "w");
+        FILE *fp = fopen("memory_dump.data", "wb");
         assert(fp != NULL);
-        fwrite(cpu.memory, 1, 65556, fp);
+        fwrite(cpu.memory, 1, MAX_MEMORY, fp);
+        fclose(fp);
+    }
+
+    if (cpu.dump) {
+        // The periodic dumps only add the last written pages, the exit only one has everything
+        memory_dump_frame(&cpu, cpu.dump, cpu.dump->interval == 0);
+        printf("\n[DUMP]: %u frames, %lu pages, %lu bytes\n", cpu.dump->frames, cpu.dump->pages, cpu.dump->bytes);
+        memory_dump_destroy(cpu.dump);
+    }
+
+    if (cpu.live_view) {
+        live_view_publish(&cpu, Live_View_Exited);
+    }
+
+    power_off(&cpu);
+
+    if (cpu.live_view) {
+        live_view_destroy(cpu.live_view);
+    }
+
+    port_io_destroy(cpu.io);
+
+    if (cpu.debugger) {
+        debugger_destroy(cpu.debugger);
+    }
+
+    if (cpu.replay) {
+        replay_destroy(cpu.replay);
+    }
+
+    if (cpu.profiler) {
+        profiler_report(cpu.profiler, stdout);
+        profiler_destroy(cpu.profiler);
+    }
+
+    if (cpu.heatmap) {
+        heatmap_write_binary(cpu.heatmap, "heatmap.bin");
+        heatmap_write_image(cpu.heatmap, "heatmap.ppm");
+        heatmap_destroy(cpu.heatmap);
     }
 
     return 0;
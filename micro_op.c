@@ -0,0 +1,183 @@
+#include "micro_op.h"
+
+#define OPERAND_FLAG_BITS (Inst_Wide|Inst_Segment)
+
+// Stores the value of an operand into its 16 bit slot, returns 0 if it doesn't fit
+static u8 pack_value(Micro_Op *op, u32 index, s32 value)
+{
+    if (value >= -32768 && value <= 32767) {
+        op->values[index] = (s16)value;
+        return 1;
+    }
+
+    if (value >= 0 && value <= 0xFFFF) {
+        op->values[index] = (s16)(u16)value;
+        op->kinds |= MICRO_OP_UNSIGNED << (index * 4);
+        return 1;
+    }
+
+    return 0;
+}
+
+u8 micro_op_pack(Micro_Op *op, Instruction *instruction, u32 prefix_length)
+{
+    static_assert(sizeof(Micro_Op) == 16, "a micro-op is 16 bytes");
+
+    u32 length = prefix_length + instruction->size;
+    if (length > MICRO_OP_MAX_LENGTH || instruction->flags > 0xFF) {
+        return 0;
+    }
+
+    ZERO_MEMORY(op, sizeof(Micro_Op));
+    op->mnemonic = instruction->mnemonic;
+    op->type = instruction->type;
+    op->flags = instruction->flags;
+    op->segment = instruction->extend_with_this_segment;
+    op->length = length;
+    op->prefix_length = prefix_length;
+
+    for (u32 i = 0; i < 2; i++) {
+        Instruction_Operand *operand = &instruction->operands[i];
+
+        if (operand->flags & ~OPERAND_FLAG_BITS) {
+            return 0;
+        }
+
+        op->kinds |= operand->type << (i * 4);
+        op->operand_flags |= operand->flags << (i * 2);
+
+        switch (operand->type) {
+            case Operand_Register: {
+                op->slots[i] = operand->reg;
+                break;
+            }
+            case Operand_Memory: {
+                op->slots[i] = operand->address.base;
+                op->far_segment = operand->address.segment;
+                if (!pack_value(op, i, operand->address.displacement)) {
+                    return 0;
+                }
+                break;
+            }
+            case Operand_Immediate:
+            case Operand_Relative_Immediate: {
+                if (!pack_value(op, i, operand->immediate)) {
+                    return 0;
+                }
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+
+    return 1;
+}
+
+void micro_op_unpack(Instruction *instruction, const Micro_Op *op, u32 address)
+{
+    ZERO_MEMORY(instruction, sizeof(Instruction));
+
+    instruction->mem_address = address + op->prefix_length;
+    instruction->size = op->length - op->prefix_length;
+    instruction->mnemonic = op->mnemonic;
+    instruction->type = op->type;
+    instruction->flags = op->flags;
+    instruction->extend_with_this_segment = op->segment;
+
+    for (u32 i = 0; i < 2; i++) {
+        Instruction_Operand *operand = &instruction->operands[i];
+        u32 kind = MICRO_OP_KIND(op, i);
+        s32 value = (kind & MICRO_OP_UNSIGNED) ? (u16)op->values[i] : op->values[i];
+
+        operand->type = kind & ~MICRO_OP_UNSIGNED;
+        operand->flags = (op->operand_flags >> (i * 2)) & OPERAND_FLAG_BITS;
+
+        switch (operand->type) {
+            case Operand_Register: {
+                operand->reg = op->slots[i];
+                break;
+            }
+            case Operand_Memory: {
+                operand->address.base = op->slots[i];
+                operand->address.segment = op->far_segment;
+                operand->address.displacement = value;
+                break;
+            }
+            case Operand_Immediate:
+            case Operand_Relative_Immediate: {
+                operand->immediate = value;
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+}
+
+Micro_Op_Cache *micro_op_cache_create(void)
+{
+    Micro_Op_Cache *cache = ALLOC_MEMORY(Micro_Op_Cache);
+    assert(cache != NULL);
+
+    memset(cache->addresses, 0xFF, sizeof(cache->addresses));
+    return cache;
+}
+
+void micro_op_cache_destroy(Micro_Op_Cache *cache)
+{
+    free(cache);
+}
+
+void micro_op_cache_flush(CPU *cpu)
+{
+    memset(cpu->micro_ops->addresses, 0xFF, sizeof(cpu->micro_ops->addresses));
+
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        cpu->page_flags[page] &= ~Page_Decoded;
+    }
+}
+
+void micro_op_cache_store(CPU *cpu, u32 address)
+{
+    Micro_Op_Cache *cache = cpu->micro_ops;
+    u32 slot = address & (MICRO_OP_CACHE_SIZE - 1);
+    u32 prefix_length = (cpu->instruction.mem_address - address) & (MAX_MEMORY - 1);
+
+    if (!micro_op_pack(&cache->ops[slot], &cpu->instruction, prefix_length)) {
+        cache->addresses[slot] = MICRO_OP_NO_ADDRESS;
+        return;
+    }
+    cache->addresses[slot] = address;
+
+    // The writes to these pages have to find the instruction
+    u32 last = address + cache->ops[slot].length - 1;
+    cpu->page_flags[(address >> MEMORY_PAGE_SHIFT) & (MEMORY_PAGE_COUNT - 1)] |= Page_Decoded;
+    cpu->page_flags[(last >> MEMORY_PAGE_SHIFT) & (MEMORY_PAGE_COUNT - 1)] |= Page_Decoded;
+}
+
+void micro_op_cache_invalidate(CPU *cpu, u32 address, u32 size)
+{
+    Micro_Op_Cache *cache = cpu->micro_ops;
+    if (cache == NULL) {
+        return;
+    }
+
+    if (size >= MICRO_OP_CACHE_SIZE) {
+        micro_op_cache_flush(cpu);
+        return;
+    }
+
+    // A cached instruction with a byte in the range starts at most MICRO_OP_MAX_LENGTH - 1 bytes before it
+    u32 first = address - (MICRO_OP_MAX_LENGTH - 1);
+    for (u32 i = 0; i < size + MICRO_OP_MAX_LENGTH - 1; i++) {
+        u32 start = (first + i) & (MAX_MEMORY - 1);
+        u32 slot = start & (MICRO_OP_CACHE_SIZE - 1);
+
+        if (cache->addresses[slot] == start) {
+            cache->addresses[slot] = MICRO_OP_NO_ADDRESS;
+        }
+    }
+}
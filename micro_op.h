@@ -0,0 +1,62 @@
+#ifndef _H_MICRO_OP
+#define _H_MICRO_OP
+
+#include "sim86.h"
+
+// The compact form of a decoded instruction and the cache of them by address. The decoder
+// walks the opcode tables and compares operand spec strings, the Instruction it fills is
+// 72 bytes. An executed instruction is decoded once and packed into a 16 byte Micro_Op.
+// The register and immediate forms of mov, add, sub, cmp, inc, dec, the jumps and loop run
+// straight from it (execute_micro_op() in simulator.c), the rest is unpacked into the
+// Instruction for execute_instruction().
+//
+// Every guest write goes through mark_memory_dirty(), it drops the cached instructions it
+// overlaps, the self-modifying code is decoded again.
+
+#define MICRO_OP_MAX_LENGTH 16       // longer instructions (a run of prefixes) are never cached
+#define MICRO_OP_CACHE_SIZE (8*1024) // direct mapped by the linear address, a power of two
+#define MICRO_OP_NO_ADDRESS 0xFFFFFFFF
+
+// The low nibble of the kinds is the Operand_Type of the operand, MICRO_OP_UNSIGNED marks
+// a value which is a 16 bit unsigned number (a direct address) instead of a signed one
+#define MICRO_OP_UNSIGNED (1 << 3)
+#define MICRO_OP_KIND(_op, _index) (((_op)->kinds >> ((_index) * 4)) & 0xF)
+
+typedef struct {
+    u8 mnemonic;      // Mneumonic, the case of execute_instruction()
+    u8 type;          // Instruction_Type
+    u8 flags;         // Instruction_Flag
+    u8 segment;       // Register of the segment prefix, Register_none without one
+    u8 length;        // with the prefixes
+    u8 prefix_length;
+    u8 kinds;         // the operand kinds, operand 0 in the low nibble
+    u8 operand_flags; // Inst_Wide and Inst_Segment of the operands, operand 0 in the low two bits
+    u8 slots[2];      // the register of a register operand, the Effective_Address_Base of a memory one
+    u16 far_segment;  // the segment of a direct far pointer (jmp 61440:256)
+    s16 values[2];    // the displacement of a memory operand, the immediate of the rest
+} Micro_Op;
+
+typedef struct Micro_Op_Cache {
+    u32 addresses[MICRO_OP_CACHE_SIZE]; // the first prefix of the cached instruction, MICRO_OP_NO_ADDRESS if empty
+    Micro_Op ops[MICRO_OP_CACHE_SIZE];
+} Micro_Op_Cache;
+
+// Returns 0 if the instruction doesn't fit into a Micro_Op
+u8 micro_op_pack(Micro_Op *op, Instruction *instruction, u32 prefix_length);
+// Fills the whole instruction like decode_next_instruction() did, address is the first prefix
+void micro_op_unpack(Instruction *instruction, const Micro_Op *op, u32 address);
+
+Micro_Op_Cache *micro_op_cache_create(void);
+void micro_op_cache_destroy(Micro_Op_Cache *cache);
+void micro_op_cache_flush(CPU *cpu);
+
+// The instruction at the linear address, NULL if it isn't cached
+static inline const Micro_Op *micro_op_cache_lookup(Micro_Op_Cache *cache, u32 address)
+{
+    u32 slot = address & (MICRO_OP_CACHE_SIZE - 1);
+    return cache->addresses[slot] == address ? &cache->ops[slot] : NULL;
+}
+// Caches cpu->instruction, just decoded from the address with its prefixes
+void micro_op_cache_store(CPU *cpu, u32 address);
+
+#endif
@@ -0,0 +1,127 @@
+#include "port_io.h"
+
+// The default handlers don't use their user data, so they can be mixed with a device's own callback
+static void port_log_write(CPU *cpu, void *user, u16 port, u16 data, u8 wide)
+{
+    Port_Io *io = cpu->io;
+
+    // Allocated at the first out, most machines with their own handlers never log
+    if (io->log_buffer == NULL) {
+        io->log_buffer = (u8 *)malloc(PORT_LOG_BUFFER_SIZE);
+        assert(io->log_buffer != NULL);
+    }
+
+    if (io->log_used + sizeof(Port_Log_Record) > PORT_LOG_BUFFER_SIZE) {
+        port_io_flush(io);
+    }
+
+    Port_Log_Record *record = (Port_Log_Record *)(io->log_buffer + io->log_used);
+    record->port = port;
+    record->data = wide ? data : (data & 0xFF);
+
+    io->log_used += sizeof(Port_Log_Record);
+}
+
+static u16 port_input_read(CPU *cpu, void *user, u16 port, u8 wide)
+{
+    Port_Io *io = cpu->io;
+
+    u32 size = wide ? 2 : 1;
+    if (io->input_cursor + size > io->input_size) {
+        return wide ? PORT_OPEN_BUS : (PORT_OPEN_BUS & 0xFF);
+    }
+
+    u16 data = io->input[io->input_cursor];
+    if (wide) {
+        data = BYTE_LOHI_TO_HILO(data, io->input[io->input_cursor+1]);
+    }
+    io->input_cursor += size;
+
+    return data;
+}
+
+Port_Io *port_io_create(void)
+{
+    Port_Io *io = (Port_Io *)calloc(1, sizeof(Port_Io));
+    assert(io != NULL);
+
+    io->log_filename = PORT_LOG_DEFAULT_FILENAME;
+
+    // handler_index is zeroed, so every port points to the default handler
+    io->handlers[0] = (Port_Handler){.write = port_log_write, .read = port_input_read, .user = NULL};
+    io->handler_count = 1;
+
+    return io;
+}
+
+void port_io_destroy(Port_Io *io)
+{
+    port_io_flush(io);
+
+    if (io->log_file) {
+        fclose(io->log_file);
+    }
+
+    free(io->log_buffer);
+    free(io->input);
+    free(io);
+}
+
+void port_io_set_handler(Port_Io *io, u16 first_port, u16 last_port, Port_Write_Handler write, Port_Read_Handler read, void *user)
+{
+    assert(first_port <= last_port);
+    assert(io->handler_count < PORT_MAX_HANDLERS);
+
+    // A NULL callback falls back to the default one, so a device can handle only one direction
+    Port_Handler *handler = &io->handlers[io->handler_count];
+    handler->write = write ? write : port_log_write;
+    handler->read  = read  ? read  : port_input_read;
+    handler->user  = user;
+
+    for (u32 port = first_port; port <= last_port; port++) {
+        io->handler_index[port] = io->handler_count;
+    }
+
+    io->handler_count++;
+}
+
+void port_io_load_input(Port_Io *io, const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        printf("\n[ERROR]: Failed to open %s port input file.\n", filename);
+        assert(0);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    u32 fsize = ftell(fp);
+    rewind(fp);
+
+    free(io->input);
+    io->input = (u8 *)malloc(fsize ? fsize : 1);
+    assert(io->input != NULL);
+
+    io->input_size = fread(io->input, 1, fsize, fp);
+    io->input_cursor = 0;
+
+    fclose(fp);
+}
+
+void port_io_flush(Port_Io *io)
+{
+    if (io->log_used == 0) {
+        return;
+    }
+
+    if (io->log_file == NULL) {
+        io->log_file = fopen(io->log_filename, "wb");
+        if (io->log_file == NULL) {
+            printf("\n[ERROR]: Failed to open %s for the port log.\n", io->log_filename);
+            io->log_used = 0;
+            return;
+        }
+    }
+
+    fwrite(io->log_buffer, 1, io->log_used, io->log_file);
+    io->log_used = 0;
+}
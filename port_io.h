@@ -0,0 +1,71 @@
+#ifndef _H_PORT_IO
+#define _H_PORT_IO
+
+#include "sim86.h"
+
+#define PORT_COUNT 0x10000
+#define PORT_MAX_HANDLERS 256 // the 0th is always the default handler
+
+// The default handler appends every out into this buffer and only writes it out when
+// it is full (or at exit), so a port heavy guest costs one fwrite per megabyte.
+#define PORT_LOG_BUFFER_SIZE (1024 * 1024)
+#define PORT_LOG_DEFAULT_FILENAME "./port.out"
+
+// The log file is the raw array of these, native endian. The data is zero extended
+// if it came from a byte sized out.
+typedef struct {
+    u16 port;
+    u16 data;
+} Port_Log_Record;
+
+// If the input stream is exhausted the port reads back as an open bus.
+#define PORT_OPEN_BUS 0xFFFF
+
+typedef void (*Port_Write_Handler)(CPU *cpu, void *user, u16 port, u16 data, u8 wide);
+typedef u16 (*Port_Read_Handler)(CPU *cpu, void *user, u16 port, u8 wide);
+
+typedef struct {
+    Port_Write_Handler write;
+    Port_Read_Handler read;
+    void *user;
+} Port_Handler;
+
+struct Port_Io {
+    u8 handler_index[PORT_COUNT];
+    Port_Handler handlers[PORT_MAX_HANDLERS];
+    u32 handler_count;
+
+    // Default output: buffered binary log
+    const char *log_filename; // opened lazily at the first flush
+    FILE *log_file;
+    u8 *log_buffer; // NULL until the first out
+    u32 log_used;
+
+    // Default input: the whole stream is loaded up front
+    u8 *input;
+    u32 input_size;
+    u32 input_cursor;
+};
+
+Port_Io *port_io_create(void);
+void port_io_destroy(Port_Io *io);
+
+void port_io_set_handler(Port_Io *io, u16 first_port, u16 last_port, Port_Write_Handler write, Port_Read_Handler read, void *user);
+void port_io_load_input(Port_Io *io, const char *filename);
+void port_io_flush(Port_Io *io);
+
+static inline void port_write(CPU *cpu, u16 port, u16 data, u8 wide)
+{
+    Port_Io *io = cpu->io;
+    Port_Handler *handler = &io->handlers[io->handler_index[port]];
+    handler->write(cpu, handler->user, port, data, wide);
+}
+
+static inline u16 port_read(CPU *cpu, u16 port, u8 wide)
+{
+    Port_Io *io = cpu->io;
+    Port_Handler *handler = &io->handlers[io->handler_index[port]];
+    return handler->read(cpu, handler->user, port, wide);
+}
+
+#endif
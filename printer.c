@@ -1,134 +1,13 @@
 #include "printer.h"
 
-// @Todo: Remove the reg param
 const char *mnemonic_name(Mneumonic m)
 {
-    static const char *mnemonic_name_lookup[] = {
-        [Mneumonic_mov]     = "mov",
-        [Mneumonic_add]     = "add",
-        [Mneumonic_adc]     = "adc",
-        [Mneumonic_inc]     = "inc",
-        [Mneumonic_dec]     = "dec",
-        [Mneumonic_sub]     = "sub",
-        [Mneumonic_cmp]     = "cmp",
-        [Mneumonic_and]     = "and",
-        [Mneumonic_aaa]     = "aaa",
-        [Mneumonic_aad]     = "aad",
-        [Mneumonic_aas]     = "aas",
-        [Mneumonic_das]     = "das",
-        [Mneumonic_daa]     = "daa",
-        [Mneumonic_aam]     = "aam",
-        [Mneumonic_sbb]     = "sbb",
-
-        [Mneumonic_test]    = "test",
-        [Mneumonic_or]      = "or",
-        [Mneumonic_xor]     = "xor",
-
-        [Mneumonic_movsw]   = "movsw",
-        [Mneumonic_movsb]   = "movsb",
-        [Mneumonic_cmpsb]   = "cmpsb",
-        [Mneumonic_scasb]   = "scasb",
-        [Mneumonic_lodsb]   = "lodsb",
-        [Mneumonic_cmpsw]   = "cmpsw",
-        [Mneumonic_scasw]   = "scasw",
-        [Mneumonic_lodsw]   = "lodsw",
-        [Mneumonic_stosb]   = "stosb",
-        [Mneumonic_stosw]   = "stosw",
-        [Mneumonic_int]     = "int",
-        [Mneumonic_into]    = "into",
-        [Mneumonic_iret]    = "iret",
-        [Mneumonic_clc]     = "clc",
-        [Mneumonic_cmc]     = "cmc",
-        [Mneumonic_stc]     = "stc",
-        [Mneumonic_cld]     = "cld",
-        [Mneumonic_std]     = "std",
-        [Mneumonic_cli]     = "cli",
-        [Mneumonic_sti]     = "sti",
-        [Mneumonic_hlt]     = "hlt",
-        [Mneumonic_wait]    = "wait",
-        [Mneumonic_cbw]     = "cbw",
-        [Mneumonic_cwd]     = "cwd",
-        [Mneumonic_ret]     = "ret",
-        [Mneumonic_retf]    = "retf",
-        [Mneumonic_call]    = "call",
-        [Mneumonic_push]    = "push",
-        [Mneumonic_pop]     = "pop",
-        [Mneumonic_popf]    = "popf",
-        [Mneumonic_lahf]    = "lahf",
-        [Mneumonic_sahf]    = "sahf",
-        [Mneumonic_pushf]   = "pushf",
-        [Mneumonic_xchg]    = "xchg",
-        [Mneumonic_nop]     = "nop",
-        [Mneumonic_xlat]    = "xlat",
-        [Mneumonic_in]      = "in",
-        [Mneumonic_out]     = "out",
-        [Mneumonic_lea]     = "lea",
-        [Mneumonic_lds]     = "lds",
-        [Mneumonic_les]     = "les",
-        [Mneumonic_jmp]     = "jmp",
-        [Mneumonic_jz]      = "jz",
-        [Mneumonic_jnz]     = "jnz",
-        [Mneumonic_jl]      = "jl",
-        [Mneumonic_jle]     = "jle",
-        [Mneumonic_jb]      = "jb",
-        [Mneumonic_jbe]     = "jbe",
-        [Mneumonic_jp]      = "jp",
-        [Mneumonic_jo]      = "jo",
-        [Mneumonic_js]      = "js",
-        [Mneumonic_jnl]     = "jnl",
-        [Mneumonic_jg]      = "jg",
-        [Mneumonic_jnb]     = "jnb",
-        [Mneumonic_ja]      = "ja",
-        [Mneumonic_jnp]     = "jnp",
-        [Mneumonic_jno]     = "jno",
-        [Mneumonic_jns]     = "jns",
-        [Mneumonic_loop]    = "loop",
-        [Mneumonic_loopz]   = "loopz",
-        [Mneumonic_loopnz]  = "loopnz",
-        [Mneumonic_jcxz]    = "jcxz",
-
-        [Mneumonic_rol]     = "rol",
-        [Mneumonic_ror]     = "ror",
-        [Mneumonic_rcl]     = "rcl",
-        [Mneumonic_rcr]     = "rcr",
-        [Mneumonic_shl]     = "shl",
-        [Mneumonic_shr]     = "shr",
-        [Mneumonic_sar]     = "sar",
-        [Mneumonic_not]     = "not",
-        [Mneumonic_neg]     = "neg",
-        [Mneumonic_mul]     = "mul",
-        [Mneumonic_imul]    = "imul",
-        [Mneumonic_div]     = "div",
-        [Mneumonic_idiv]    = "idiv",
-
-        // DB (define-byte) pseudo-instruction
-        [Mneumonic_db]      = "db",
-
-        // Prefixes
-        [Mneumonic_repz]    = "repz",
-        [Mneumonic_repnz]   = "repnz",
-        [Mneumonic_lock]    = "lock",
-        [Mneumonic_cs]      = "cs", // segment register
-        [Mneumonic_ds]      = "ds", // segment register
-        [Mneumonic_es]      = "es", // segment register
-        [Mneumonic_ss]      = "ss", // segment register
-
-        [Mneumonic_invalid] = "???",
-
-        [Mneumonic_grp1]    = "grp1",
-        [Mneumonic_grp2]    = "grp2",
-        [Mneumonic_grp3a]   = "grp3a",
-        [Mneumonic_grp3b]   = "grp3b",
-        [Mneumonic_grp4]    = "grp4",
-        [Mneumonic_grp5]    = "grp5"
-    };
-
-    if (mnemonic_name_lookup[m] == NULL) {
+    if (m >= Mneumonic_count || i8086_mnemonic_names[m] == NULL) {
         printf("[WARNING]: mneumonic not handled: %d\n", m);
         assert(0);
     }
 
-    return mnemonic_name_lookup[m];
+    return i8086_mnemonic_names[m];
 }
 
 const char *register_name(Register reg)
@@ -187,17 +66,65 @@ void print_out_formated_flags(u16 old_flags, u16 new_flags)
     printf(" ]");
 }
 
-void print_instruction(CPU *cpu, u8 with_end_line)
+const char *effective_address_name(Effective_Address_Base base)
+{
+    static const char *r_m_base[] = {"","bx+si","bx+di","bp+si","bp+di","si","di","bp","bx"};
+    return r_m_base[base];
+}
+
+// The formatters write without a terminating zero and return the end of the text
+char *append_string(char *dest, const char *text)
+{
+    while (*text) {
+        *dest++ = *text++;
+    }
+    return dest;
+}
+
+// %d, or %+d with always_sign
+char *append_decimal(char *dest, s32 value, u8 always_sign)
 {
-    FILE *dest = stdout;
+    if (value < 0) {
+        *dest++ = '-';
+    } else if (always_sign) {
+        *dest++ = '+';
+    }
+
+    u32 magnitude = value < 0 ? -(u32)value : (u32)value;
+
+    char digits[10];
+    u32 count = 0;
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    while (count) {
+        *dest++ = digits[--count];
+    }
+    return dest;
+}
 
-    Instruction *instruction = &cpu->instruction;
+// %08X
+char *append_address(char *dest, u32 address)
+{
+    static const char hex_digits[] = "0123456789ABCDEF";
+    for (s32 shift = 28; shift >= 0; shift -= 4) {
+        *dest++ = hex_digits[(address >> shift) & 0xF];
+    }
+    return dest;
+}
 
-    fprintf(dest, "%08X\t", instruction->mem_address);
-    fprintf(dest, "%s", mnemonic_name(instruction->mnemonic));
+u32 format_instruction(char *dest, Instruction *instruction, u8 with_end_line)
+{
+    char *cursor = dest;
+
+    cursor = append_address(cursor, instruction->mem_address);
+    *cursor++ = '\t';
+    cursor = append_string(cursor, mnemonic_name(instruction->mnemonic));
 
     if (instruction->flags & Inst_Lock) {
-        fprintf(dest, "lock ");
+        cursor = append_string(cursor, "lock ");
     }
 
     const char *separator = " ";
@@ -207,7 +134,7 @@ void print_instruction(CPU *cpu, u8 with_end_line)
             continue;
         }
 
-        fprintf(dest, "%s", separator);
+        cursor = append_string(cursor, separator);
         separator = ", ";
 
         switch (op->type) {
@@ -218,50 +145,54 @@ void print_instruction(CPU *cpu, u8 with_end_line)
                 Register_Access *reg_access = register_access(op->reg, op->flags);
                 Register reg_enum = reg_access->reg;
 
-                fprintf(dest, "%s", register_name(reg_enum));
+                cursor = append_string(cursor, register_name(reg_enum));
 
                 break;
             }
             case Operand_Memory: {
                 // @Cleanup:
                 if (&instruction->operands[0] == op && !(instruction->flags & Inst_Far)) {
-                    fprintf(dest, "%s ", (instruction->flags & Inst_Wide) ? "word" : "byte");
+                    cursor = append_string(cursor, (instruction->flags & Inst_Wide) ? "word " : "byte ");
                 }
 
                 // @Todo: CleanUp
                 if (instruction->flags & Inst_Segment) {
                     if (instruction->extend_with_this_segment != Register_none) {
                         // segment prefix
-                        fprintf(dest, "%s:", register_name(instruction->extend_with_this_segment));
+                        cursor = append_string(cursor, register_name(instruction->extend_with_this_segment));
+                        *cursor++ = ':';
                     } else {
                         // segment at direct address
                         u16 segment = op->address.segment;
                         u16 offset = op->address.displacement;
-                        fprintf(dest, "%d:%d", segment, offset);
+                        cursor = append_decimal(cursor, segment, 0);
+                        *cursor++ = ':';
+                        cursor = append_decimal(cursor, offset, 0);
                         break;
                     }
                 }
 
                 if (&instruction->operands[0] == op && instruction->flags & Inst_Far) {
-                    fprintf(dest, "far ");
+                    cursor = append_string(cursor, "far ");
                 }
 
-                char const *r_m_base[] = {"","bx+si","bx+di","bp+si","bp+di","si","di","bp","bx"};
-                fprintf(dest, "[%s", r_m_base[op->address.base]);
+                *cursor++ = '[';
+                cursor = append_string(cursor, effective_address_name(op->address.base));
                 if (op->address.displacement) {
-                    fprintf(dest, "%+d", op->address.displacement);
+                    cursor = append_decimal(cursor, op->address.displacement, 1);
                 }
-                fprintf(dest, "]");
+                *cursor++ = ']';
 
                 break;
             }
             case Operand_Immediate: {
-                fprintf(dest, "%d", op->immediate);
+                cursor = append_decimal(cursor, op->immediate, 0);
 
                 break;
             }
             case Operand_Relative_Immediate: {
-                fprintf(dest, "$%+d", op->immediate+instruction->size);
+                *cursor++ = '$';
+                cursor = append_decimal(cursor, op->immediate+instruction->size, 1);
 
                 break;
             }
@@ -273,7 +204,45 @@ void print_instruction(CPU *cpu, u8 with_end_line)
     }
 
     if (with_end_line) {
-        fprintf(dest, "\n");
+        *cursor++ = '\n';
+    }
+
+    assert(cursor - dest <= INSTRUCTION_TEXT_MAX);
+    return cursor - dest;
+}
+
+u32 format_data(char *dest, u32 address, const u8 *bytes, u32 count)
+{
+    assert(count <= FORMAT_DATA_MAX_BYTES);
+
+    char *cursor = dest;
+
+    cursor = append_address(cursor, address);
+    cursor = append_string(cursor, "\tdb ");
+    for (u32 i = 0; i < count; i++) {
+        if (i) {
+            cursor = append_string(cursor, ", ");
+        }
+        cursor = append_decimal(cursor, bytes[i], 0);
     }
+    *cursor++ = '\n';
 
+    return cursor - dest;
+}
+
+void print_instruction(CPU *cpu, u8 with_end_line)
+{
+    fprint_instruction(stdout, &cpu->instruction, with_end_line);
+}
+
+void fprint_instruction(FILE *dest, Instruction *instruction, u8 with_end_line)
+{
+    char text[INSTRUCTION_TEXT_MAX];
+    fwrite(text, 1, format_instruction(text, instruction, with_end_line), dest);
+}
+
+void write_instruction(Text_Writer *writer, Instruction *instruction)
+{
+    char *dest = text_writer_reserve(writer, INSTRUCTION_TEXT_MAX);
+    text_writer_commit(writer, format_instruction(dest, instruction, 1));
 }
@@ -2,14 +2,34 @@
 #define _H_PRINTER
 
 #include "sim86.h"
+#include "text_writer.h"
+
+// The longest formatted instruction with its end of line, the far jumps and the two memory
+// operands with a segment prefix and a displacement stay well below
+#define INSTRUCTION_TEXT_MAX 128
+#define FORMAT_DATA_MAX_BYTES 16 // a db line fits into INSTRUCTION_TEXT_MAX too
 
 const char *mnemonic_name(Mneumonic m);
 const char *register_name(Register reg);
+const char *effective_address_name(Effective_Address_Base base); // "bx+si", "" for the direct address
+
+// Building blocks of the formatters, they return the end of the text and add no terminating zero
+char *append_string(char *dest, const char *text);
+char *append_decimal(char *dest, s32 value, u8 always_sign); // %d, %+d with always_sign
+char *append_address(char *dest, u32 address);               // %08X
 
 void print_flags(u16 flags);
 void print_out_formated_flags(u16 old_flags, u16 new_flags);
 
+// Renders into dest (INSTRUCTION_TEXT_MAX bytes), without stdio and without a terminating zero,
+// returns the length
+u32 format_instruction(char *dest, Instruction *instruction, u8 with_end_line);
+// A db line of count <= FORMAT_DATA_MAX_BYTES bytes
+u32 format_data(char *dest, u32 address, const u8 *bytes, u32 count);
+
 void print_instruction(CPU *cpu, u8 with_end_line);
+void fprint_instruction(FILE *dest, Instruction *instruction, u8 with_end_line);
+void write_instruction(Text_Writer *writer, Instruction *instruction);
 
 /*
 static void int_to_bin_str(u64 val, u8 size)
@@ -0,0 +1,300 @@
+#include "profiler.h"
+#include "printer.h"
+#include "port_io.h"
+#include "replay.h"
+
+Profiler *profiler_create(void)
+{
+    Profiler *profiler = (Profiler *)calloc(1, sizeof(Profiler));
+    assert(profiler != NULL);
+
+    return profiler;
+}
+
+void profiler_destroy(Profiler *profiler)
+{
+    free(profiler->markers);
+    free(profiler);
+}
+
+static void stats_accumulate(Cpu_Stats *total, Cpu_Stats *start, Cpu_Stats *end)
+{
+    total->instructions  += end->instructions  - start->instructions;
+    total->cycles        += end->cycles        - start->cycles;
+    total->memory_reads  += end->memory_reads  - start->memory_reads;
+    total->memory_writes += end->memory_writes - start->memory_writes;
+}
+
+static void profiler_port_write(CPU *cpu, void *user, u16 port, u16 data, u8 wide)
+{
+    Profiler *profiler = (Profiler *)user;
+    Profiler_Region *region = &profiler->regions[data % PROFILER_MAX_REGIONS];
+
+    // The regions and the markers of the replayed history are already counted
+    if (!replay_is_live(cpu)) {
+        return;
+    }
+
+    switch (port) {
+        case PROFILER_PORT_BEGIN: {
+            if (region->name[0] == '\0' && profiler->pending_name_length) {
+                memcpy(region->name, profiler->pending_name, sizeof(region->name));
+            }
+            ZERO_MEMORY(profiler->pending_name, sizeof(profiler->pending_name));
+            profiler->pending_name_length = 0;
+            profiler->pending_name_terminated = 0;
+
+            if (region->depth++ == 0) {
+                region->start = cpu->stats;
+            }
+
+            break;
+        }
+        case PROFILER_PORT_END: {
+            if (region->depth == 0) {
+                printf("\n[WARNING]: Profiler region %d ended without begin!\n", data);
+                break;
+            }
+
+            if (--region->depth == 0) {
+                stats_accumulate(&region->total, &region->start, &cpu->stats);
+                region->hits++;
+            }
+
+            break;
+        }
+        case PROFILER_PORT_MARKER: {
+            if (profiler->marker_count == profiler->marker_capacity) {
+                profiler->marker_capacity = profiler->marker_capacity ? profiler->marker_capacity * 2 : 64;
+                profiler->markers = (Profiler_Marker *)realloc(profiler->markers, profiler->marker_capacity * sizeof(Profiler_Marker));
+                assert(profiler->markers != NULL);
+            }
+
+            Profiler_Marker *marker = &profiler->markers[profiler->marker_count++];
+            marker->value = data;
+            marker->address = cpu->instruction.mem_address;
+            marker->stats = cpu->stats;
+
+            break;
+        }
+        case PROFILER_PORT_NAME: {
+            char c = data & 0xFF;
+            // The last byte is always reserved for the terminator
+            if (c == '\0') {
+                profiler->pending_name_terminated = 1;
+            } else if (!profiler->pending_name_terminated && profiler->pending_name_length < PROFILER_NAME_LENGTH-1) {
+                profiler->pending_name[profiler->pending_name_length++] = c;
+            }
+
+            break;
+        }
+        default: {
+            assert(0);
+        }
+    }
+}
+
+void profiler_attach(Profiler *profiler, Port_Io *io)
+{
+    port_io_set_handler(io, PROFILER_PORT_FIRST, PROFILER_PORT_LAST, profiler_port_write, NULL, profiler);
+}
+
+void profiler_report(Profiler *profiler, FILE *dest)
+{
+    fprintf(dest, "\n[PROFILE] regions:\n");
+    fprintf(dest, "%4s %-32s %10s %14s %14s %12s %12s\n", "id", "name", "hits", "instructions", "cycles", "mem reads", "mem writes");
+
+    for (u32 id = 0; id < PROFILER_MAX_REGIONS; id++) {
+        Profiler_Region *region = &profiler->regions[id];
+        if (region->hits == 0 && region->depth == 0) {
+            continue;
+        }
+
+        if (region->depth) {
+            fprintf(dest, "[WARNING]: Region %d is still open, its last run is not counted!\n", id);
+        }
+
+        fprintf(dest, "%4d %-32s %10lu %14lu %14lu %12lu %12lu\n", id, region->name[0] ? region->name : "-",
+                region->hits, region->total.instructions, region->total.cycles,
+                region->total.memory_reads, region->total.memory_writes);
+    }
+
+    if (profiler->marker_count) {
+        fprintf(dest, "\n[PROFILE] markers:\n");
+        fprintf(dest, "%6s %10s %14s %14s %12s %12s\n", "value", "address", "instructions", "cycles", "mem reads", "mem writes");
+    }
+
+    for (u32 i = 0; i < profiler->marker_count; i++) {
+        Profiler_Marker *marker = &profiler->markers[i];
+        fprintf(dest, "%6d   %08X %14lu %14lu %12lu %12lu\n", marker->value, marker->address,
+                marker->stats.instructions, marker->stats.cycles,
+                marker->stats.memory_reads, marker->stats.memory_writes);
+    }
+}
+
+// Effective address calculation time from the 8086 manual
+static u32 effective_address_cycles(Instruction *inst, Instruction_Operand *op)
+{
+    u8 has_displacement = op->address.displacement != 0;
+    u32 cycles = 0;
+
+    switch (op->address.base) {
+        case Effective_Address_direct: cycles = 6; break;
+        case Effective_Address_si:
+        case Effective_Address_di:
+        case Effective_Address_bp:
+        case Effective_Address_bx:      cycles = has_displacement ? 9 : 5; break;
+        case Effective_Address_bp_di:
+        case Effective_Address_bx_si:   cycles = has_displacement ? 11 : 7; break;
+        case Effective_Address_bp_si:
+        case Effective_Address_bx_di:   cycles = has_displacement ? 12 : 8; break;
+    }
+
+    if (inst->extend_with_this_segment != Register_none) {
+        cycles += 2;
+    }
+
+    return cycles;
+}
+
+// Approximation of the i8086 timings, good enough to compare routines with each other.
+// The odd address word access penalty and the prefetch queue are not modelled.
+u32 instruction_cycles(Instruction *inst, u8 branch_taken, u16 repetitions)
+{
+    Instruction_Operand *left  = &inst->operands[0];
+    Instruction_Operand *right = &inst->operands[1];
+
+    u8 left_mem  = left->type == Operand_Memory;
+    u8 right_mem = right->type == Operand_Memory;
+    u8 right_imm = right->type == Operand_Immediate;
+
+    u32 ea = 0;
+    if (left_mem)  ea = effective_address_cycles(inst, left);
+    if (right_mem) ea = effective_address_cycles(inst, right);
+
+    u8 rep = (inst->flags & (Inst_Repz|Inst_Repnz)) != 0;
+
+    switch (inst->mnemonic) {
+        case Mneumonic_mov: {
+            if (left_mem)  return (right_imm ? 10 : 9) + ea;
+            if (right_mem) return 8 + ea;
+            return right_imm ? 4 : 2;
+        }
+        case Mneumonic_add:
+        case Mneumonic_adc:
+        case Mneumonic_sub:
+        case Mneumonic_sbb:
+        case Mneumonic_and:
+        case Mneumonic_or:
+        case Mneumonic_xor: {
+            if (left_mem)  return (right_imm ? 17 : 16) + ea;
+            if (right_mem) return 9 + ea;
+            return right_imm ? 4 : 3;
+        }
+        case Mneumonic_cmp: {
+            if (left_mem)  return (right_imm ? 10 : 9) + ea;
+            if (right_mem) return 9 + ea;
+            return right_imm ? 4 : 3;
+        }
+        case Mneumonic_test: {
+            if (left_mem || right_mem) return (right_imm ? 11 : 9) + ea;
+            return right_imm ? 5 : 3;
+        }
+        case Mneumonic_inc:
+        case Mneumonic_dec: {
+            if (left_mem) return 15 + ea;
+            return (inst->flags & Inst_Wide) ? 2 : 3;
+        }
+        case Mneumonic_not:
+        case Mneumonic_neg: {
+            return left_mem ? 16 + ea : 3;
+        }
+        case Mneumonic_mul:
+        case Mneumonic_imul: {
+            return ((inst->flags & Inst_Wide) ? 118 : 77) + (left_mem ? 6 + ea : 0);
+        }
+        case Mneumonic_div:
+        case Mneumonic_idiv: {
+            return ((inst->flags & Inst_Wide) ? 162 : 90) + (left_mem ? 6 + ea : 0);
+        }
+        case Mneumonic_rol:
+        case Mneumonic_ror:
+        case Mneumonic_rcl:
+        case Mneumonic_rcr:
+        case Mneumonic_shl:
+        case Mneumonic_shr:
+        case Mneumonic_sar: {
+            u8 by_one = right->type == Operand_Immediate;
+            if (left_mem) return (by_one ? 15 : 20) + ea;
+            return by_one ? 2 : 8;
+        }
+        case Mneumonic_lea: return 2 + ea;
+        case Mneumonic_xchg: return (left_mem || right_mem) ? 17 + ea : 4;
+
+        case Mneumonic_jo:
+        case Mneumonic_jno:
+        case Mneumonic_jb:
+        case Mneumonic_jnb:
+        case Mneumonic_jz:
+        case Mneumonic_jnz:
+        case Mneumonic_jbe:
+        case Mneumonic_ja:
+        case Mneumonic_js:
+        case Mneumonic_jns:
+        case Mneumonic_jp:
+        case Mneumonic_jnp:
+        case Mneumonic_jl:
+        case Mneumonic_jnl:
+        case Mneumonic_jle:
+        case Mneumonic_jg: return branch_taken ? 16 : 4;
+
+        case Mneumonic_jmp:    return 15;
+        case Mneumonic_jcxz:   return branch_taken ? 18 : 6;
+        case Mneumonic_loop:   return branch_taken ? 17 : 5;
+        case Mneumonic_loopz:  return branch_taken ? 18 : 6;
+        case Mneumonic_loopnz: return branch_taken ? 19 : 5;
+        case Mneumonic_call:   return (inst->flags & Inst_Far) ? 28 : 19;
+        case Mneumonic_ret:    return left->type == Operand_None ? 20 : 24;
+        case Mneumonic_retf:   return left->type == Operand_None ? 32 : 31;
+
+        case Mneumonic_push: {
+            if (left_mem) return 16 + ea;
+            return (left->flags & Inst_Segment) ? 10 : 11;
+        }
+        case Mneumonic_pop:   return left_mem ? 17 + ea : 8;
+        case Mneumonic_pushf: return 10;
+        case Mneumonic_popf:  return 8;
+
+        case Mneumonic_int:   return 51;
+        case Mneumonic_into:  return branch_taken ? 53 : 4;
+        case Mneumonic_iret:  return 24;
+
+        case Mneumonic_movsb:
+        case Mneumonic_movsw: return rep ? 9 + 17 * repetitions : 18;
+        case Mneumonic_stosb:
+        case Mneumonic_stosw: return rep ? 9 + 10 * repetitions : 11;
+        case Mneumonic_lodsb:
+        case Mneumonic_lodsw: return rep ? 9 + 13 * repetitions : 12;
+        case Mneumonic_cmpsb:
+        case Mneumonic_cmpsw: return rep ? 9 + 22 * repetitions : 22;
+        case Mneumonic_scasb:
+        case Mneumonic_scasw: return rep ? 9 + 15 * repetitions : 15;
+
+        case Mneumonic_in:
+        case Mneumonic_out: {
+            // The variable port form goes through dx
+            u8 through_dx = (inst->mnemonic == Mneumonic_in ? right : left)->type == Operand_Register;
+            return through_dx ? 8 : 10;
+        }
+
+        case Mneumonic_nop:  return 3;
+        case Mneumonic_cwd:  return 5;
+        case Mneumonic_lahf:
+        case Mneumonic_sahf: return 4;
+        case Mneumonic_xlat: return 11;
+        case Mneumonic_aam:  return 83;
+        case Mneumonic_aad:  return 60;
+
+        default: return 2;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef _H_PROFILER
+#define _H_PROFILER
+
+#include "sim86.h"
+
+// Guest controlled profiling. The guest writes into the reserved port range with the
+// out instruction, example:
+//
+//     mov al, 'f'
+//     out 0xF3, al        ; name the next region, one character per write, 0 terminates
+//     mov al, 0
+//     out 0xF3, al
+//     mov al, 1
+//     out 0xF0, al        ; begin region 1 ("f")
+//     ...
+//     out 0xF1, al        ; end region 1
+//
+#define PROFILER_PORT_BEGIN  0xF0 // data: region id
+#define PROFILER_PORT_END    0xF1 // data: region id
+#define PROFILER_PORT_MARKER 0xF2 // data: marker value, snapshots the counters
+#define PROFILER_PORT_NAME   0xF3 // data: next character of the name of the next begun region, 0 ends it
+
+#define PROFILER_PORT_FIRST PROFILER_PORT_BEGIN
+#define PROFILER_PORT_LAST  PROFILER_PORT_NAME
+
+#define PROFILER_MAX_REGIONS 256
+#define PROFILER_NAME_LENGTH 32
+
+typedef struct {
+    char name[PROFILER_NAME_LENGTH];
+
+    u32 depth; // recursive begin/end pairs are only counted at the outermost level
+    u64 hits;
+
+    Cpu_Stats start;
+    Cpu_Stats total;
+} Profiler_Region;
+
+typedef struct {
+    u16 value;
+    u32 address; // absolute address of the out instruction
+    Cpu_Stats stats;
+} Profiler_Marker;
+
+struct Profiler {
+    Profiler_Region regions[PROFILER_MAX_REGIONS];
+
+    char pending_name[PROFILER_NAME_LENGTH];
+    u32 pending_name_length;
+    u8 pending_name_terminated; // a 0 was written, the characters are dropped until the next begin
+
+    Profiler_Marker *markers;
+    u32 marker_count;
+    u32 marker_capacity;
+};
+
+Profiler *profiler_create(void);
+void profiler_destroy(Profiler *profiler);
+
+void profiler_attach(Profiler *profiler, Port_Io *io);
+void profiler_report(Profiler *profiler, FILE *dest);
+
+u32 instruction_cycles(Instruction *inst, u8 branch_taken, u16 repetitions);
+
+#endif
@@ -0,0 +1,31 @@
+# Builds the sim86 extension module from the simulator sources, no make lib needed:
+#
+#   cd python && python3 setup.py build_ext --inplace
+#
+# See sim86module.c for the usage.
+
+import glob
+import os
+
+from setuptools import Extension, setup
+
+here = os.path.dirname(os.path.abspath(__file__))
+os.chdir(here)
+
+# Every simulator module except the command line front end
+sources = ["sim86module.c"] + sorted(path for path in glob.glob("../*.c") if os.path.basename(path) != "main.c")
+
+setup(
+    name="sim86",
+    version="0.1",
+    description="Python bindings of the libsim86 8086 simulator",
+    ext_modules=[
+        Extension(
+            "sim86",
+            sources=sources,
+            include_dirs=[".."],
+            extra_compile_args=["-O3", "-pthread", "-fvisibility=hidden", "-UNDEBUG"], # the simulator relies on its asserts
+            extra_link_args=["-pthread"],
+        )
+    ],
+)
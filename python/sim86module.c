@@ -0,0 +1,375 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "libsim86.h"
+
+// Python bindings of libsim86, built by setup.py in this directory:
+//
+//   import sim86
+//   machine = sim86.Machine()
+//   machine.load("../input/listing_0052_memory_add_loop")
+//   status = machine.run_until(sim86.NO_ADDRESS, limit=1000000)
+//   print(machine.bx, machine.memory[1000:1008].tobytes())
+//
+// The Machine exports the guest memory through the buffer protocol, so machine.memory (or
+// numpy.frombuffer(machine, numpy.uint8)) is a writable view of the guest megabyte without a copy.
+// The GIL is released while the guest runs, so the machines scale with Python threads too.
+// A guest which divides by zero or hits a form the simulator can't execute raises sim86.Fault,
+// the machine stays on that instruction until the next load.
+
+typedef struct {
+    PyObject_HEAD
+    Sim86 *sim;
+
+    PyObject *port_write; // None if the outs are dropped
+    PyObject *port_read;  // None if the ins read back the open bus
+    uint8_t running;     // a run() without the GIL, the other threads can't run, load or set a register
+    uint8_t failed;      // a callback raised, the exception is pending until the run returns
+} Machine;
+
+static PyObject *fault_error; // sim86.Fault
+
+static void machine_port_write(void *user, uint16_t port, uint16_t data, uint8_t wide)
+{
+    Machine *machine = (Machine *)user;
+
+    PyGILState_STATE gil = PyGILState_Ensure();
+    if (!machine->failed && machine->port_write != Py_None) {
+        PyObject *result = PyObject_CallFunction(machine->port_write, "HHO", port, data, wide ? Py_True : Py_False);
+        if (result == NULL) {
+            machine->failed = 1;
+            sim86_stop(machine->sim);
+        }
+        Py_XDECREF(result);
+    }
+    PyGILState_Release(gil);
+}
+
+static uint16_t machine_port_read(void *user, uint16_t port, uint8_t wide)
+{
+    Machine *machine = (Machine *)user;
+    uint16_t data = wide ? 0xFFFF : 0xFF;
+
+    PyGILState_STATE gil = PyGILState_Ensure();
+    if (!machine->failed && machine->port_read != Py_None) {
+        PyObject *result = PyObject_CallFunction(machine->port_read, "HO", port, wide ? Py_True : Py_False);
+        if (result != NULL) {
+            data = (uint16_t)PyLong_AsUnsignedLongMask(result);
+        }
+
+        if (result == NULL || PyErr_Occurred()) {
+            machine->failed = 1;
+            sim86_stop(machine->sim);
+        }
+        Py_XDECREF(result);
+    }
+    PyGILState_Release(gil);
+
+    return data;
+}
+
+static PyObject *machine_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    Machine *machine = (Machine *)type->tp_alloc(type, 0);
+    if (machine == NULL) {
+        return NULL;
+    }
+
+    machine->sim = sim86_create();
+    if (machine->sim == NULL) {
+        Py_DECREF(machine);
+        return PyErr_NoMemory();
+    }
+
+    Py_INCREF(Py_None);
+    machine->port_write = Py_None;
+    Py_INCREF(Py_None);
+    machine->port_read = Py_None;
+
+    sim86_set_port_callbacks(machine->sim, machine_port_write, machine_port_read, machine);
+
+    return (PyObject *)machine;
+}
+
+static void machine_dealloc(Machine *machine)
+{
+    if (machine->sim) {
+        sim86_destroy(machine->sim);
+    }
+
+    Py_XDECREF(machine->port_write);
+    Py_XDECREF(machine->port_read);
+    Py_TYPE(machine)->tp_free((PyObject *)machine);
+}
+
+// The guest runs without the GIL, a load or a register write from an other thread would race with it
+static uint8_t machine_busy(Machine *machine)
+{
+    if (machine->running) {
+        PyErr_SetString(PyExc_RuntimeError, "the machine is already running");
+        return 1;
+    }
+    return 0;
+}
+
+static PyObject *machine_load(Machine *machine, PyObject *args)
+{
+    PyObject *path = NULL;
+    if (machine_busy(machine) || !PyArg_ParseTuple(args, "O&", PyUnicode_FSConverter, &path)) {
+        return NULL;
+    }
+
+    Sim86_Status status = sim86_load(machine->sim, PyBytes_AS_STRING(path));
+    if (status != Sim86_Ok) {
+        PyErr_Format(PyExc_OSError, "can't load %s, it is missing or doesn't fit into the memory", PyBytes_AS_STRING(path));
+        Py_DECREF(path);
+        return NULL;
+    }
+
+    Py_DECREF(path);
+    Py_RETURN_NONE;
+}
+
+static PyObject *machine_load_bytes(Machine *machine, PyObject *args)
+{
+    Py_buffer program;
+    if (machine_busy(machine) || !PyArg_ParseTuple(args, "y*", &program)) {
+        return NULL;
+    }
+
+    Sim86_Status status = Sim86_Error;
+    if (program.len <= SIM86_MEMORY_SIZE) {
+        status = sim86_load_memory(machine->sim, program.buf, (uint32_t)program.len);
+    }
+    PyBuffer_Release(&program);
+
+    if (status != Sim86_Ok) {
+        PyErr_SetString(PyExc_ValueError, "the program doesn't fit into the memory");
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+// Runs the guest without the GIL, the callbacks take it back when they call into Python
+static PyObject *run_machine(Machine *machine, uint32_t address, unsigned long long limit, uint8_t step_n)
+{
+    if (machine_busy(machine)) {
+        return NULL;
+    }
+
+    machine->running = 1;
+    machine->failed = 0;
+
+    Sim86_Status status;
+    Py_BEGIN_ALLOW_THREADS
+    status = step_n ? sim86_step_n(machine->sim, limit) : sim86_run_until(machine->sim, address, limit);
+    Py_END_ALLOW_THREADS
+
+    machine->running = 0;
+
+    if (machine->failed) {
+        return NULL; // the exception of the callback
+    }
+
+    if (status == Sim86_Fault) {
+        char message[64];
+        snprintf(message, sizeof(message), "the guest faulted at %04x:%04x",
+                 sim86_read_reg(machine->sim, Sim86_Register_cs), sim86_read_reg(machine->sim, Sim86_Register_ip));
+        PyErr_SetString(fault_error, message);
+        return NULL;
+    }
+
+    return PyLong_FromLong(status);
+}
+
+static PyObject *machine_run(Machine *machine, PyObject *args)
+{
+    unsigned long long count;
+    if (!PyArg_ParseTuple(args, "K", &count)) {
+        return NULL;
+    }
+
+    return run_machine(machine, SIM86_NO_ADDRESS, count, 1);
+}
+
+static PyObject *machine_run_until(Machine *machine, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = { "address", "limit", NULL };
+
+    unsigned int address;
+    unsigned long long limit = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "I|K", keywords, &address, &limit)) {
+        return NULL;
+    }
+
+    return run_machine(machine, address, limit, 0);
+}
+
+static PyObject *machine_set_port_callbacks(Machine *machine, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = { "write", "read", NULL };
+
+    PyObject *write = Py_None;
+    PyObject *read = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OO", keywords, &write, &read)) {
+        return NULL;
+    }
+
+    if ((write != Py_None && !PyCallable_Check(write)) || (read != Py_None && !PyCallable_Check(read))) {
+        PyErr_SetString(PyExc_TypeError, "the port callbacks have to be callable or None");
+        return NULL;
+    }
+
+    Py_INCREF(write);
+    Py_SETREF(machine->port_write, write);
+    Py_INCREF(read);
+    Py_SETREF(machine->port_read, read);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *machine_stats(Machine *machine, PyObject *unused)
+{
+    Sim86_Stats stats;
+    sim86_get_stats(machine->sim, &stats);
+
+    return Py_BuildValue("{s:K,s:K,s:K,s:K}",
+                         "instructions", (unsigned long long)stats.instructions,
+                         "cycles", (unsigned long long)stats.cycles,
+                         "memory_reads", (unsigned long long)stats.memory_reads,
+                         "memory_writes", (unsigned long long)stats.memory_writes);
+}
+
+static PyObject *machine_get_memory(Machine *machine, void *closure)
+{
+    return PyMemoryView_FromObject((PyObject *)machine);
+}
+
+static int machine_get_buffer(Machine *machine, Py_buffer *view, int flags)
+{
+    return PyBuffer_FillInfo(view, (PyObject *)machine, sim86_memory(machine->sim), SIM86_MEMORY_SIZE, 0, flags);
+}
+
+static PyObject *machine_get_register(Machine *machine, void *closure)
+{
+    return PyLong_FromLong(sim86_read_reg(machine->sim, (Sim86_Register)(intptr_t)closure));
+}
+
+static int machine_set_register(Machine *machine, PyObject *value, void *closure)
+{
+    if (value == NULL) {
+        PyErr_SetString(PyExc_AttributeError, "the registers can't be deleted");
+        return -1;
+    }
+
+    if (machine_busy(machine)) {
+        return -1;
+    }
+
+    unsigned long data = PyLong_AsUnsignedLong(value);
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+
+    if (data > 0xFFFF) {
+        PyErr_SetString(PyExc_ValueError, "the registers are 16bit");
+        return -1;
+    }
+
+    sim86_write_reg(machine->sim, (Sim86_Register)(intptr_t)closure, (uint16_t)data);
+    return 0;
+}
+
+#define REGISTER_ATTRIBUTE(_name) \
+    { #_name, (getter)machine_get_register, (setter)machine_set_register, #_name " register", (void *)(intptr_t)Sim86_Register_##_name }
+
+static PyGetSetDef machine_getset[] = {
+    REGISTER_ATTRIBUTE(ax), REGISTER_ATTRIBUTE(bx), REGISTER_ATTRIBUTE(cx), REGISTER_ATTRIBUTE(dx),
+    REGISTER_ATTRIBUTE(sp), REGISTER_ATTRIBUTE(bp), REGISTER_ATTRIBUTE(si), REGISTER_ATTRIBUTE(di),
+    REGISTER_ATTRIBUTE(es), REGISTER_ATTRIBUTE(cs), REGISTER_ATTRIBUTE(ss), REGISTER_ATTRIBUTE(ds),
+    REGISTER_ATTRIBUTE(ip), REGISTER_ATTRIBUTE(flags),
+    { "memory", (getter)machine_get_memory, NULL, "writable memoryview of the guest memory", NULL },
+    { NULL }
+};
+
+static PyMethodDef machine_methods[] = {
+    { "load", (PyCFunction)machine_load, METH_VARARGS,
+      "load(path): resets the machine and loads the program to f000:0100" },
+    { "load_bytes", (PyCFunction)machine_load_bytes, METH_VARARGS,
+      "load_bytes(program): resets the machine and loads the program from a bytes-like object" },
+    { "run", (PyCFunction)machine_run, METH_VARARGS,
+      "run(n): executes up to n instructions, returns the status, raises sim86.Fault" },
+    { "run_until", (PyCFunction)machine_run_until, METH_VARARGS | METH_KEYWORDS,
+      "run_until(address, limit=0): runs until the absolute address or limit instructions (0 is no limit), returns the status, raises sim86.Fault" },
+    { "set_port_callbacks", (PyCFunction)machine_set_port_callbacks, METH_VARARGS | METH_KEYWORDS,
+      "set_port_callbacks(write=None, read=None): write(port, data, wide) and read(port, wide) -> int" },
+    { "stats", (PyCFunction)machine_stats, METH_NOARGS,
+      "stats(): the executed instructions, modelled cycles and memory traffic" },
+    { NULL }
+};
+
+static PyBufferProcs machine_buffer = {
+    .bf_getbuffer = (getbufferproc)machine_get_buffer,
+};
+
+static PyTypeObject machine_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "sim86.Machine",
+    .tp_doc = "An 8086 machine with its own memory, registers and ports",
+    .tp_basicsize = sizeof(Machine),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = machine_new,
+    .tp_dealloc = (destructor)machine_dealloc,
+    .tp_methods = machine_methods,
+    .tp_getset = machine_getset,
+    .tp_as_buffer = &machine_buffer,
+};
+
+static struct PyModuleDef sim86_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "sim86",
+    .m_doc = "Python bindings of the libsim86 8086 simulator",
+    .m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit_sim86(void)
+{
+    if (PyType_Ready(&machine_type) < 0) {
+        return NULL;
+    }
+
+    PyObject *module = PyModule_Create(&sim86_module);
+    if (module == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(&machine_type);
+    if (PyModule_AddObject(module, "Machine", (PyObject *)&machine_type) < 0) {
+        Py_DECREF(&machine_type);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    fault_error = PyErr_NewException("sim86.Fault", PyExc_RuntimeError, NULL);
+    if (fault_error == NULL || PyModule_AddObject(module, "Fault", fault_error) < 0) {
+        Py_XDECREF(fault_error);
+        Py_DECREF(module);
+        return NULL;
+    }
+    Py_INCREF(fault_error); // the module took one reference, run_machine() keeps using it
+
+    PyModule_AddIntConstant(module, "OK", Sim86_Ok);
+    PyModule_AddIntConstant(module, "HALTED", Sim86_Halted);
+    PyModule_AddIntConstant(module, "UNHANDLED", Sim86_Unhandled);
+    PyModule_AddIntConstant(module, "REACHED", Sim86_Reached);
+    PyModule_AddIntConstant(module, "LIMIT", Sim86_Limit);
+    PyModule_AddIntConstant(module, "STOPPED", Sim86_Stopped);
+    PyModule_AddIntConstant(module, "ERROR", Sim86_Error);
+    PyModule_AddIntConstant(module, "MEMORY_SIZE", SIM86_MEMORY_SIZE);
+    PyModule_AddIntConstant(module, "VIDEO_ADDRESS", SIM86_VIDEO_ADDRESS);
+    PyModule_AddIntConstant(module, "VIDEO_SIZE", SIM86_VIDEO_SIZE);
+    PyModule_AddObject(module, "NO_ADDRESS", PyLong_FromUnsignedLong(SIM86_NO_ADDRESS));
+
+    return module;
+}
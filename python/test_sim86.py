@@ -0,0 +1,63 @@
+# Tests of the Python bindings, run by make pytest after the module is built in place:
+#
+#   cd python && python3 -m unittest -v test_sim86
+#
+# A faulting guest has to raise sim86.Fault, it must never take the interpreter down.
+
+import unittest
+
+import sim86
+
+DIVIDE_BY_ZERO = bytes([
+    0xB3, 0x00,  # mov bl, 0
+    0xF6, 0xF3,  # div bl
+    0xB1, 0x07,  # mov cl, 7
+])
+
+FAR_JUMP = bytes([
+    0xB1, 0x07,                    # mov cl, 7
+    0xEA, 0x00, 0x01, 0x00, 0xF0,  # jmp 61440:256
+])
+
+ADD_LOOP = bytes([
+    0xB9, 0x03, 0x00,  # mov cx, 3
+    0x83, 0xC0, 0x02,  # add ax, 2
+    0xE2, 0xFB,        # loop $-3
+])
+
+
+class FaultTest(unittest.TestCase):
+    def check_fault(self, program, fault_ip, run):
+        machine = sim86.Machine()
+        machine.load_bytes(program)
+
+        with self.assertRaises(sim86.Fault):
+            run(machine)
+        self.assertEqual(machine.ip, fault_ip)
+        self.assertEqual(machine.stats()["instructions"], 1)
+
+        # The machine stays stopped on it until the next load
+        with self.assertRaises(sim86.Fault):
+            machine.run(1)
+        self.assertEqual(machine.ip, fault_ip)
+
+        machine.load_bytes(ADD_LOOP)
+        self.assertEqual(machine.run_until(sim86.NO_ADDRESS, limit=100), sim86.HALTED)
+        self.assertEqual(machine.ax, 6)
+
+    def test_divide_by_zero(self):
+        self.check_fault(DIVIDE_BY_ZERO, 0x102, lambda machine: machine.run(5))
+
+    def test_far_jump(self):
+        self.check_fault(FAR_JUMP, 0x102, lambda machine: machine.run_until(sim86.NO_ADDRESS, limit=100))
+
+    def test_fault_is_runtime_error(self):
+        machine = sim86.Machine()
+        machine.load_bytes(DIVIDE_BY_ZERO)
+        self.assertEqual(machine.run(1), sim86.OK)
+        with self.assertRaisesRegex(RuntimeError, "f000:0102"):
+            machine.run(1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,284 @@
+#include "replay.h"
+#include "debugger.h"
+#include "port_io.h"
+#include "simulator.h"
+
+Replay *replay_create(u64 interval)
+{
+    Replay *replay = (Replay *)calloc(1, sizeof(Replay));
+    assert(replay != NULL);
+
+    replay->checkpoints = (Replay_Checkpoint *)calloc(REPLAY_MAX_CHECKPOINTS, sizeof(Replay_Checkpoint));
+    assert(replay->checkpoints != NULL);
+
+    replay->interval = interval ? interval : REPLAY_DEFAULT_INTERVAL;
+
+    return replay;
+}
+
+static void release_checkpoint(Replay_Checkpoint *checkpoint)
+{
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        Replay_Page *data = checkpoint->pages[page];
+        if (data && --data->refs == 0) {
+            free(data);
+        }
+        checkpoint->pages[page] = NULL;
+    }
+}
+
+void replay_destroy(Replay *replay)
+{
+    for (u32 i = 0; i < replay->checkpoint_count; i++) {
+        release_checkpoint(&replay->checkpoints[i]);
+    }
+
+    free(replay->checkpoints);
+    free(replay->inputs);
+    free(replay);
+}
+
+// Keeps the first, the last and every second checkpoint between them
+static void thin_out_checkpoints(Replay *replay)
+{
+    u32 kept = 0;
+    for (u32 i = 0; i < replay->checkpoint_count; i++) {
+        if ((i % 2) == 0 || i == replay->checkpoint_count - 1) {
+            if (kept != i) {
+                replay->checkpoints[kept] = replay->checkpoints[i];
+            }
+            kept++;
+        } else {
+            release_checkpoint(&replay->checkpoints[i]);
+        }
+    }
+
+    replay->checkpoint_count = kept;
+    replay->interval *= 2;
+}
+
+void replay_checkpoint(CPU *cpu)
+{
+    Replay *replay = cpu->replay;
+
+    if (replay->checkpoint_count == REPLAY_MAX_CHECKPOINTS) {
+        thin_out_checkpoints(replay);
+    }
+
+    Replay_Checkpoint *previous = NULL;
+    if (replay->checkpoint_count) {
+        previous = &replay->checkpoints[replay->checkpoint_count - 1];
+    }
+
+    Replay_Checkpoint *checkpoint = &replay->checkpoints[replay->checkpoint_count++];
+    checkpoint->instruction = cpu->stats.instructions;
+    checkpoint->ip = cpu->ip;
+    checkpoint->flags = cpu->flags;
+    checkpoint->terminate = cpu->terminate;
+    checkpoint->fault = cpu->fault;
+    checkpoint->stats = cpu->stats;
+    memcpy(checkpoint->regmem, cpu->regmem, sizeof(checkpoint->regmem));
+
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        u8 *memory = cpu->memory + page * MEMORY_PAGE_SIZE;
+        u8 dirty = cpu->page_flags[page] & Page_Dirty_Replay;
+        cpu->page_flags[page] &= ~Page_Dirty_Replay;
+
+        // A written page is still shared if the same values were written back
+        if (previous) {
+            Replay_Page *shared = previous->pages[page];
+            if (!dirty || memcmp(shared->data, memory, MEMORY_PAGE_SIZE) == 0) {
+                shared->refs++;
+                checkpoint->pages[page] = shared;
+                continue;
+            }
+        }
+
+        Replay_Page *copy = (Replay_Page *)malloc(sizeof(Replay_Page));
+        assert(copy != NULL);
+
+        copy->refs = 1;
+        memcpy(copy->data, memory, MEMORY_PAGE_SIZE);
+        checkpoint->pages[page] = copy;
+    }
+
+    replay->next_checkpoint = cpu->stats.instructions + replay->interval;
+}
+
+static void restore_checkpoint(CPU *cpu, u32 index)
+{
+    Replay *replay = cpu->replay;
+    Replay_Checkpoint *checkpoint = &replay->checkpoints[index];
+    Replay_Checkpoint *last = &replay->checkpoints[replay->checkpoint_count - 1];
+
+    // The memory only differs from the last checkpoint in the dirty pages. The next checkpoint
+    // is always taken after the last one, so the dirty bits have to stay relative to that.
+    for (u32 page = 0; page < MEMORY_PAGE_COUNT; page++) {
+        u8 differs_from_last = checkpoint->pages[page] != last->pages[page];
+
+        if (differs_from_last || (cpu->page_flags[page] & Page_Dirty_Replay)) {
+            memcpy(cpu->memory + page * MEMORY_PAGE_SIZE, checkpoint->pages[page]->data, MEMORY_PAGE_SIZE);
+            mark_memory_dirty(cpu, page * MEMORY_PAGE_SIZE, MEMORY_PAGE_SIZE);
+        }
+
+        if (!differs_from_last) {
+            cpu->page_flags[page] &= ~Page_Dirty_Replay;
+        }
+    }
+
+    cpu->ip = checkpoint->ip;
+    cpu->flags = checkpoint->flags;
+    cpu->terminate = checkpoint->terminate;
+    cpu->fault = checkpoint->fault;
+    cpu->stats = checkpoint->stats;
+    memcpy(cpu->regmem, checkpoint->regmem, sizeof(cpu->regmem));
+
+    // The first input of the checkpoint instruction or a later one
+    u32 low = 0;
+    u32 high = replay->input_count;
+    while (low < high) {
+        u32 middle = low + (high - low) / 2;
+        if (replay->inputs[middle].instruction < checkpoint->instruction) low = middle + 1;
+        else                                                              high = middle;
+    }
+    replay->input_cursor = low;
+}
+
+u16 replay_port_read(CPU *cpu, u16 port, u8 wide)
+{
+    Replay *replay = cpu->replay;
+
+    if (!replay->live) {
+        if (replay->input_cursor < replay->input_count) {
+            Replay_Input *input = &replay->inputs[replay->input_cursor];
+            if (input->instruction == cpu->stats.instructions && input->port == port) {
+                replay->input_cursor++;
+                return input->data;
+            }
+        }
+
+        printf("\n[WARNING]: The replay diverged from the recording at instruction %lu, port %#x is read again!\n",
+               cpu->stats.instructions, port);
+        return port_read(cpu, port, wide);
+    }
+
+    if (replay->input_count == replay->input_capacity) {
+        replay->input_capacity = replay->input_capacity ? replay->input_capacity * 2 : 1024;
+        replay->inputs = (Replay_Input *)realloc(replay->inputs, replay->input_capacity * sizeof(Replay_Input));
+        assert(replay->inputs != NULL);
+    }
+
+    u16 data = port_read(cpu, port, wide);
+
+    Replay_Input *input = &replay->inputs[replay->input_count++];
+    input->instruction = cpu->stats.instructions;
+    input->port = port;
+    input->data = data;
+
+    return data;
+}
+
+u64 replay_first_instruction(Replay *replay)
+{
+    return replay->checkpoint_count ? replay->checkpoints[0].instruction : 0;
+}
+
+void replay_seek(CPU *cpu, u64 instruction)
+{
+    Replay *replay = cpu->replay;
+
+    if (instruction < replay_first_instruction(replay)) {
+        instruction = replay_first_instruction(replay);
+    }
+
+    // Restore the nearest checkpoint before the target, unless the current state is closer
+    u32 index = replay->checkpoint_count;
+    while (index > 0 && replay->checkpoints[index - 1].instruction > instruction) {
+        index--;
+    }
+
+    if (index > 0) {
+        u64 checkpoint_instruction = replay->checkpoints[index - 1].instruction;
+        if (instruction < cpu->stats.instructions || checkpoint_instruction > cpu->stats.instructions) {
+            restore_checkpoint(cpu, index - 1);
+        }
+    }
+
+    u8 quiet = cpu->quiet;
+    cpu->quiet = 1;
+
+    while (cpu->stats.instructions < instruction && !cpu->terminate && calc_inst_pointer_address(cpu) < cpu->exec_end) {
+        step_instruction(cpu);
+    }
+
+    cpu->quiet = quiet;
+
+    // The watchpoints passed on the way are not stops
+    if (cpu->debugger) {
+        cpu->debugger->stop_requested = 0;
+        cpu->debugger->watch_hit_kind = 0;
+    }
+}
+
+u8 replay_reverse_continue(CPU *cpu)
+{
+    Replay *replay = cpu->replay;
+    Debugger *debugger = cpu->debugger;
+    assert(debugger != NULL);
+
+    u64 end = cpu->stats.instructions;
+
+    u8 quiet = cpu->quiet;
+    cpu->quiet = 1;
+
+    // Search the intervals between the checkpoints backwards, the last hit of the first
+    // interval with any hit is the one we're looking for
+    for (u32 index = replay->checkpoint_count; index > 0; index--) {
+        Replay_Checkpoint *checkpoint = &replay->checkpoints[index - 1];
+        if (checkpoint->instruction >= end) {
+            continue;
+        }
+
+        restore_checkpoint(cpu, index - 1);
+
+        u64 hit = end;
+        u32 hit_address = 0;
+        u8 hit_kind = 0;
+
+        while (cpu->stats.instructions < end && !cpu->terminate) {
+            u64 current = cpu->stats.instructions;
+            u32 address = calc_inst_pointer_address(cpu);
+
+            if (debugger->breakpoints[address >> 3] & (1 << (address & 7))) {
+                hit = current;
+                hit_kind = 0;
+            }
+
+            debugger->watch_hit_kind = 0;
+            step_instruction(cpu);
+
+            // Going backwards the watchpoint stops before the instruction which made the access
+            if (debugger->watch_hit_kind) {
+                hit = current;
+                hit_address = debugger->watch_hit_address;
+                hit_kind = debugger->watch_hit_kind;
+            }
+        }
+
+        if (hit != end) {
+            cpu->quiet = quiet;
+            replay_seek(cpu, hit);
+
+            debugger->watch_hit_address = hit_address;
+            debugger->watch_hit_kind = hit_kind;
+            return 1;
+        }
+
+        end = checkpoint->instruction;
+    }
+
+    cpu->quiet = quiet;
+    replay_seek(cpu, replay_first_instruction(replay));
+
+    return 0;
+}
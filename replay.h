@@ -0,0 +1,99 @@
+#ifndef _H_REPLAY
+#define _H_REPLAY
+
+#include "sim86.h"
+
+// Execution recording for reverse debugging, enabled by --record.
+//
+// The only non-deterministic input of the simulated machine is the data of the IN
+// instructions (there are no external interrupts and the guest can't observe the host
+// time), so the recording is the list of the IN values and a checkpoint of the registers
+// and the memory in every interval instruction. The checkpoints share the pages which
+// weren't written since the previous one, so an idle megabyte costs nothing.
+//
+// Seeking restores the nearest checkpoint before the target and executes quietly until
+// the target instruction number. While the already recorded history is re-executed the
+// IN values come from the log and the OUT instructions are not repeated. Changing the
+// state in the past (gdb memory/register writes) doesn't fork the recorded inputs.
+
+#define REPLAY_DEFAULT_INTERVAL 100000
+
+// When this many checkpoints are taken, every second one is dropped and the interval is doubled
+#define REPLAY_MAX_CHECKPOINTS 256
+
+typedef struct {
+    u32 refs;
+    u8 data[MEMORY_PAGE_SIZE];
+} Replay_Page;
+
+typedef struct {
+    u64 instruction; // the checkpoint is taken before executing this instruction number
+    u16 ip;
+    u16 flags;
+    u8 regmem[64];
+    u8 terminate;
+    u8 fault;
+    Cpu_Stats stats;
+    Replay_Page *pages[MEMORY_PAGE_COUNT];
+} Replay_Checkpoint;
+
+typedef struct {
+    u64 instruction;
+    u16 port;
+    u16 data;
+} Replay_Input;
+
+struct Replay {
+    Replay_Checkpoint *checkpoints; // REPLAY_MAX_CHECKPOINTS
+    u32 checkpoint_count;
+    u64 interval;
+    u64 next_checkpoint;
+
+    Replay_Input *inputs;
+    u32 input_count;
+    u32 input_capacity;
+    u32 input_cursor; // the next input to replay
+
+    u64 executed_until; // the instructions below this number are already recorded
+    u8 live;            // the current instruction is executed the first time
+};
+
+Replay *replay_create(u64 interval);
+void replay_destroy(Replay *replay);
+
+void replay_checkpoint(CPU *cpu);
+u16 replay_port_read(CPU *cpu, u16 port, u8 wide);
+
+// Moves the machine to the state before executing the instruction number, it can be
+// anywhere in the recorded history or after it (then the guest runs there quietly).
+void replay_seek(CPU *cpu, u64 instruction);
+
+// Moves back to the last breakpoint or watchpoint hit before the current instruction.
+// Returns 0 if nothing hits, the machine is at the start of the recording then.
+u8 replay_reverse_continue(CPU *cpu);
+
+u64 replay_first_instruction(Replay *replay);
+
+// 0 while the replay re-executes the recorded history, the heatmap, the profiler and the
+// dumps already counted those instructions
+static inline u8 replay_is_live(CPU *cpu)
+{
+    return cpu->replay == NULL || cpu->replay->live;
+}
+
+// Called before every instruction
+static inline void replay_before_step(CPU *cpu)
+{
+    Replay *replay = cpu->replay;
+
+    replay->live = cpu->stats.instructions >= replay->executed_until;
+    if (replay->live) {
+        replay->executed_until = cpu->stats.instructions + 1;
+
+        if (cpu->stats.instructions >= replay->next_checkpoint) {
+            replay_checkpoint(cpu);
+        }
+    }
+}
+
+#endif
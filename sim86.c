@@ -7,7 +7,7 @@ Register_Access *register_access(u32 reg, u32 flags)
         index = 2;
     }
 
-    static u32 registers[3][8][3] = {
+    static const u32 registers[3][8][3] = {
         // BYTE (8bit)
         {
             // enum, offset, size
@@ -7,6 +7,27 @@
 #include <stdlib.h>
 #include <string.h>
 
+// build.bat builds with MSVC, which has a few of the POSIX calls under an other name. The
+// features which need fork(), sockets, shared memory or mmap() are stubbed out or fall back
+// to the plain C library there, the threaded ones run on one thread, see the _WIN32 parts.
+#ifdef _WIN32
+#include <time.h>
+
+#define strtok_r strtok_s
+
+#define CLOCK_MONOTONIC 0
+static inline int clock_gettime(int clock_id, struct timespec *result)
+{
+    (void)clock_id;
+    return timespec_get(result, TIME_UTC) == TIME_UTC ? 0 : -1;
+}
+
+// Only the C11 mode has static_assert, the older ones fail on the negative array size
+#ifndef static_assert
+#define static_assert(_condition, _message) ((void)sizeof(char[(_condition) ? 1 : -1]))
+#endif
+#endif
+
 typedef char s8;
 typedef short s16;
 typedef int s32;
@@ -42,6 +63,24 @@ typedef unsigned long u64;
 
 #define MAX_MEMORY (1024 * 1024)
 
+// The memory is tracked in 4KiB pages by the features which don't need byte level granularity
+#define MEMORY_PAGE_SHIFT 12
+#define MEMORY_PAGE_SIZE (1 << MEMORY_PAGE_SHIFT)
+#define MEMORY_PAGE_COUNT (MAX_MEMORY / MEMORY_PAGE_SIZE)
+
+typedef enum {
+    Page_Watch_Read  = (1 << 0), // the debugger has a read watchpoint somewhere in the page
+    Page_Watch_Write = (1 << 1), // the debugger has a write watchpoint somewhere in the page
+    Page_Dirty_Replay = (1 << 2), // written since the last replay checkpoint
+    Page_Dirty_Reset  = (1 << 3), // written since the memory was zeroed
+    Page_Dirty_Fork   = (1 << 4), // written since the fork server snapshot
+    Page_Dirty_Dump   = (1 << 5), // written since the previous memory dump frame
+    Page_Decoded      = (1 << 6), // has bytes of an instruction in the micro-op cache
+} Page_Flag;
+
+// Every user of the dirty page tracking owns a bit and clears only that one, a write sets all of them
+#define PAGE_DIRTY_ALL (Page_Dirty_Replay|Page_Dirty_Reset|Page_Dirty_Fork|Page_Dirty_Dump)
+
 // These are the real place of the
 #define F_CARRY      (1 << 0)
 #define F_PARITY     (1 << 2)
@@ -173,8 +212,6 @@ enum Instruction_Type {
 #include "i8086table.h"
 
 typedef struct {
-  u8 is_prefix;
-
   u32 mem_address;
   u8 size;
 
@@ -192,6 +229,38 @@ typedef struct {
 
 } Instruction;
 
+typedef struct {
+    u64 instructions;
+    u64 cycles;        // modelled, see instruction_cycles()
+    u64 memory_reads;  // bytes
+    u64 memory_writes; // bytes
+} Cpu_Stats;
+
+// Why the guest stopped on an instruction instead of executing it, the ip stays at the instruction
+typedef enum {
+    Cpu_Fault_None,
+    Cpu_Fault_Divide,        // div by zero, the interrupt 0 isn't simulated
+    Cpu_Fault_Unimplemented, // far jmp, repnz stos
+} Cpu_Fault;
+
+typedef enum {
+    Decode_None,
+    Decode_Recursive, // --decode: follows the control flow, the unreached bytes are data
+    Decode_Linear,    // --decode-linear: every byte from cs:ip to the end of the program is code
+} Decode_Mode;
+
+typedef struct Heatmap Heatmap;
+typedef struct Profiler Profiler;
+typedef struct Port_Io Port_Io;
+typedef struct Debugger Debugger;
+typedef struct Gdb_Stub Gdb_Stub;
+typedef struct Replay Replay;
+typedef struct Memory_Pool Memory_Pool;
+typedef struct Coverage Coverage;
+typedef struct Live_View Live_View;
+typedef struct Memory_Dump Memory_Dump;
+typedef struct Micro_Op_Cache Micro_Op_Cache;
+
 typedef struct {
     u32 loaded_executable_size; // @Todo: Remove
     u32 exec_end;
@@ -204,15 +273,34 @@ typedef struct {
     u8 regmem[64]; // The "accessible" register values are stored here
 
     u8* memory;
+    Memory_Pool *memory_pool; // the memory is returned here by power_off(), NULL if the cpu maps its own
+    u8 page_flags[MEMORY_PAGE_COUNT]; // Page_Flag bits
 
     u8 terminate;
+    u8 fault; // Cpu_Fault, terminate is set with it
 
     // Options
     u8 dump_out;
-    u8 decode_only;
-    u8 debug_mode;
-
-    FILE *out; // @Debug
+    u8 decode_only; // Decode_Mode
+    u32 decode_threads; // --decode-linear splits the program into chunks for this many threads
+    u8 decode_format;   // Decode_Format
+    u8 quiet; // no execution trace
+    u8 no_micro_op_cache; // --no-micro-op-cache, every executed instruction is decoded again
+    u64 max_instructions; // the simulation stops after this many instructions, 0 if there is no limit
+
+    Port_Io *io;
+    Debugger *debugger; // NULL if we're not debugging
+    Gdb_Stub *gdb;      // NULL if gdb is not attached, the stops of the debugger are served by gdb otherwise
+    Replay *replay;     // NULL if the execution is not recorded
+    Coverage *coverage; // NULL if the branches are not counted, only used if built with FUZZ_ENABLED
+    Live_View *live_view; // NULL if the memory is not shared, the memory belongs to the view otherwise
+    Memory_Dump *dump;    // NULL if the memory is not dumped sparsely
+    Micro_Op_Cache *micro_ops; // the executed instructions, created by boot() unless it is disabled
+
+    Cpu_Stats stats;
+
+    Heatmap *heatmap;   // NULL if the access counting is disabled
+    Profiler *profiler; // NULL if the guest profiling ports are disabled
 
 } CPU;
 
@@ -220,5 +308,24 @@ typedef struct {
 Register_Access *register_access(u32 reg, u32 flags);
 Register_Access *register_access_by_enum(Register reg);
 
+void micro_op_cache_invalidate(CPU *cpu, u32 address, u32 size);
+
+// Has to be called for every guest memory write which doesn't go through set_data_to_memory()
+static inline void mark_memory_dirty(CPU *cpu, u32 address, u32 size)
+{
+    u32 first = (address & (MAX_MEMORY - 1)) >> MEMORY_PAGE_SHIFT;
+    u32 last  = ((address & (MAX_MEMORY - 1)) + size - 1) >> MEMORY_PAGE_SHIFT;
+    u8 decoded = 0;
+    for (u32 page = first; page <= last; page++) {
+        decoded |= cpu->page_flags[page & (MEMORY_PAGE_COUNT - 1)] & Page_Decoded;
+        cpu->page_flags[page & (MEMORY_PAGE_COUNT - 1)] |= PAGE_DIRTY_ALL;
+    }
+
+    // The written bytes can be code which was already executed
+    if (decoded) {
+        micro_op_cache_invalidate(cpu, address, size);
+    }
+}
+
 
 #endif
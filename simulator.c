@@ -1,6 +1,18 @@
 #include "simulator.h"
 #include "decoder.h"
 #include "printer.h"
+#include "heatmap.h"
+#include "profiler.h"
+#include "port_io.h"
+#include "debugger.h"
+#include "gdbstub.h"
+#include "replay.h"
+#include "guest_memory.h"
+#include "fuzzer.h"
+#include "live_view.h"
+#include "dump.h"
+#include "disassembler.h"
+#include "micro_op.h"
 
 #include <time.h>
 #include <sys/timeb.h>
@@ -18,6 +30,16 @@
 #define MASK_BY_WIDTH(__wide) (__wide ? 0xffff : 0xff)
 #define SEGMENT_MASK 0xFFFFF // 20bit
 
+// The execution trace, silenced by --quiet and while the replay re-executes the history
+#define TRACE(_cpu, ...) do { if (!(_cpu)->quiet) printf(__VA_ARGS__); } while (0)
+
+// Evaluates to the branch decision, the fuzzing build counts it as a coverage edge too
+#ifdef FUZZ_ENABLED
+#define BRANCH(_cpu, _taken) coverage_branch((_cpu), (_taken))
+#else
+#define BRANCH(_cpu, _taken) (_taken)
+#endif
+
 // @Cleanup: remove this register_access mess
 u16 get_data_from_register(CPU *cpu, Register_Access *src_reg)
 {
@@ -35,7 +57,7 @@ void set_data_to_register(CPU *cpu, Register_Access *dest_reg, u16 data)
 {
     // @Debug
     u16 current_data = get_data_from_register(cpu, dest_reg);
-    printf(" \n\t\t@%s: %#02x -> %#02x ", register_name(dest_reg->reg), current_data, data);
+    TRACE(cpu, " \n\t\t@%s: %#02x -> %#02x ", register_name(dest_reg->reg), current_data, data);
 
     u16 index = dest_reg->index;
     if (dest_reg->size == 2) {
@@ -107,7 +129,9 @@ u32 calc_absolute_memory_address(CPU *cpu, Effective_Address_Expression *expr)
             assert(0);
     }
 
-    u32 result = ((segment << 4) + address + expr->displacement) & mask;
+    // The offset wraps around in 16 bits, the displacement can be negative
+    u16 offset = address + expr->displacement;
+    u32 result = ((segment << 4) + offset) & mask;
 
     //printf("\n\t\t*[%#02x]", result);
     return result;
@@ -129,10 +153,9 @@ u32 calc_stack_pointer_address(CPU *cpu)
     return (((segment << 4) + offset)) & SEGMENT_MASK;
 }
 
-u16 get_data_from_memory(CPU *cpu, u32 address)
+// Reads the memory without counting it as a guest access
+static u16 peek_data_from_memory(CPU *cpu, u32 address)
 {
-    address = address & SEGMENT_MASK;
-
     if (cpu->instruction.flags & Inst_Wide) {
         u16 data = *(u16 *)(cpu->memory+address);
         return BYTE_SWAP(data);
@@ -141,13 +164,43 @@ u16 get_data_from_memory(CPU *cpu, u32 address)
     return cpu->memory[address];
 }
 
+u16 get_data_from_memory(CPU *cpu, u32 address)
+{
+    address = address & SEGMENT_MASK;
+
+    u32 size = (cpu->instruction.flags & Inst_Wide) ? 2 : 1;
+    cpu->stats.memory_reads += size;
+
+    if (cpu->heatmap && replay_is_live(cpu)) {
+        heatmap_count(cpu->heatmap, Heatmap_Read, address, size);
+    }
+
+    if (cpu->page_flags[address >> MEMORY_PAGE_SHIFT] & Page_Watch_Read) {
+        debugger_check_watch(cpu, address, size, Page_Watch_Read);
+    }
+
+    return peek_data_from_memory(cpu, address);
+}
+
 void set_data_to_memory(CPU *cpu, u32 address, u16 data)
 {
     address = address & SEGMENT_MASK; 
     
     // @Todo: @Debug: Print out the memory address in this format 0000:0xFFF, so with the segment and the offset
-    u16 current_data = get_data_from_memory(cpu, address); // @Debug
-    printf("\n\t\t[%d]: %#02x -> %#02x", address, current_data, data);
+    u16 current_data = peek_data_from_memory(cpu, address); // @Debug
+    TRACE(cpu, "\n\t\t[%d]: %#02x -> %#02x", address, current_data, data);
+
+    u32 size = (cpu->instruction.flags & Inst_Wide) ? 2 : 1;
+    cpu->stats.memory_writes += size;
+    mark_memory_dirty(cpu, address, size);
+
+    if (cpu->heatmap && replay_is_live(cpu)) {
+        heatmap_count(cpu->heatmap, Heatmap_Write, address, size);
+    }
+
+    if (cpu->page_flags[address >> MEMORY_PAGE_SHIFT] & Page_Watch_Write) {
+        debugger_check_watch(cpu, address, size, Page_Watch_Write);
+    }
 
     if (cpu->instruction.flags & Inst_Wide) {
         *(u16 *)(cpu->memory+address) = BYTE_SWAP(data);
@@ -226,7 +279,9 @@ void stack_pop_flags(CPU *cpu)
     cpu->flags = 0;
     cpu->flags |= stack_pop(cpu);
 
-    print_out_formated_flags(old_flags, cpu->flags);
+    if (!cpu->quiet) {
+        print_out_formated_flags(old_flags, cpu->flags);
+    }
 }
 
 void execute_interrupt(CPU *cpu, u16 interrupt_type)
@@ -246,12 +301,13 @@ void execute_interrupt(CPU *cpu, u16 interrupt_type)
     set_to_register(cpu, Register_cs, cs_val);
 }
 
-void update_parity_flag(CPU *cpu, u32 result)
+// The flags by an explicit width, the micro-ops have no cpu->instruction to take it from
+static void set_parity_flag(CPU *cpu, u32 result, u8 is_wide)
 {
     cpu->flags &= ~(F_PARITY);
 
     u8 ones = 0;
-    u8 size = (cpu->instruction.flags & Inst_Wide) ? 16 : 8;
+    u8 size = is_wide ? 16 : 8;
     for (u8 i = 0; i < size; i++) {
         if (result & (1<<i)) ones++;
     }
@@ -259,9 +315,8 @@ void update_parity_flag(CPU *cpu, u32 result)
     cpu->flags |= ((ones % 2) == 0) ? F_PARITY : 0;
 }
 
-void update_common_flags(CPU *cpu, u32 result)
+static void set_common_flags(CPU *cpu, u32 result, u8 is_wide)
 {
-    u8 is_wide = cpu->instruction.flags & Inst_Wide;
     u32 sign_bit = SIGN_BIT(is_wide);
 
     cpu->flags &= (~(F_SIGNED|F_ZERO));
@@ -269,7 +324,30 @@ void update_common_flags(CPU *cpu, u32 result)
     cpu->flags |= (result & sign_bit ? F_SIGNED : 0);
     cpu->flags |= (result & MASK_BY_WIDTH(is_wide)) == 0 ? F_ZERO : 0;
 
-    update_parity_flag(cpu, result);
+    set_parity_flag(cpu, result, is_wide);
+}
+
+static void set_arith_flags(CPU *cpu, u32 result, u32 OF, u32 AF, u8 is_wide)
+{
+    u32 sign_bit = SIGN_BIT(is_wide);
+    u32 CF = result & (sign_bit << 1);
+
+    cpu->flags &= (~(F_CARRY|F_OVERFLOW|F_AUXILIARY));
+    cpu->flags |= CF ? F_CARRY : 0;
+    cpu->flags |= OF ? F_OVERFLOW : 0;
+    cpu->flags |= AF ? F_AUXILIARY : 0;
+
+    set_common_flags(cpu, result, is_wide);
+}
+
+void update_parity_flag(CPU *cpu, u32 result)
+{
+    set_parity_flag(cpu, result, cpu->instruction.flags & Inst_Wide);
+}
+
+void update_common_flags(CPU *cpu, u32 result)
+{
+    set_common_flags(cpu, result, cpu->instruction.flags & Inst_Wide);
 }
 
 void update_log_flags(CPU *cpu, u32 result)
@@ -282,17 +360,29 @@ void update_arith_flags(CPU *cpu, u32 result, u32 OF, u32 AF)
 {
     u32 flags_before = cpu->flags;
 
-    u32 sign_bit = SIGN_BIT(cpu->instruction.flags & Inst_Wide);
-    u32 CF = result & (sign_bit << 1);
+    set_arith_flags(cpu, result, OF, AF, cpu->instruction.flags & Inst_Wide);
 
-    cpu->flags &= (~(F_CARRY|F_OVERFLOW|F_AUXILIARY));
-    cpu->flags |= CF ? F_CARRY : 0;
-    cpu->flags |= OF ? F_OVERFLOW : 0;
-    cpu->flags |= AF ? F_AUXILIARY : 0;
+    if (!cpu->quiet) {
+        print_out_formated_flags(flags_before, cpu->flags);
+    }
+}
 
-    update_common_flags(cpu, result);
+const char *cpu_fault_name(Cpu_Fault fault)
+{
+    switch (fault) {
+        case Cpu_Fault_None:          return "none";
+        case Cpu_Fault_Divide:        return "divide by zero";
+        case Cpu_Fault_Unimplemented: return "unimplemented instruction";
+    }
 
-    print_out_formated_flags(flags_before, cpu->flags);
+    return "???";
+}
+
+// Stops the machine before the instruction, like the unhandled ones, instead of taking down the host
+static void raise_fault(CPU *cpu, Cpu_Fault fault)
+{
+    cpu->fault = fault;
+    cpu->terminate = 1;
 }
 
 void execute_instruction(CPU *cpu)
@@ -303,7 +393,12 @@ void execute_instruction(CPU *cpu)
     Instruction_Operand *left_op  = &i->operands[0];
     Instruction_Operand *right_op = &i->operands[1];
 
-    s32 left_val  = get_from_operand(cpu, left_op);
+    // The destination of a mov/pop is never read, fetching it anyway would show up as
+    // a phantom memory read on the heatmap.
+    s32 left_val = 0;
+    if (i->mnemonic != Mneumonic_mov && i->mnemonic != Mneumonic_pop) {
+        left_val = get_from_operand(cpu, left_op);
+    }
     s32 right_val = get_from_operand(cpu, right_op);
 
     u32 sign_bit = SIGN_BIT(is_wide);
@@ -366,7 +461,8 @@ void execute_instruction(CPU *cpu)
             
             if (divisior == 0) {
                 // @Todo: execute an interrupt? @Incomplete
-                assert(0);
+                raise_fault(cpu, Cpu_Fault_Divide);
+                return;
             } 
 
             if (is_wide) {
@@ -440,14 +536,17 @@ void execute_instruction(CPU *cpu)
         }
         // :Flow
         case Mneumonic_jmp: {
-            assert(!(i->flags & Inst_Far)); // @Todo: Unimplemented
+            if (i->flags & Inst_Far) {
+                raise_fault(cpu, Cpu_Fault_Unimplemented); // @Todo
+                return;
+            }
             ip_after += i->operands[0].immediate;
             break;
         }
         case Mneumonic_jl: {
             u8 SF = !!(cpu->flags & F_SIGNED);
             u8 OF = !!(cpu->flags & F_OVERFLOW);
-            if (SF ^ OF) {
+            if (BRANCH(cpu, SF ^ OF)) {
                 ip_after += i->operands[0].immediate;
             }
             break;
@@ -456,24 +555,24 @@ void execute_instruction(CPU *cpu)
             u8 SF = !!(cpu->flags & F_SIGNED);
             u8 OF = !!(cpu->flags & F_OVERFLOW);
             u8 ZF = !!(cpu->flags & F_ZERO);
-            if (((SF ^ OF) | ZF) == 1) {
+            if (BRANCH(cpu, ((SF ^ OF) | ZF) == 1)) {
                 ip_after += i->operands[0].immediate;
             }
         }
         case Mneumonic_jz: {
-            if (cpu->flags & F_ZERO) {
+            if (BRANCH(cpu, (cpu->flags & F_ZERO) != 0)) {
                 ip_after += i->operands[0].immediate;
             }
             break;
         }
         case Mneumonic_jnz: {
-            if (!(cpu->flags & F_ZERO)) {
+            if (BRANCH(cpu, !(cpu->flags & F_ZERO))) {
                 ip_after += i->operands[0].immediate;
             }
             break;
         }
         case Mneumonic_ja: {
-            if (!(cpu->flags & F_ZERO) && !(cpu->flags & F_CARRY)) {
+            if (BRANCH(cpu, !(cpu->flags & F_ZERO) && !(cpu->flags & F_CARRY))) {
                 ip_after += i->operands[0].immediate;
             }
             break;
@@ -483,7 +582,7 @@ void execute_instruction(CPU *cpu)
             cx_data -= 1;
             set_to_register(cpu, Register_cx, cx_data);
 
-            if (cx_data != 0) {
+            if (BRANCH(cpu, cx_data != 0)) {
                 ip_after += i->operands[0].immediate;
             }
 
@@ -562,7 +661,10 @@ void execute_instruction(CPU *cpu)
         case Mneumonic_stosw: {
             // @Todo: Repeat if the repeat Prefix (REP/REPE/REPZ or REPNE/REPNZ)
             //  (repeated based on the value in the CX register)
-            assert(!(i->flags & Inst_Repnz)); // @Todo
+            if (i->flags & Inst_Repnz) {
+                raise_fault(cpu, Cpu_Fault_Unimplemented); // @Todo
+                return;
+            }
 
             u16 cx = 1;
             if (i->flags & Inst_Repz) {
@@ -594,7 +696,10 @@ void execute_instruction(CPU *cpu)
         case Mneumonic_stosb: {
             // @Todo: Repeat if the repeat Prefix (REP/REPE/REPZ or REPNE/REPNZ)
             //  (repeated based on the value in the CX register)
-            assert(!(i->flags & Inst_Repnz)); // @Todo
+            if (i->flags & Inst_Repnz) {
+                raise_fault(cpu, Cpu_Fault_Unimplemented); // @Todo
+                return;
+            }
 
             u16 cx = 1;
             if (i->flags & Inst_Repz) {
@@ -628,13 +733,27 @@ void execute_instruction(CPU *cpu)
             u16 port = left_val;
             u16 data = right_val;
 
-            // @Debug
-            fprintf(cpu->out, "%d : %d\n", port, data);
-        
+            // The replay doesn't repeat the side effects of the already executed instructions
+            if (!replay_is_live(cpu)) {
+                break;
+            }
+
+            // The instruction is marked as wide by the dx port operand too, the size comes from the accumulator
+            port_write(cpu, port, data, (right_op->flags & Inst_Wide) ? 1 : 0);
+
+            break;
+        }
+        case Mneumonic_in: {
+            u16 port = right_val;
+            u8 wide = (left_op->flags & Inst_Wide) ? 1 : 0;
+            u16 data = cpu->replay ? replay_port_read(cpu, port, wide) : port_read(cpu, port, wide);
+
+            set_to_operand(cpu, left_op, data);
+
             break;
         }
         default: {
-            printf("\n[WARNING]: This instruction: %s is not handled yet!\n", mnemonic_name(i->mnemonic));
+            TRACE(cpu, "\n[WARNING]: This instruction: %s is not handled yet!\n", mnemonic_name(i->mnemonic));
             cpu->terminate = 1; // @Temporary
         }
     }
@@ -646,8 +765,20 @@ void execute_instruction(CPU *cpu)
     ip_after += i->size;
     cpu->ip = ip_after;
 
-    printf("\n\t\t@ip: %#02x -> %#02x\n", ip_before, cpu->ip);
-    printf("\n");
+    TRACE(cpu, "\n\t\t@ip: %#02x -> %#02x\n", ip_before, cpu->ip);
+    TRACE(cpu, "\n");
+}
+
+// The program is already copied to cs:ip
+static void loaded_executable(CPU *cpu, u32 size)
+{
+    u32 inst_absolute_address = calc_inst_pointer_address(cpu);
+    if (size) {
+        mark_memory_dirty(cpu, inst_absolute_address, size);
+    }
+
+    cpu->loaded_executable_size = size;
+    cpu->exec_end = inst_absolute_address + size;
 }
 
 void load_executable(CPU *cpu, char *filename)
@@ -668,22 +799,65 @@ void load_executable(CPU *cpu, char *filename)
     fread(&cpu->memory[inst_absolute_address], fsize, 1, fp);
     fclose(fp);
 
-    cpu->loaded_executable_size = fsize;
-    cpu->exec_end = inst_absolute_address + fsize;
+    loaded_executable(cpu, fsize);
 }
 
+void load_executable_from_memory(CPU *cpu, const u8 *data, u32 size)
+{
+    assert(size+1 <= MAX_MEMORY);
+
+    u32 inst_absolute_address = calc_inst_pointer_address(cpu);
+    memcpy(&cpu->memory[inst_absolute_address], data, size);
+
+    loaded_executable(cpu, size);
+}
+
+// The memory comes from the live view or the pool of the cpu if it has one. Booting again resets the memory in place.
 void boot(CPU *cpu)
 {
-    cpu->memory = (u8*)malloc(MAX_MEMORY);
-    ZERO_MEMORY(cpu->memory, MAX_MEMORY);
+    if (cpu->memory == NULL && cpu->live_view) {
+        cpu->memory = cpu->live_view->memory;
+    } else if (cpu->memory == NULL) {
+        cpu->memory = cpu->memory_pool ? memory_pool_acquire(cpu->memory_pool) : memory_map();
+    } else {
+        memory_reset(cpu->memory, cpu->page_flags, cpu->live_view != NULL);
+    }
+
+    if (cpu->micro_ops) {
+        micro_op_cache_flush(cpu);
+    } else if (!cpu->no_micro_op_cache) {
+        cpu->micro_ops = micro_op_cache_create();
+    }
+
     ZERO_MEMORY(cpu->regmem, 64);
+    cpu->flags = 0;
+    cpu->terminate = 0;
+    cpu->fault = Cpu_Fault_None;
+    ZERO_MEMORY(&cpu->stats, sizeof(cpu->stats));
 
     // @Cleanup: This is a little-bit wierdo, two different register set
     set_to_register(cpu, Register_cs, 0xf000);
-    printf("\n");
+    TRACE(cpu, "\n");
     cpu->ip = 0x0100;
 }
 
+// The memory of a live view is left to the view
+void power_off(CPU *cpu)
+{
+    if (cpu->memory_pool && cpu->live_view == NULL) {
+        memory_pool_release(cpu->memory_pool, cpu->memory, cpu->page_flags);
+    } else if (cpu->live_view == NULL) {
+        memory_unmap(cpu->memory);
+    }
+
+    cpu->memory = NULL;
+
+    if (cpu->micro_ops) {
+        micro_op_cache_destroy(cpu->micro_ops);
+        cpu->micro_ops = NULL;
+    }
+}
+
 #ifdef GRAPHICS_ENABLED
 void swapFramebufferVertically(u16* framebuffer, int width, int height) {
     int rowSize = width * sizeof(u16);
@@ -705,12 +879,237 @@ void swapFramebufferVertically(u16* framebuffer, int width, int height) {
 }
 #endif
 
+// The value of a register, an immediate or a relative operand of the micro-op
+static s32 micro_op_value(CPU *cpu, const Micro_Op *op, u32 index)
+{
+    u32 kind = MICRO_OP_KIND(op, index);
+
+    if ((kind & ~MICRO_OP_UNSIGNED) == Operand_Register) {
+        Register_Access *reg = register_access(op->slots[index], (op->operand_flags >> (index * 2)) & Inst_Wide);
+        return get_data_from_register(cpu, reg);
+    }
+
+    return (kind & MICRO_OP_UNSIGNED) ? (u16)op->values[index] : op->values[index];
+}
+
+// Executes the register and immediate forms of the hot instructions straight from the
+// micro-op, the same way execute_instruction() does, and returns their cycles. Returns 0
+// without touching the cpu for the rest, those are unpacked into cpu->instruction.
+// The trace is printed from the Instruction, so this only runs quiet.
+static u32 execute_micro_op(CPU *cpu, const Micro_Op *op, u32 address)
+{
+    if (op->flags & ~(Inst_Wide|Inst_Sign)) {
+        return 0;
+    }
+
+    u32 left_kind  = MICRO_OP_KIND(op, 0) & ~MICRO_OP_UNSIGNED;
+    u32 right_kind = MICRO_OP_KIND(op, 1) & ~MICRO_OP_UNSIGNED;
+    u8 right_imm = right_kind == Operand_Immediate;
+    u8 is_wide = (op->flags & Inst_Wide) ? 1 : 0;
+
+    // A general register destination, a register or an immediate source
+    u8 register_form = left_kind == Operand_Register && !(op->operand_flags & Inst_Segment) &&
+        (right_imm || (right_kind == Operand_Register && !(op->operand_flags & (Inst_Segment << 2))));
+    u8 relative_form = left_kind == Operand_Relative_Immediate && right_kind == Operand_None;
+
+    u32 sign_bit = SIGN_BIT(is_wide);
+    u32 mask = MASK_BY_WIDTH(is_wide);
+    u32 ip_after = cpu->ip + op->length;
+    u32 cycles = 0;
+    u8 taken = 0;
+
+#ifdef FUZZ_ENABLED
+    // The coverage edge of the branch is keyed by the instruction address
+    cpu->instruction.mem_address = address + op->prefix_length;
+#endif
+
+    switch (op->mnemonic) {
+        case Mneumonic_mov: {
+            if (!register_form) return 0;
+            s32 right_val = micro_op_value(cpu, op, 1);
+            set_data_to_register(cpu, register_access(op->slots[0], op->operand_flags & Inst_Wide), right_val);
+            cycles = right_imm ? 4 : 2;
+            break;
+        }
+        case Mneumonic_add:
+        case Mneumonic_sub:
+        case Mneumonic_cmp: {
+            if (!register_form) return 0;
+            Register_Access *left_reg = register_access(op->slots[0], op->operand_flags & Inst_Wide);
+            s32 left_val = get_data_from_register(cpu, left_reg);
+            s32 right_val = (u16)micro_op_value(cpu, op, 1);
+
+            u32 result, OF, AF;
+            if (op->mnemonic == Mneumonic_add) {
+                result = (left_val & mask) + (right_val & mask);
+                OF = (~(left_val ^ right_val) & (left_val ^ result)) & sign_bit;
+                AF = ((left_val & 0xf) + (right_val & 0xf)) & 0x10;
+            } else {
+                result = left_val - right_val;
+                OF = ((left_val ^ right_val) & (left_val ^ result)) & sign_bit;
+                AF = ((left_val & 0xf) - (right_val & 0xf)) & 0x10;
+            }
+
+            set_arith_flags(cpu, result, OF, AF, is_wide);
+            if (op->mnemonic != Mneumonic_cmp) {
+                set_data_to_register(cpu, left_reg, result);
+            }
+            cycles = right_imm ? 4 : 3;
+            break;
+        }
+        case Mneumonic_inc:
+        case Mneumonic_dec: {
+            if (left_kind != Operand_Register || right_kind != Operand_None || (op->operand_flags & Inst_Segment)) return 0;
+            Register_Access *left_reg = register_access(op->slots[0], op->operand_flags & Inst_Wide);
+            u32 result = get_data_from_register(cpu, left_reg) + (op->mnemonic == Mneumonic_inc ? 1 : -1);
+
+            set_data_to_register(cpu, left_reg, result);
+            set_arith_flags(cpu, result, 0, 0, is_wide);
+            cycles = is_wide ? 2 : 3;
+            break;
+        }
+        case Mneumonic_jmp: {
+            if (!relative_form) return 0;
+            ip_after += micro_op_value(cpu, op, 0);
+            cycles = 15;
+            break;
+        }
+        case Mneumonic_jz:
+        case Mneumonic_jnz:
+        case Mneumonic_ja:
+        case Mneumonic_jl: {
+            if (!relative_form) return 0;
+            u8 condition = 0;
+            switch (op->mnemonic) {
+                case Mneumonic_jz:  condition = (cpu->flags & F_ZERO) != 0; break;
+                case Mneumonic_jnz: condition = !(cpu->flags & F_ZERO); break;
+                case Mneumonic_ja:  condition = !(cpu->flags & F_ZERO) && !(cpu->flags & F_CARRY); break;
+                default:            condition = !!(cpu->flags & F_SIGNED) ^ !!(cpu->flags & F_OVERFLOW); break;
+            }
+            if (BRANCH(cpu, condition)) {
+                ip_after += micro_op_value(cpu, op, 0);
+            }
+            taken = 1;
+            break;
+        }
+        case Mneumonic_loop: {
+            if (!relative_form) return 0;
+            u16 cx_data = get_from_register(cpu, Register_cx) - 1;
+            set_to_register(cpu, Register_cx, cx_data);
+
+            if (BRANCH(cpu, cx_data != 0)) {
+                ip_after += micro_op_value(cpu, op, 0);
+            }
+            taken = 1;
+            break;
+        }
+        default: {
+            return 0;
+        }
+    }
+
+    cpu->ip = ip_after;
+
+    // Taken like in step_instruction(), by the next address
+    if (taken) {
+        taken = calc_inst_pointer_address(cpu) != address + op->length;
+        cycles = op->mnemonic == Mneumonic_loop ? (taken ? 17 : 5) : (taken ? 16 : 4);
+    }
+
+    return cycles;
+}
+
+// Counts the executed instruction, for both paths of step_instruction()
+static void step_finished(CPU *cpu)
+{
+    cpu->stats.instructions++;
+
+    if (cpu->live_view && (cpu->stats.instructions % LIVE_VIEW_PUBLISH_INTERVAL) == 0) {
+        live_view_publish(cpu, Live_View_Running);
+    }
+
+    // The replay re-executes the history, that was already dumped
+    if (cpu->dump && cpu->stats.instructions >= cpu->dump->next_at && replay_is_live(cpu)) {
+        memory_dump_frame(cpu, cpu->dump, 0);
+    }
+}
+
+// Decodes and executes the instruction at cs:ip together with its prefixes
+void step_instruction(CPU *cpu)
+{
+    if (cpu->replay) {
+        replay_before_step(cpu);
+    }
+
+    u32 address = calc_inst_pointer_address(cpu);
+    const Micro_Op *op = cpu->micro_ops ? micro_op_cache_lookup(cpu->micro_ops, address) : NULL;
+
+    if (op && cpu->quiet) {
+        u32 cycles = execute_micro_op(cpu, op, address);
+        if (cycles) {
+            if (cpu->heatmap && replay_is_live(cpu)) {
+                heatmap_count(cpu->heatmap, Heatmap_Exec, address + op->prefix_length, op->length - op->prefix_length);
+            }
+
+            cpu->stats.cycles += cycles;
+            step_finished(cpu);
+            return;
+        }
+    }
+
+    if (op) {
+        micro_op_unpack(&cpu->instruction, op, address);
+    } else {
+        decode_next_instruction(cpu);
+
+        if (cpu->micro_ops) {
+            micro_op_cache_store(cpu, address);
+        }
+    }
+
+    // The ip steps over the prefixes here, the execution adds the size of the instruction
+    cpu->ip += cpu->instruction.mem_address - address;
+
+    if (cpu->heatmap && replay_is_live(cpu)) {
+        heatmap_count(cpu->heatmap, Heatmap_Exec, cpu->instruction.mem_address, cpu->instruction.size);
+    }
+
+    u32 next_address = cpu->instruction.mem_address + cpu->instruction.size;
+    u16 repetitions = 0;
+    if (cpu->instruction.flags & (Inst_Repz|Inst_Repnz)) {
+        repetitions = get_from_register(cpu, Register_cx);
+    }
+
+    if (!cpu->quiet) {
+        print_instruction(cpu, 0);
+    }
+    execute_instruction(cpu);
+
+    // The faulting instruction is not executed, the ip is still at its prefixes
+    if (cpu->fault) {
+        cpu->ip -= cpu->instruction.mem_address - address;
+        return;
+    }
+
+    u8 branch_taken = calc_inst_pointer_address(cpu) != next_address;
+    cpu->stats.cycles += instruction_cycles(&cpu->instruction, branch_taken, repetitions);
+    step_finished(cpu);
+}
+
 void run(CPU *cpu)
 {
-    char input[128] = {0};
+    if (cpu->decode_only == Decode_Recursive) {
+        Disassembly *disassembly = disassembly_create(cpu);
+        disassembly_print(cpu, disassembly);
+        disassembly_destroy(disassembly);
+        return;
+    }
 
-    if (cpu->decode_only) {
-        printf("bits 16\n\n");
+    // The linear decode takes the DW and DB data for code too, the recursive one follows the
+    // jumps and prints the bytes it never reaches as data
+    if (cpu->decode_only == Decode_Linear) {
+        disassembly_print_linear(cpu, cpu->decode_threads ? cpu->decode_threads : 1);
+        return;
     }
 
 #ifdef GRAPHICS_ENABLED
@@ -744,55 +1143,24 @@ void run(CPU *cpu)
 
     do {
         timer++;
-        decode_next_instruction(cpu);
 
-        // @Todo: The i8086 contains the debug flag so later we simulate this too
-        // instead of this boolean
-        if (cpu->debug_mode) {
-            //printf(">> Press enter to the next instruction\n");
-__de:;
-            fgets(input, sizeof(input), stdin);
-            if (STR_EQUAL("exit\n", input) || input[0] == 'q') {
-                return;
-            }
-            if (input[0] != '\n') {
-                goto __de;
-            }
+        if (cpu->max_instructions && cpu->stats.instructions >= cpu->max_instructions) {
+            return;
         }
 
-        if (cpu->instruction.is_prefix) {
-            // If we have a prefix, then we don't want to run or print it. We will print at at the next
-            // instruction decode, because we're using the nasm syntax.
-
-            // This is a special case, the cpu->decoder_cursor have an absolute address, so we have to "reverse" this absolute address
-            // which are calculated with the segment register and the instruction pointer (ip) register offset.
-            u16 cs_segment = get_from_register(cpu, Register_cs);
-            cpu->ip = cpu->decoder_cursor - (cs_segment << 4);
-
-            continue;
+        // @Todo: The i8086 contains the trap flag so later we simulate this too
+        if (cpu->debugger && debugger_should_stop(cpu->debugger, calc_inst_pointer_address(cpu))) {
+            u8 keep_running = cpu->gdb ? gdb_stub_stop(cpu) : debugger_prompt(cpu);
+            if (!keep_running) {
+                return;
+            }
         }
 
-        if (cpu->decode_only) {
-            // We have to update this "manually", because here we only printing and not executing, so the ip won't update!
-            // @Incomplete: The problem will appear if the in the instruction the DW or DB directive is defined, because those
-            // just raw memory but we must guess somehow which is code and which is just raw data. Maybe we can make context analysis,
-            // example, check which segment of the code won't run in any case, maybe we check the jmp instructions for this at first.
-
-            // This is a special case, the cpu->decoder_cursor have an absolute address, so we have to "reverse" this absolute address
-            // which are calculated with the segment register and the instruction pointer (ip) register offset.
-            u16 cs_segment = get_from_register(cpu, Register_cs);
-            cpu->ip = cpu->decoder_cursor - (cs_segment << 4);
-
-            print_instruction(cpu, 1);
+        step_instruction(cpu);
 
-        } else {
-            print_instruction(cpu, 0);
-            execute_instruction(cpu);
-
-            // @Temporary
-            if (cpu->terminate) {
-                return;
-            }
+        // @Temporary
+        if (cpu->terminate) {
+            return;
         }
 
 #ifdef GRAPHICS_ENABLED
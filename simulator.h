@@ -7,9 +7,14 @@ u32 calc_inst_pointer_address(CPU *cpu);
 u32 calc_stack_pointer_address(CPU *cpu);
 
 u16 get_data_from_register(CPU *cpu, Register_Access *src_reg);
+void set_data_to_register(CPU *cpu, Register_Access *dest_reg, u16 data);
 
 void load_executable(CPU *cpu, char *filename);
+void load_executable_from_memory(CPU *cpu, const u8 *data, u32 size);
 void boot(CPU *cpu);
+void power_off(CPU *cpu);
+void step_instruction(CPU *cpu);
+const char *cpu_fault_name(Cpu_Fault fault);
 void run(CPU *cpu);
 
 #endif
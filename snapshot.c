@@ -0,0 +1,118 @@
+#include "snapshot.h"
+#include "port_io.h"
+#include "guest_memory.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+void snapshot_save(CPU *cpu, const char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        printf("\n[ERROR]: Failed to open %s for the machine state.\n", filename);
+        return;
+    }
+
+    static_assert(sizeof(Snapshot_Header) <= SNAPSHOT_HEADER_SIZE, "the snapshot header doesn't fit");
+
+    u8 *header_page = (u8 *)calloc(1, SNAPSHOT_HEADER_SIZE + SNAPSHOT_TAIL_SIZE);
+    assert(header_page != NULL);
+
+    Snapshot_Header *header = (Snapshot_Header *)header_page;
+    memcpy(header->magic, SNAPSHOT_FILE_MAGIC, sizeof(header->magic));
+    header->version = SNAPSHOT_FILE_VERSION;
+    header->header_size = SNAPSHOT_HEADER_SIZE;
+    header->memory_offset = SNAPSHOT_HEADER_SIZE;
+    header->memory_size = MAX_MEMORY;
+
+    header->ip = cpu->ip;
+    header->flags = cpu->flags;
+    memcpy(header->regmem, cpu->regmem, sizeof(header->regmem));
+    header->terminate = cpu->terminate;
+    header->fault = cpu->fault;
+    header->exec_end = cpu->exec_end;
+    header->loaded_executable_size = cpu->loaded_executable_size;
+    header->stats = cpu->stats;
+
+    header->port_input_cursor = cpu->io->input_cursor;
+
+    fwrite(header_page, 1, SNAPSHOT_HEADER_SIZE, fp);
+    fwrite(cpu->memory, 1, MAX_MEMORY, fp);
+
+    // The tail is zeroes, the start of the header page was only needed for the header
+    ZERO_MEMORY(header_page, SNAPSHOT_TAIL_SIZE);
+    fwrite(header_page, 1, SNAPSHOT_TAIL_SIZE, fp);
+
+    free(header_page);
+    fclose(fp);
+}
+
+void snapshot_load(CPU *cpu, const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        printf("\n[ERROR]: Failed to open %s file. Probably it is not exists.\n", filename);
+        assert(0);
+    }
+
+    Snapshot_Header header = {0};
+    if (fread(&header, sizeof(header), 1, fp) != 1 || fseek(fp, 0, SEEK_END) != 0) {
+        printf("\n[ERROR]: Failed to read the machine state from %s.\n", filename);
+        assert(0);
+    }
+    long stored_size = ftell(fp);
+
+    if (memcmp(header.magic, SNAPSHOT_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_FILE_VERSION) {
+        printf("\n[ERROR]: %s is not a version %d machine state file.\n", filename, SNAPSHOT_FILE_VERSION);
+        assert(0);
+    }
+
+    static_assert(MAX_MEMORY + SNAPSHOT_TAIL_SIZE == GUEST_MEMORY_SIZE, "the snapshot tail has to cover the guest memory tail");
+
+    u32 file_size = header.memory_offset + header.memory_size + SNAPSHOT_TAIL_SIZE;
+    if (header.memory_size != MAX_MEMORY || (header.memory_offset % MEMORY_PAGE_SIZE) != 0 || stored_size < (long)file_size) {
+        printf("\n[ERROR]: The machine state in %s is truncated or has a different memory layout.\n", filename);
+        assert(0);
+    }
+
+#ifdef _WIN32
+    // No file mappings, the memory is read in
+    u8 map_memory = 0;
+#else
+    // A mapping would replace the shared memory, the other processes have to see the loaded state
+    u8 map_memory = cpu->live_view == NULL;
+#endif
+
+    if (map_memory) {
+#ifndef _WIN32
+        // Private mapping over the booted memory: the pages are read in on the first access and
+        // copied on the first write. The cpu still owns the same address range, power_off() and
+        // the memory reset handle it like any other guest memory.
+        void *mapping = mmap(cpu->memory, GUEST_MEMORY_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, fileno(fp), header.memory_offset);
+        if (mapping == MAP_FAILED) {
+            printf("\n[ERROR]: Failed to map %s.\n", filename);
+            assert(0);
+        }
+#endif
+    } else {
+        if (fseek(fp, header.memory_offset, SEEK_SET) != 0 || fread(cpu->memory, 1, GUEST_MEMORY_SIZE, fp) != GUEST_MEMORY_SIZE) {
+            printf("\n[ERROR]: Failed to read the memory from %s.\n", filename);
+            assert(0);
+        }
+    }
+    fclose(fp);
+
+    cpu->ip = header.ip;
+    cpu->flags = header.flags;
+    memcpy(cpu->regmem, header.regmem, sizeof(cpu->regmem));
+    cpu->terminate = header.terminate;
+    cpu->fault = header.fault;
+    cpu->exec_end = header.exec_end;
+    cpu->loaded_executable_size = header.loaded_executable_size;
+    cpu->stats = header.stats;
+
+    cpu->io->input_cursor = header.port_input_cursor;
+
+    mark_memory_dirty(cpu, 0, MAX_MEMORY);
+}
@@ -0,0 +1,50 @@
+#ifndef _H_SNAPSHOT
+#define _H_SNAPSHOT
+
+#include "sim86.h"
+
+// Whole machine state file, written by --save-state and restored by --load-state.
+//
+// Layout (native endian):
+//   Snapshot_Header, zero padded to SNAPSHOT_HEADER_SIZE
+//   u8 memory[MAX_MEMORY]         at header.memory_offset
+//   SNAPSHOT_TAIL_SIZE zero bytes
+//
+// The memory starts on a page boundary, so the loader maps the file with MAP_PRIVATE and
+// uses the mapping as the guest memory directly. Restoring costs page faults on the touched
+// pages instead of reading the whole megabyte, and the writes of the guest never reach the file.
+#define SNAPSHOT_FILE_MAGIC "S86STATE"
+#define SNAPSHOT_FILE_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 4096
+
+// A word access at the last address spills one byte past the memory, the same as with the
+// malloc'd memory, so the mapping has to be a little bigger than the guest memory.
+#define SNAPSHOT_TAIL_SIZE MEMORY_PAGE_SIZE
+
+typedef struct {
+    char magic[8];
+    u32 version;
+    u32 header_size;
+    u32 memory_offset;
+    u32 memory_size;
+
+    // CPU
+    u16 ip;
+    u16 flags;
+    u8 regmem[64];
+    u8 terminate;
+    u8 fault; // in the padding after terminate, the older files have 0 there
+    u32 exec_end;
+    u32 loaded_executable_size;
+    Cpu_Stats stats;
+
+    // Devices
+    u32 port_input_cursor; // the input stream itself has to be given again with --port-in
+} Snapshot_Header;
+
+void snapshot_save(CPU *cpu, const char *filename);
+
+// Maps the file over the memory of the booted cpu
+void snapshot_load(CPU *cpu, const char *filename);
+
+#endif
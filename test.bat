@@ -1,4 +1,4 @@
 @echo off 
 
 call .\build.bat
-.\build.\sim86.exe input\listing_0042_completionist_decode --decode
\ No newline at end of file
+.\build.\sim86.exe input\listing_0042_completionist_decode --decode-linear
\ No newline at end of file
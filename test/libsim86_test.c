@@ -0,0 +1,90 @@
+// Host test of the embeddable library, run by make libtest:
+//
+//   cc test/libsim86_test.c build/libsim86.a -lpthread -o build/libsim86_test.out
+//
+// A faulting guest has to come back as a status, it must never take the host process down.
+
+#include "../libsim86.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(_condition) do { \
+    if (!(_condition)) { \
+        printf("[FAILED]: %s:%d: %s\n", __FILE__, __LINE__, #_condition); \
+        failures++; \
+    } \
+} while (0)
+
+static const uint8_t divide_by_zero[] = {
+    0xB3, 0x00, // mov bl, 0
+    0xF6, 0xF3, // div bl
+    0xB1, 0x07, // mov cl, 7
+};
+
+static const uint8_t far_jump[] = {
+    0xB1, 0x07,                   // mov cl, 7
+    0xEA, 0x00, 0x01, 0x00, 0xF0, // jmp 61440:256
+};
+
+static const uint8_t repnz_stosb[] = {
+    0xB9, 0x02, 0x00, // mov cx, 2
+    0xF2, 0xAA,       // repnz stosb
+};
+
+static const uint8_t add_loop[] = {
+    0xB9, 0x03, 0x00, // mov cx, 3
+    0x83, 0xC0, 0x02, // add ax, 2
+    0xE2, 0xFB,       // loop $-3
+};
+
+// The ip of the faulting instruction, the program is loaded to f000:0100
+static void test_fault(const char *name, const uint8_t *program, uint32_t size, uint16_t fault_ip, uint64_t executed)
+{
+    printf("%s\n", name);
+
+    Sim86 *sim = sim86_create();
+    CHECK(sim != NULL);
+    CHECK(sim86_load_memory(sim, program, size) == Sim86_Ok);
+
+    CHECK(sim86_run_until(sim, SIM86_NO_ADDRESS, 100) == Sim86_Fault);
+    CHECK(sim86_read_reg(sim, Sim86_Register_ip) == fault_ip);
+
+    Sim86_Stats stats;
+    sim86_get_stats(sim, &stats);
+    CHECK(stats.instructions == executed);
+
+    // The machine stays stopped on it until the next load
+    CHECK(sim86_step_n(sim, 1) == Sim86_Fault);
+    CHECK(sim86_read_reg(sim, Sim86_Register_ip) == fault_ip);
+
+    CHECK(sim86_load_memory(sim, add_loop, sizeof(add_loop)) == Sim86_Ok);
+    CHECK(sim86_run_until(sim, SIM86_NO_ADDRESS, 100) == Sim86_Halted);
+    CHECK(sim86_read_reg(sim, Sim86_Register_ax) == 6);
+
+    sim86_destroy(sim);
+}
+
+int main(void)
+{
+    test_fault("divide by zero", divide_by_zero, sizeof(divide_by_zero), 0x102, 1);
+    test_fault("far jmp", far_jump, sizeof(far_jump), 0x102, 1);
+    test_fault("repnz stosb", repnz_stosb, sizeof(repnz_stosb), 0x103, 1);
+
+    // The step_n() path
+    Sim86 *sim = sim86_create();
+    CHECK(sim86_load_memory(sim, divide_by_zero, sizeof(divide_by_zero)) == Sim86_Ok);
+    CHECK(sim86_step_n(sim, 1) == Sim86_Ok);
+    CHECK(sim86_step_n(sim, 1) == Sim86_Fault);
+    CHECK(sim86_read_reg(sim, Sim86_Register_cx) == 0);
+    sim86_destroy(sim);
+
+    if (failures) {
+        printf("[FAILED]: %d checks\n", failures);
+        return 1;
+    }
+
+    printf("[OK]\n");
+    return 0;
+}
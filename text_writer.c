@@ -0,0 +1,40 @@
+#include "text_writer.h"
+
+Text_Writer *text_writer_create(FILE *file)
+{
+    Text_Writer *writer = (Text_Writer *)malloc(sizeof(Text_Writer));
+    assert(writer != NULL);
+
+    writer->file = file;
+    writer->used = 0;
+
+    return writer;
+}
+
+void text_writer_destroy(Text_Writer *writer)
+{
+    text_writer_flush(writer);
+    free(writer);
+}
+
+void text_writer_flush(Text_Writer *writer)
+{
+    if (writer->used) {
+        fwrite(writer->block, 1, writer->used, writer->file);
+        writer->used = 0;
+    }
+    fflush(writer->file);
+}
+
+void text_writer_write(Text_Writer *writer, const char *text, u32 size)
+{
+    // Larger than the block, it goes out directly after the collected text
+    if (size > TEXT_WRITER_BLOCK_SIZE) {
+        text_writer_flush(writer);
+        fwrite(text, 1, size, writer->file);
+        return;
+    }
+
+    memcpy(text_writer_reserve(writer, size), text, size);
+    text_writer_commit(writer, size);
+}
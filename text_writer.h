@@ -0,0 +1,43 @@
+#ifndef _H_TEXT_WRITER
+#define _H_TEXT_WRITER
+
+#include "sim86.h"
+
+// Collects the text in a large block and hands it to the FILE in one fwrite, the formatters
+// (format_instruction() in printer.h) render straight into the block:
+//
+//   char *dest = text_writer_reserve(writer, INSTRUCTION_TEXT_MAX);
+//   text_writer_commit(writer, format_instruction(dest, instruction, 1));
+//
+// The block goes out in order with the rest of the FILE's output only at the flush.
+
+#define TEXT_WRITER_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    FILE *file;
+    u32 used;
+    char block[TEXT_WRITER_BLOCK_SIZE];
+} Text_Writer;
+
+Text_Writer *text_writer_create(FILE *file);
+// Flushes the rest
+void text_writer_destroy(Text_Writer *writer);
+
+void text_writer_flush(Text_Writer *writer);
+void text_writer_write(Text_Writer *writer, const char *text, u32 size);
+
+// Returns room for at most size bytes (size <= TEXT_WRITER_BLOCK_SIZE), the written ones are committed
+static inline char *text_writer_reserve(Text_Writer *writer, u32 size)
+{
+    if (writer->used + size > TEXT_WRITER_BLOCK_SIZE) {
+        text_writer_flush(writer);
+    }
+    return writer->block + writer->used;
+}
+
+static inline void text_writer_commit(Text_Writer *writer, u32 size)
+{
+    writer->used += size;
+}
+
+#endif
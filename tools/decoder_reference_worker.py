@@ -0,0 +1,127 @@
+# Long-lived worker of the differential decoder fuzzer (--fuzz-decoder, see decoder_fuzz.h),
+# it decodes with the independent reference decoder in docs/reference.py (Python 2).
+#
+# Every input line is the hex bytes of one case, the answer is one line per case with the
+# first instruction of the case (its prefixes folded into it) in the canonical form of
+# decoder_fuzz.c, "fault" if the bytes run out and "skip" if the reference has no answer.
+# A batch is flushed when its empty line arrives.
+
+import os
+import sys
+
+here = os.path.dirname(os.path.abspath(__file__))
+reference_path = os.path.join(here, '..', 'docs', 'reference.py')
+
+# The module ends with a test script reading a local file, only the decoder is taken
+source = open(reference_path, 'rb').read()
+source = source[:source.index('\nf = open(')]
+reference = {'__file__': reference_path, '__name__': 'reference'}
+exec compile(source, reference_path, 'exec') in reference
+
+Disassembler = reference['Disassembler']
+Arg_Register = reference['Arg_Register']
+Arg_Dereference = reference['Arg_Dereference']
+Arg_Address = reference['Arg_Address']
+Arg_Constant = reference['Arg_Constant']
+Arg_Integer = reference['Arg_Integer']
+Arg_Offset = reference['Arg_Offset']
+reg_set = reference['reg_set']
+
+PREFIXES = set(['CS:', 'DS:', 'ES:', 'SS:', 'LOCK', 'REPZ', 'REPNZ'])
+
+# The same instructions under another name in sim86
+MNEMONIC_ALIASES = {'JPE': 'jp', 'JPO': 'jnp', 'JGE': 'jnl'}
+
+# Their second operand is memory only, a register there (mod 11) is undefined on the 8086
+MEMORY_ONLY = set(['LEA', 'LES', 'LDS'])
+
+
+class Skip(Exception):
+    pass
+
+
+def register(code):
+    name = reg_set[code]
+    if name is None:
+        raise Skip()
+    return name.lower()
+
+
+def operand(arg):
+    if isinstance(arg, Arg_Register):
+        return 'r:' + register(arg.code + arg.type)
+    if isinstance(arg, Arg_Dereference):
+        terms = [register(r) for r in (arg.base, arg.index) if r is not None]
+        disp = arg.disp or 0
+        if arg.disp_size == 8 and disp >= 128:
+            disp -= 256
+        return 'm:%s:%d' % ('+'.join(terms), disp & 0xFFFF)
+    if isinstance(arg, Arg_Address):
+        return 'a:%d:%d' % (arg.segment, arg.offset)
+    if isinstance(arg, Arg_Offset):
+        return 'j:%d' % (arg.offset & 0xFFFF)
+    if isinstance(arg, Arg_Integer):
+        return 'i:%d' % arg.value
+    if isinstance(arg, Arg_Constant):
+        return 'i:%d' % int(arg)
+    raise Skip()
+
+
+def canonical(data):
+    length = 0
+    lock = False
+
+    for instruction in Disassembler().disassemble(data):
+        name = instruction.mneumonic.name
+        length += len(instruction.code)
+        if name in PREFIXES:
+            lock = lock or name == 'LOCK'
+            continue
+
+        operands = [operand(arg) for arg in instruction.args]
+        # The DB of an undefined opcode has no operand in sim86
+        if name == 'DB':
+            operands = []
+        if name in MEMORY_ONLY and operands[1].startswith('r:'):
+            raise Skip()
+        # sim86 leaves out the default base 10 of aam and aad, like NASM
+        if name in ('AAM', 'AAD') and operands == ['i:10']:
+            operands = []
+        # sim86 moves the memory operand of a locked instruction first
+        if lock:
+            operands.sort()
+
+        mnemonic = MNEMONIC_ALIASES.get(name, name.lower())
+        return '%d %s %s' % (length, mnemonic, ','.join(operands))
+
+    return 'fault'
+
+
+def main():
+    # The answers of a batch go out in one write, sim86 only reads them when all are there
+    answers = []
+    for line in iter(sys.stdin.readline, ''):
+        line = line.strip()
+        if not line:
+            sys.stdout.write(''.join(answers))
+            sys.stdout.flush()
+            answers = []
+            continue
+
+        try:
+            answer = canonical(line.decode('hex'))
+        except Skip:
+            answer = 'skip'
+        except IndexError:
+            answer = 'fault'
+        except KeyError:
+            # The reference has no operand type for some undefined encodings (call far with mod 11)
+            answer = 'skip'
+        answers.append(answer + '\n')
+
+    sys.stdout.write(''.join(answers))
+    sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,255 @@
+# Generates i8086table.h from the opcode map in docs/8086_table.txt, run by the Makefile:
+#
+#   python3 tools/gen_i8086_table.py docs/8086_table.txt i8086table.h
+#
+# A line of the map is "<opcode> <MNEMONIC> <arg1> <arg2>" split by tabs or spaces,
+# the group lines are "GRP<n>/<reg> <MNEMONIC> ..." and "--" is an unused encoding. The header has
+# the Mneumonic enum, the name of every mnemonic, the packed operand specs, the primary table
+# and the group tables indexed by the reg field of the ModR/M byte.
+#
+# The mnemonics are numbered in the order of their first use in the map, then db, the groups
+# and invalid. The numbers are in the binary decoder output (--decode-format binary), a new
+# mnemonic before the last one moves the ones after it and needs a new DECODE_FILE_VERSION.
+
+import sys
+
+# The map calls a few of the jumps by another name than NASM
+MNEMONIC_ALIASES = {'JPE': 'jp', 'JPO': 'jnp', 'JGE': 'jnl'}
+
+# Instruction_Type of the primary opcodes, a group instruction has the type of its opcode
+MNEMONIC_TYPES = {
+    'add': 'arithmetic', 'cmp': 'arithmetic', 'cmpsb': 'arithmetic', 'cmpsw': 'arithmetic',
+    'xor': 'logical',
+    'push': 'stack', 'pop': 'stack', 'pushf': 'stack', 'popf': 'stack',
+    'mov': 'move', 'movsb': 'move', 'movsw': 'move',
+    'stosb': 'string', 'stosw': 'string',
+    'jo': 'flow', 'jno': 'flow', 'jb': 'flow', 'jnb': 'flow', 'jz': 'flow', 'jnz': 'flow',
+    'jbe': 'flow', 'ja': 'flow', 'js': 'flow', 'jns': 'flow', 'jp': 'flow', 'jnp': 'flow',
+    'jl': 'flow', 'jnl': 'flow', 'jle': 'flow', 'jg': 'flow',
+    'loopnz': 'flow', 'loopz': 'flow', 'loop': 'flow', 'jcxz': 'flow', 'jmp': 'flow',
+    'out': 'io',
+}
+
+# The encoded value of the fixed register operands
+REGISTERS = {
+    'AL': 0, 'CL': 1, 'DL': 2, 'BL': 3, 'AH': 4, 'CH': 5, 'DH': 6, 'BH': 7,
+    'eAX': 0, 'eCX': 1, 'eDX': 2, 'eBX': 3, 'eSP': 4, 'eBP': 5, 'eSI': 6, 'eDI': 7,
+    'DX': 2,
+}
+SEGMENT_REGISTERS = {'ES': 0, 'CS': 1, 'SS': 2, 'DS': 3}
+
+# The first letter of the addressing method, see the Operand_Spec_Kind in the header
+SPEC_KINDS = {
+    'A': 'Spec_Far_Pointer',
+    'J': 'Spec_Relative',
+    'E': 'Spec_Modrm',
+    'G': 'Spec_Modrm_Reg',
+    'I': 'Spec_Immediate',
+    'O': 'Spec_Offset',
+    'S': 'Spec_Modrm_Segment',
+    'M': 'Spec_Modrm_Memory',
+}
+SPEC_SIZES = {'': 'Spec_Size_None', 'b': 'Spec_Size_Byte', 'v': 'Spec_Size_Word', 'w': 'Spec_Size_Word', 'p': 'Spec_Size_Pointer'}
+
+HEADER = '''\
+// Generated by tools/gen_i8086_table.py from docs/8086_table.txt, edit those and run make.
+
+#ifndef _H_i8086_TABLE
+#define _H_i8086_TABLE 1
+
+#include "sim86.h"
+
+'''
+
+SPEC_DEFINITIONS = '''\
+// An operand of the opcode map packed into 16 bits: the kind in the low 4 bits, then the size
+// (2 bits) and the register or the constant (3 bits). Operand_Spec_Eb is the "Eb" of the map.
+typedef u16 Operand_Spec;
+
+typedef enum {
+    Spec_None,
+    Spec_Register,         // AL, eAX, DX: a fixed general register, the value is its encoding
+    Spec_Segment_Register, // ES, CS, SS, DS: a fixed segment register
+    Spec_Far_Pointer,      // A: segment:offset in the instruction, no ModR/M byte
+    Spec_Relative,         // J: offset from the next instruction
+    Spec_Modrm,            // E: register or memory of the ModR/M byte
+    Spec_Modrm_Reg,        // G: general register of the reg field
+    Spec_Immediate,        // I: immediate data
+    Spec_Aam_Base,         // I0: the base of aam and aad
+    Spec_Offset,           // O: direct offset in the instruction, no ModR/M byte
+    Spec_Modrm_Segment,    // S: segment register of the reg field
+    Spec_Modrm_Memory,     // M: memory only ModR/M byte
+    Spec_Constant,         // 1, 3: the value is the constant
+} Operand_Spec_Kind;
+
+typedef enum {
+    Spec_Size_None,
+    Spec_Size_Byte,    // b
+    Spec_Size_Word,    // v, w and the wide registers
+    Spec_Size_Pointer, // p, a 32 bit segment:offset
+} Operand_Spec_Size;
+
+#define OPERAND_SPEC(_kind, _size, _value) ((_kind) | ((_size) << 4) | ((_value) << 6))
+#define OPERAND_SPEC_KIND(_spec)  ((_spec) & 0xF)
+#define OPERAND_SPEC_SIZE(_spec)  (((_spec) >> 4) & 0x3)
+#define OPERAND_SPEC_VALUE(_spec) (((_spec) >> 6) & 0x7)
+
+'''
+
+TABLE_DEFINITIONS = '''\
+typedef struct i8086_Inst_Table i8086_Inst_Table;
+
+struct i8086_Inst_Table {
+    u8 opcode; // the reg field of the ModR/M byte in the group tables
+    Mneumonic mnemonic;
+    Operand_Spec arg1;
+    Operand_Spec arg2;
+    Instruction_Type type;
+};
+
+'''
+
+
+def fail(message):
+    sys.stderr.write('[ERROR]: %s\n' % message)
+    sys.exit(1)
+
+
+def spec_name(arg):
+    return 'Operand_Spec_' + arg if arg else 'Operand_Spec_none'
+
+
+def spec_value(arg):
+    if arg in REGISTERS:
+        wide = arg[0] == 'e' or arg[-1] in 'XI'
+        return 'Spec_Register', 'Spec_Size_Word' if wide else 'Spec_Size_Byte', REGISTERS[arg]
+    if arg in SEGMENT_REGISTERS:
+        return 'Spec_Segment_Register', 'Spec_Size_None', SEGMENT_REGISTERS[arg]
+    if arg.isdigit():
+        return 'Spec_Constant', 'Spec_Size_None', int(arg)
+    if arg == 'I0':
+        return 'Spec_Aam_Base', 'Spec_Size_Byte', 0
+    if arg[0] in SPEC_KINDS and arg[1:] in SPEC_SIZES:
+        return SPEC_KINDS[arg[0]], SPEC_SIZES[arg[1:]], 0
+    fail('Unknown operand "%s" in the opcode map.' % arg)
+
+
+def mnemonic_of(text, unused):
+    if text == '--':
+        return unused
+    if text in MNEMONIC_ALIASES:
+        return MNEMONIC_ALIASES[text]
+    return text.rstrip(':').lower()
+
+
+def parse(path):
+    primary = {}
+    groups = {}
+
+    for number, line in enumerate(open(path).read().splitlines(), 1):
+        fields = line.split()
+        if not fields:
+            continue
+        if len(fields) > 4:
+            fail('%s:%d: More than two operands.' % (path, number))
+
+        key = fields[0]
+        args = (fields[2:] + [None, None])[:2]
+
+        if key.startswith('GRP'):
+            group, reg = key.split('/')
+            groups.setdefault(group.lower(), {})[int(reg)] = (mnemonic_of(fields[1], 'invalid'), args)
+        else:
+            opcode = int(key, 16)
+            if opcode in primary:
+                fail('%s:%d: Opcode %02X is already in the map.' % (path, number, opcode))
+            mnemonic = fields[1].lower() if fields[1].startswith('GRP') else mnemonic_of(fields[1], 'db')
+            primary[opcode] = (mnemonic, args)
+
+    if sorted(primary) != list(range(256)):
+        fail('The map has %d of the 256 opcodes.' % len(primary))
+    for group, entries in groups.items():
+        if sorted(entries) != list(range(8)):
+            fail('%s has %d of the 8 entries.' % (group, len(entries)))
+
+    return primary, groups
+
+
+def main():
+    if len(sys.argv) != 3:
+        fail('Usage: gen_i8086_table.py <8086_table.txt> <i8086table.h>')
+
+    primary, groups = parse(sys.argv[1])
+
+    group_names = []
+    for opcode in range(256):
+        mnemonic = primary[opcode][0]
+        if mnemonic.startswith('grp') and mnemonic not in group_names:
+            group_names.append(mnemonic)
+    for group in groups:
+        if group not in group_names:
+            fail('%s is not used by an opcode.' % group)
+
+    # The order of the first use, the numbers of the existing mnemonics don't move
+    mnemonics = ['none']
+    special = set(['db', 'invalid'] + group_names)
+    for mnemonic, _ in [primary[opcode] for opcode in range(256)] + [groups[g][r] for g in group_names for r in range(8)]:
+        if mnemonic not in special and mnemonic not in mnemonics:
+            mnemonics.append(mnemonic)
+
+    args = set()
+    for _, (first, second) in list(primary.values()) + [entry for g in group_names for entry in groups[g].values()]:
+        args.update(arg for arg in (first, second) if arg)
+
+    out = [HEADER]
+
+    out.append('typedef enum {\n')
+    for mnemonic in mnemonics + ['db'] + group_names + ['invalid', 'count']:
+        out.append('    Mneumonic_%s,\n' % mnemonic)
+    out.append('} Mneumonic;\n\n')
+
+    out.append('// "???" for a reg field without an instruction in a group, NULL for Mneumonic_none\n')
+    out.append('static const char *const i8086_mnemonic_names[Mneumonic_count] = {\n')
+    for mnemonic in mnemonics[1:] + ['db'] + group_names:
+        out.append('    [Mneumonic_%s]%s = "%s",\n' % (mnemonic, ' ' * (7 - len(mnemonic)), mnemonic))
+    out.append('    [Mneumonic_invalid] = "???",\n')
+    out.append('};\n\n')
+
+    out.append(SPEC_DEFINITIONS)
+    out.append('enum {\n')
+    out.append('    Operand_Spec_none = 0,\n')
+    for arg in sorted(args, key=lambda a: (a[0].isdigit(), a.lower(), a)):
+        kind, size, value = spec_value(arg)
+        out.append('    %s = OPERAND_SPEC(%s, %s, %d),\n' % (spec_name(arg), kind, size, value))
+    out.append('};\n\n')
+
+    out.append(TABLE_DEFINITIONS)
+
+    out.append('static const i8086_Inst_Table i8086_inst_table[256] = {\n')
+    for opcode in range(256):
+        mnemonic, (first, second) = primary[opcode]
+        instruction_type = MNEMONIC_TYPES.get(mnemonic)
+        out.append('    { 0x%02X, Mneumonic_%s, %s, %s%s },\n' % (
+            opcode, mnemonic, spec_name(first), spec_name(second),
+            ', Instruction_Type_' + instruction_type if instruction_type else ''))
+    out.append('};\n\n')
+
+    # Indexed by mnemonic - Mneumonic_grp1, a group entry without operands takes the opcode's
+    out.append('#define I8086_GROUP_COUNT %d\n\n' % len(group_names))
+    out.append('static const i8086_Inst_Table i8086_group_table[I8086_GROUP_COUNT][8] = {\n')
+    for group in group_names:
+        out.append('    [Mneumonic_%s - Mneumonic_grp1] = {\n' % group)
+        for reg in range(8):
+            mnemonic, (first, second) = groups[group][reg]
+            out.append('        { %d, Mneumonic_%s, %s, %s },\n' % (reg, mnemonic, spec_name(first), spec_name(second)))
+        out.append('    },\n')
+    out.append('};\n\n')
+
+    out.append('#endif\n')
+
+    with open(sys.argv[2], 'w') as header:
+        header.write(''.join(out))
+
+
+if __name__ == '__main__':
+    main()